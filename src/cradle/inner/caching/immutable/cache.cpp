@@ -3,6 +3,7 @@
 #include <cradle/inner/caching/immutable/cache.h>
 #include <cradle/inner/caching/immutable/internals.h>
 #include <cradle/inner/core/get_unique_string.h>
+#include <cradle/inner/core/unique_hash.h>
 #include <cradle/inner/utilities/text.h>
 
 namespace cradle {
@@ -17,32 +18,101 @@ immutable_cache::immutable_cache(immutable_cache_config config)
 void
 immutable_cache::reset(immutable_cache_config config)
 {
-    this->impl = std::make_unique<detail::immutable_cache_impl>();
-    this->impl->config = std::move(config);
+    this->impl
+        = std::make_shared<detail::immutable_cache_impl>(std::move(config));
 }
 
 void
 clear_unused_entries(immutable_cache& cache)
 {
-    detail::reduce_memory_cache_size(*cache.impl, 0);
+    detail::clear_unused_records(*cache.impl);
+}
+
+immutable_cache_config const&
+get_config(immutable_cache const& cache)
+{
+    return cache.impl->config;
+}
+
+bool
+exceeds_total_size_limit(immutable_cache& cache)
+{
+    return detail::exceeds_total_size_limit(*cache.impl);
+}
+
+void
+record_throttled_calculation(immutable_cache& cache)
+{
+    cache.impl->throttled_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool
+wait_for_total_size_limit(
+    immutable_cache& cache,
+    std::chrono::milliseconds timeout,
+    function_view<bool()> const& stop)
+{
+    return detail::wait_for_total_size_limit(*cache.impl, timeout, stop);
+}
+
+std::uint64_t
+add_eviction_waiter(immutable_cache& cache, std::function<void()> on_eviction)
+{
+    auto& impl{*cache.impl};
+    std::scoped_lock lock(impl.admission_mutex);
+    auto id{impl.next_eviction_waiter_id++};
+    impl.eviction_waiters.emplace(id, std::move(on_eviction));
+    ++impl.admission_waiters;
+    return id;
+}
+
+void
+remove_eviction_waiter(immutable_cache& cache, std::uint64_t id)
+{
+    auto& impl{*cache.impl};
+    std::scoped_lock lock(impl.admission_mutex);
+    if (impl.eviction_waiters.erase(id) > 0)
+    {
+        --impl.admission_waiters;
+    }
 }
 
 immutable_cache_info
 get_summary_info(immutable_cache& cache)
 {
     auto& impl = *cache.impl;
-    std::scoped_lock<std::mutex> lock(impl.mutex);
-    immutable_cache_info info;
-    info.ac_num_records = static_cast<int>(impl.records.size());
-    info.ac_num_records_pending_eviction
-        = static_cast<int>(impl.eviction_list.size());
+    immutable_cache_info info{};
+    // The shards are visited one after the other, so the totals are not
+    // necessarily consistent if the cache is being accessed concurrently.
+    for (auto& shard : impl.shards)
+    {
+        std::scoped_lock lock(shard->mutex);
+        auto ac_num_records = static_cast<int>(shard->records.size());
+        info.ac_num_records += ac_num_records;
+        auto cold_num_records = static_cast<int>(shard->cold_list.size());
+        info.ac_num_records_pending_eviction
+            += static_cast<int>(shard->eviction_list.size())
+               + cold_num_records;
+        info.cas_num_records += shard->cas.num_records();
+        info.cas_total_size += shard->cas.total_size();
+        info.cas_total_locked_size += shard->cas.total_locked_size();
+        info.hit_count += shard->hit_count;
+        info.cold_hit_count += shard->cold_hit_count;
+        info.miss_count += shard->miss_count;
+        info.cold_num_records += cold_num_records;
+        info.cold_total_size += shard->cold_total_size;
+        info.shards.push_back(immutable_cache_shard_info{
+            .ac_num_records = ac_num_records,
+            .cas_num_records = shard->cas.num_records(),
+            .cas_total_size = shard->cas.total_size(),
+            .lock_acquisitions = shard->mutex.num_acquisitions(),
+            .lock_contentions = shard->mutex.num_contended()});
+    }
     info.ac_num_records_in_use
         = info.ac_num_records - info.ac_num_records_pending_eviction;
-    info.cas_num_records = impl.cas.num_records();
-    info.cas_total_size = impl.cas.total_size();
-    info.cas_total_locked_size = impl.cas.total_locked_size();
-    info.hit_count = impl.hit_count;
-    info.miss_count = impl.miss_count;
+    info.throttled_count
+        = impl.throttled_count.load(std::memory_order_relaxed);
+    info.avoided_hash_bytes = get_avoided_hash_bytes();
     return info;
 }
 
@@ -74,27 +144,59 @@ operator<<(std::ostream& os, immutable_cache_snapshot const& snapshot)
     return os;
 }
 
+namespace {
+
+immutable_cache_entry_snapshot
+make_entry_snapshot(
+    detail::immutable_cache_record const& record, digest_algorithm algo)
+{
+    std::size_t size{0};
+    if (record.cas_record)
+    {
+        size = record.cas_record->deep_size();
+    }
+    else if (record.cold_record)
+    {
+        size = record.cold_record->deep_size();
+    }
+    return immutable_cache_entry_snapshot{
+        get_unique_string(*record.key, algo),
+        record.state,
+        size};
+}
+
+} // namespace
+
 immutable_cache_snapshot
 get_cache_snapshot(immutable_cache& cache_object)
 {
     auto& cache = *cache_object.impl;
-    std::scoped_lock<std::mutex> lock(cache.mutex);
+    auto const algo{cache.config.algorithm};
     immutable_cache_snapshot snapshot;
-    for (auto const& [key, record] : cache.records)
+    for (auto& shard : cache.shards)
     {
-        immutable_cache_entry_snapshot entry{
-            get_unique_string(*record->key),
-            record->state,
-            record->cas_record ? record->cas_record->deep_size() : 0};
-        // Put the entry's info the appropriate list depending on whether
-        // or not it's in the eviction list.
-        if (record->eviction_list_iterator != cache.eviction_list.end())
+        std::scoped_lock lock(shard->mutex);
+        for (auto const& [key, record] : shard->records)
+        {
+            bool in_use
+                = record->eviction_list_iterator == shard->eviction_list.end()
+                  && !record->cold_record;
+            if (in_use)
+            {
+                snapshot.in_use.push_back(make_entry_snapshot(*record, algo));
+            }
+        }
+        // The entries pending eviction are listed in eviction order (for the
+        // LRU policy), starting with those in the cold tier.
+        for (auto const& record : shard->cold_list)
         {
-            snapshot.pending_eviction.push_back(std::move(entry));
+            snapshot.pending_eviction.push_back(
+                make_entry_snapshot(record, algo));
         }
-        else
+        for (auto const& record : shard->eviction_list)
         {
-            snapshot.in_use.push_back(std::move(entry));
+            snapshot.pending_eviction.push_back(
+                make_entry_snapshot(record, algo));
         }
     }
     return snapshot;
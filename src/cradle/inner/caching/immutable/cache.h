@@ -1,12 +1,17 @@
 #ifndef CRADLE_INNER_CACHING_IMMUTABLE_CACHE_H
 #define CRADLE_INNER_CACHING_IMMUTABLE_CACHE_H
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <cradle/inner/core/id.h>
+#include <cradle/inner/core/unique_hash.h>
+#include <cradle/inner/utilities/functional.h>
 
 /*
  * This file provides the top-level interface to the immutable cache.
@@ -54,6 +59,15 @@
  *   immediately returns.
  * - The AC record contains a reference to a CAS record; a copy of the value
  *   in that CAS record is returned to the client.
+ *
+ * The cache can be split into a number of shards, each protecting its own
+ * subset of the AC records, and its own slice of the CAS, by its own mutex.
+ * An AC record is assigned to a shard based on the hash of its key. This
+ * reduces lock contention when many threads access the cache concurrently.
+ * The size limit applies to the cache as a whole, not to individual shards.
+ *
+ * With a cold tier, an evicted AC record can stay in the cache, its value
+ * being serialized and compressed, and restored when the record is hit.
  */
 
 namespace cradle {
@@ -64,11 +78,88 @@ struct immutable_cache_impl;
 
 } // namespace detail
 
+// How the cache selects the unused entry to evict next
+enum class immutable_cache_eviction_policy
+{
+    // Least recently used entry first
+    LRU,
+
+    // Greedy-Dual-Size-Frequency: evicts the entry with the lowest
+    //   clock + (hit_count + 1) * resolve_time / deep_size
+    // first, where the clock is the priority of the last evicted entry.
+    // Results that took long to compute, that are small, or that were
+    // frequently hit are kept longer, while the clock ages entries that are
+    // no longer used.
+    GDSF
+};
+
 struct immutable_cache_config
 {
     // The maximum amount of memory to use for caching results that are no
     // longer in use, in bytes.
     std::size_t unused_size_limit;
+
+    // The number of shards that the cache is split into. Records are
+    // evicted in LRU order within a shard, but only approximately so across
+    // shards.
+    std::size_t num_shards{1};
+
+    // The policy deciding the order in which unused entries are evicted.
+    immutable_cache_eviction_policy eviction_policy{
+        immutable_cache_eviction_policy::LRU};
+
+    // If set, unused entries are evicted by a background thread, instead of
+    // by the thread that releases the last reference to an entry; that
+    // thread then only puts the entry on the eviction list. The background
+    // thread becomes active when the total size of unused entries exceeds
+    // unused_size_limit (the high watermark), and evicts entries until that
+    // size is at most low_watermark_percentage percent of unused_size_limit.
+    bool background_eviction{false};
+
+    // The low watermark for background eviction, as a percentage of
+    // unused_size_limit.
+    std::size_t low_watermark_percentage{90};
+
+    // The maximum amount of memory for the cold tier, in bytes; 0 disables
+    // the cold tier. Instead of dropping an evicted entry, the cache
+    // serializes and compresses its value, and keeps it in the cold tier
+    // (as long as the tier's size allows). A hit on such an entry restores
+    // the value, which is much cheaper than resolving it again.
+    // Only values of fully cached requests (which are serializable) go to
+    // the cold tier.
+    std::size_t cold_tier_size_limit{0};
+
+    // The maximum amount of memory for all values in the cache (hot tier
+    // only), whether in use or not, in bytes; 0 means no limit. If the
+    // total size exceeds this limit, unused entries are evicted even if
+    // unused_size_limit has not been reached, and new calculations are
+    // throttled (see admission_timeout).
+    std::size_t total_size_limit{0};
+
+    // The maximum time that a new calculation is delayed while the total
+    // size limit is exceeded. The calculation then goes ahead anyway, as
+    // the entries that are in use may be waiting for it; so the limit is a
+    // soft one.
+    std::chrono::milliseconds admission_timeout{1000};
+
+    // The algorithm for the digests identifying the values in the cache (and
+    // for the keys in a snapshot).
+    digest_algorithm algorithm{digest_algorithm::SHA256};
+};
+
+// Summary information on a single shard in the cache.
+struct immutable_cache_shard_info
+{
+    // Number of AC records in this shard.
+    int ac_num_records;
+    // Number of CAS records in this shard.
+    int cas_num_records;
+    // Total deep size of the values stored in this shard's CAS slice.
+    std::size_t cas_total_size;
+    // Number of times the shard's mutex was acquired.
+    uint64_t lock_acquisitions;
+    // Number of those acquisitions that had to wait for another thread.
+    uint64_t lock_contentions;
 };
 
 // Summary information on the data in the cache.
@@ -86,10 +177,25 @@ struct immutable_cache_info
     std::size_t cas_total_size;
     // Total deep size of CAS entries with locked referrers.
     std::size_t cas_total_locked_size;
-    // Number of cache hits.
+    // Number of calculations that were delayed because the total size limit
+    // was exceeded.
+    int throttled_count;
+    // Number of cache hits on entries in the hot tier.
     int hit_count;
-    // Number of cache misses.
+    // Number of cache hits on entries in the cold tier.
+    int cold_hit_count;
+    // Number of cache misses (in both tiers).
     int miss_count;
+    // Number of AC records in the cold tier; these are included in
+    // ac_num_records_pending_eviction.
+    int cold_num_records;
+    // Total size of the compressed values in the cold tier.
+    std::size_t cold_total_size;
+    // Number of bytes that did not need to be hashed thanks to memoized
+    // blob digests; process-wide, see get_avoided_hash_bytes().
+    std::size_t avoided_hash_bytes;
+    // Per-shard information; one element if the cache is not sharded.
+    std::vector<immutable_cache_shard_info> shards;
 };
 
 struct immutable_cache
@@ -103,7 +209,9 @@ struct immutable_cache
     void
     reset(immutable_cache_config config);
 
-    std::unique_ptr<detail::immutable_cache_impl> impl;
+    // Shared with the pointers returned by get_shared_value(), so that values
+    // they refer to stay valid when the cache is reset.
+    std::shared_ptr<detail::immutable_cache_impl> impl;
 };
 
 enum class immutable_cache_entry_state
@@ -147,7 +255,9 @@ struct immutable_cache_snapshot
     // AC entries that are currently in use
     std::vector<immutable_cache_entry_snapshot> in_use;
 
-    // AC entries that are no longer in use and will be evicted when necessary
+    // AC entries that are no longer in use and will be evicted when necessary.
+    // For a cache with a single shard and the LRU eviction policy, these are
+    // in eviction order (least recently used first).
     std::vector<immutable_cache_entry_snapshot> pending_eviction;
 
     bool
@@ -169,6 +279,42 @@ get_summary_info(immutable_cache& cache);
 void
 clear_unused_entries(immutable_cache& cache);
 
+// Returns the config that the cache was (last) initialized with.
+immutable_cache_config const&
+get_config(immutable_cache const& cache);
+
+// Returns true if the total size of the values in the cache exceeds the
+// total_size_limit from its config, meaning that new calculations should be
+// throttled.
+bool
+exceeds_total_size_limit(immutable_cache& cache);
+
+// Records that a calculation was delayed because of the total size limit.
+void
+record_throttled_calculation(immutable_cache& cache);
+
+// Blocks until the cache is back within its total size limit, :timeout has
+// passed, or :stop returns true. Waiting threads are woken up when values are
+// evicted, so :stop is evaluated only then, or on timeout.
+// Returns true if the cache is within its limit.
+bool
+wait_for_total_size_limit(
+    immutable_cache& cache,
+    std::chrono::milliseconds timeout,
+    function_view<bool()> const& stop);
+
+// Registers :on_eviction to be called, once, when a value is next removed
+// from the cache. The call happens on the evicting thread, while holding
+// cache-internal mutexes, so it should do little more than scheduling some
+// work. Returns an ID for remove_eviction_waiter().
+std::uint64_t
+add_eviction_waiter(immutable_cache& cache, std::function<void()> on_eviction);
+
+// Unregisters a callback added by add_eviction_waiter(), if it has not been
+// called yet.
+void
+remove_eviction_waiter(immutable_cache& cache, std::uint64_t id);
+
 } // namespace cradle
 
 #endif
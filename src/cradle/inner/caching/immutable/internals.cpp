@@ -1,6 +1,10 @@
+#include <algorithm>
+
 #include <boost/functional/hash.hpp>
 
 #include <cradle/inner/caching/immutable/internals.h>
+#include <cradle/inner/caching/immutable/reaper.h>
+#include <cradle/inner/encodings/lz4.h>
 
 namespace cradle {
 
@@ -8,43 +12,259 @@ namespace detail {
 
 namespace {
 
+bool
+uses_gdsf(immutable_cache_shard const& shard)
+{
+    return shard.owner.config.eviction_policy
+           == immutable_cache_eviction_policy::GDSF;
+}
+
+// Calculates the GDSF priority for a record that is becoming unused.
+double
+calc_gdsf_priority(
+    immutable_cache_shard const& shard, immutable_cache_record const& record)
+{
+    double cost = std::chrono::duration<double>(record.resolve_time).count();
+    double frequency = record.hit_count + 1;
+    // A record without a value (e.g., a failed one) has no size; use a
+    // nominal one.
+    std::size_t size = record.cas_record ? record.cas_record->deep_size() : 0;
+    size = std::max(size, std::size_t{1});
+    return shard.eviction_clock
+           + frequency * cost / static_cast<double>(size);
+}
+
 void
 add_to_eviction_list(
-    cache_record_eviction_list& list, immutable_cache_record& record)
+    immutable_cache_shard& shard, immutable_cache_record& record)
 {
+    auto& list = shard.eviction_list;
     assert(record.eviction_list_iterator == list.end());
     record.eviction_list_iterator = list.insert(list.end(), record);
+    if (uses_gdsf(shard))
+    {
+        record.eviction_priority = calc_gdsf_priority(shard, record);
+        shard.priority_set.insert(record);
+    }
 }
 
 void
 remove_from_eviction_list(
-    cache_record_eviction_list& list, immutable_cache_record& record)
+    immutable_cache_shard& shard, immutable_cache_record& record)
 {
+    auto& list = shard.eviction_list;
     assert(record.eviction_list_iterator != list.end());
     list.erase(record.eviction_list_iterator);
     record.eviction_list_iterator = list.end();
+    if (uses_gdsf(shard))
+    {
+        shard.priority_set.erase(shard.priority_set.iterator_to(record));
+    }
+}
+
+// Returns the record on the eviction list that should be evicted first.
+immutable_cache_record&
+select_eviction_victim(immutable_cache_shard& shard)
+{
+    if (uses_gdsf(shard))
+    {
+        auto& record = *shard.priority_set.begin();
+        // Age the records that stay behind.
+        shard.eviction_clock = record.eviction_priority;
+        return record;
+    }
+    return shard.eviction_list.front();
+}
+
+// Wakes up the calculations waiting for the total size to drop below the
+// limit, after a value was removed from the cache.
+void
+notify_admission_waiters(immutable_cache_impl& cache)
+{
+    if (cache.admission_waiters.load() == 0)
+    {
+        return;
+    }
+    std::map<std::uint64_t, std::function<void()>> waiters;
+    {
+        std::scoped_lock lock(cache.admission_mutex);
+        cache.admission_cv.notify_all();
+        waiters.swap(cache.eviction_waiters);
+        cache.admission_waiters -= static_cast<int>(waiters.size());
+    }
+    for (auto& [id, on_eviction] : waiters)
+    {
+        on_eviction();
+    }
+}
+
+// Drops the AC record's reference to its CAS record, unlinking the latter if
+// it is no longer referenced.
+void
+release_cas_record(
+    immutable_cache_shard& shard,
+    immutable_cache_record& record,
+    unlinked_records& unlinked)
+{
+    if (auto* cas_record = record.cas_record)
+    {
+        cas_record->del_ref();
+        if (cas_record->ref_count() == 0)
+        {
+            unlinked.cas_records.push_back(shard.cas.del_record(*cas_record));
+            notify_admission_waiters(shard.owner);
+        }
+        record.cas_record = nullptr;
+    }
 }
 
+// Tries to unlink a record from the eviction list on its way to the cold
+// tier; its value is compressed, and the record linked into the cold tier,
+// when :unlinked is destroyed (see ~unlinked_records()). Returns false if the
+// record's value cannot go there, in which case the record should be evicted.
+bool
+demote_to_cold_tier(
+    immutable_cache_shard& shard,
+    immutable_cache_record& record,
+    unlinked_records& unlinked)
+{
+    auto& cache = shard.owner;
+    auto const* cas_record = record.cas_record;
+    if (cache.config.cold_tier_size_limit == 0 || cas_record == nullptr
+        || cas_record->codec() == nullptr)
+    {
+        return false;
+    }
+    // The value must end up in :unlinked, so that it can be compressed
+    // outside the mutex. A value that is shared with other AC records stays
+    // in the hot tier anyway.
+    if (cas_record->ref_count() > 1)
+    {
+        return false;
+    }
+    remove_from_eviction_list(shard, record);
+    release_cas_record(shard, record, unlinked);
+    auto node = shard.records.extract(&*record.key);
+    unlinked.demoted.push_back(
+        demoted_record{std::move(node.mapped()), cas_record});
+    return true;
+}
+
+// Evicts records from the shard's cold tier (in LRU order) until the total
+// size of the cold tier is within its limit.
+void
+reduce_cold_tier_size_impl(
+    immutable_cache_shard& shard, unlinked_records& unlinked)
+{
+    auto& cache = shard.owner;
+    auto const size_limit = cache.config.cold_tier_size_limit;
+    while (!shard.cold_list.empty()
+           && cache.total_cold_size.load(std::memory_order_relaxed)
+                  > size_limit)
+    {
+        auto& record = shard.cold_list.front();
+        shard.cold_list.pop_front();
+        auto const cold_size = record.cold_record->deep_size();
+        shard.cold_total_size -= cold_size;
+        cache.total_cold_size -= cold_size;
+        // Unlink the record; the caller will destroy it.
+        auto node = shard.records.extract(&*record.key);
+        unlinked.ac_records.push_back(std::move(node.mapped()));
+    }
+}
+
+// Returns true if unused records should be evicted: because the total size
+// of the unlocked records exceeds desired_size, or because the total size
+// limit is exceeded.
+bool
+needs_eviction(immutable_cache_impl const& cache, uint64_t desired_size)
+{
+    return cache.total_unlocked_size.load(std::memory_order_relaxed)
+               > desired_size
+           || exceeds_total_size_limit(cache);
+}
+
+// If allow_demotion is set, records are moved to the cold tier where
+// possible, instead of being evicted.
 void
 reduce_memory_cache_size_impl(
-    immutable_cache_impl& cache, uint64_t desired_size)
+    immutable_cache_shard& shard,
+    uint64_t desired_size,
+    unlinked_records& unlinked,
+    bool allow_demotion = true)
 {
     // The critical size excludes CAS records with locked referrer(s).
-    while (!cache.eviction_list.empty()
-           && cache.cas.total_unlocked_size() > desired_size)
+    while (!shard.eviction_list.empty()
+           && needs_eviction(shard.owner, desired_size))
     {
-        auto const& record = cache.eviction_list.front();
-        if (auto* cas_record = record.cas_record)
+        auto& record = select_eviction_victim(shard);
+        if (allow_demotion && demote_to_cold_tier(shard, record, unlinked))
         {
-            cas_record->del_ref();
-            if (cas_record->ref_count() == 0)
-            {
-                cache.cas.del_record(*cas_record);
-            }
+            continue;
+        }
+        release_cas_record(shard, record, unlinked);
+        // Unlink the record; the caller will destroy it.
+        remove_from_eviction_list(shard, record);
+        auto node = shard.records.extract(&*record.key);
+        unlinked.ac_records.push_back(std::move(node.mapped()));
+    }
+}
+
+// Links a demoted record, whose value has been compressed, into its shard's
+// cold tier; unless the shard got a new record for the same key in the
+// meantime.
+void
+link_cold_record(
+    demoted_record& demoted,
+    std::unique_ptr<compressed_cas_record> cold_record,
+    unlinked_records& unlinked)
+{
+    auto& record = *demoted.ac_record;
+    auto& shard = *record.owner_shard;
+    auto& cache = shard.owner;
+    auto const cold_size = cold_record->deep_size();
+    std::scoped_lock lock(shard.mutex);
+    if (shard.records.contains(&*record.key))
+    {
+        return;
+    }
+    record.cold_record = std::move(cold_record);
+    shard.cold_list.push_back(record);
+    shard.cold_total_size += cold_size;
+    cache.total_cold_size += cold_size;
+    shard.records.emplace(&*record.key, std::move(demoted.ac_record));
+    // As the cold tier's size limit is a global one, evicting from this
+    // shard's cold tier alone suffices to keep the total within it.
+    reduce_cold_tier_size_impl(shard, unlinked);
+}
+
+// Called with the mutex for own_shard held, when evicting from that shard
+// alone could not bring the cache below the size limit.
+// Other shards are visited only if their mutex is immediately available:
+// waiting for it could deadlock against another thread doing the same thing.
+// A shard that is skipped now will be reduced on its own next eviction.
+void
+reduce_other_shards_size(
+    immutable_cache_shard& own_shard,
+    uint64_t desired_size,
+    unlinked_records& unlinked)
+{
+    auto& cache = own_shard.owner;
+    for (auto& shard : cache.shards)
+    {
+        if (!needs_eviction(cache, desired_size))
+        {
+            break;
+        }
+        if (&*shard == &own_shard)
+        {
+            continue;
+        }
+        std::unique_lock lock(shard->mutex, std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            reduce_memory_cache_size_impl(*shard, desired_size, unlinked);
         }
-        // Unlink the record, then destroy it.
-        cache.eviction_list.pop_front();
-        cache.records.erase(&*record.key);
     }
 }
 
@@ -53,35 +273,51 @@ reduce_memory_cache_size_impl(
 void
 add_ref_to_cache_record(immutable_cache_record& record)
 {
-    auto& cache = *record.owner_cache;
+    auto& shard = *record.owner_shard;
     ++record.ref_count;
-    if (record.eviction_list_iterator != cache.eviction_list.end())
+    if (record.eviction_list_iterator != shard.eviction_list.end())
     {
         assert(record.ref_count == 1);
-        remove_from_eviction_list(cache.eviction_list, record);
+        remove_from_eviction_list(shard, record);
     }
 }
 
 void
-del_ref_from_cache_record(immutable_cache_record& record)
+del_ref_from_cache_record(
+    immutable_cache_record& record, unlinked_records& unlinked)
 {
-    auto& cache = *record.owner_cache;
+    auto& shard = *record.owner_shard;
     --record.ref_count;
     if (record.ref_count == 0)
     {
-        add_to_eviction_list(cache.eviction_list, record);
-        reduce_memory_cache_size_impl(cache, cache.config.unused_size_limit);
+        add_to_eviction_list(shard, record);
+        auto& cache = shard.owner;
+        auto const desired_size = cache.config.unused_size_limit;
+        if (cache.reaper)
+        {
+            // Leave the eviction to the background thread.
+            if (needs_eviction(cache, desired_size))
+            {
+                cache.reaper->wake_up();
+            }
+            return;
+        }
+        reduce_memory_cache_size_impl(shard, desired_size, unlinked);
+        if (cache.shards.size() > 1)
+        {
+            reduce_other_shards_size(shard, desired_size, unlinked);
+        }
     }
 }
 
 void
 add_lock_to_cache_record(immutable_cache_record& record)
 {
-    auto& cache = *record.owner_cache;
+    auto& shard = *record.owner_shard;
     ++record.lock_count;
     if (record.lock_count == 1 && record.cas_record != nullptr)
     {
-        auto& cas = cache.cas;
+        auto& cas = shard.cas;
         cas.add_lock(*record.cas_record);
     }
 }
@@ -89,20 +325,273 @@ add_lock_to_cache_record(immutable_cache_record& record)
 void
 del_lock_from_cache_record(immutable_cache_record& record)
 {
-    auto& cache = *record.owner_cache;
+    auto& shard = *record.owner_shard;
     --record.lock_count;
     if (record.lock_count == 0 && record.cas_record != nullptr)
     {
-        auto& cas = cache.cas;
+        auto& cas = shard.cas;
         cas.del_lock(*record.cas_record);
     }
 }
 
+bool
+exceeds_total_size_limit(immutable_cache_impl const& cache)
+{
+    auto const limit = cache.config.total_size_limit;
+    return limit != 0
+           && cache.total_size.load(std::memory_order_relaxed) > limit;
+}
+
+bool
+wait_for_total_size_limit(
+    immutable_cache_impl& cache,
+    std::chrono::milliseconds timeout,
+    function_view<bool()> const& stop)
+{
+    std::unique_lock lock(cache.admission_mutex);
+    ++cache.admission_waiters;
+    cache.admission_cv.wait_for(lock, timeout, [&] {
+        return !exceeds_total_size_limit(cache) || stop();
+    });
+    --cache.admission_waiters;
+    return !exceeds_total_size_limit(cache);
+}
+
+void
+enforce_total_size_limit(
+    immutable_cache_shard& shard, unlinked_records& unlinked)
+{
+    auto& cache = shard.owner;
+    if (!exceeds_total_size_limit(cache))
+    {
+        return;
+    }
+    if (cache.reaper)
+    {
+        cache.reaper->wake_up();
+        return;
+    }
+    auto const desired_size = cache.config.unused_size_limit;
+    reduce_memory_cache_size_impl(shard, desired_size, unlinked);
+    if (cache.shards.size() > 1)
+    {
+        reduce_other_shards_size(shard, desired_size, unlinked);
+    }
+}
+
 void
 reduce_memory_cache_size(immutable_cache_impl& cache, uint64_t desired_size)
 {
-    std::scoped_lock<std::mutex> lock(cache.mutex);
-    reduce_memory_cache_size_impl(cache, desired_size);
+    for (auto& shard : cache.shards)
+    {
+        // Destroy the evicted records after releasing the mutex.
+        unlinked_records unlinked;
+        std::scoped_lock lock(shard->mutex);
+        reduce_memory_cache_size_impl(*shard, desired_size, unlinked);
+    }
+}
+
+namespace {
+
+// Hands out a CAS record that was created beforehand (outside the shard's
+// mutex).
+class ready_cas_record_maker : public cas_record_maker_intf
+{
+ public:
+    explicit ready_cas_record_maker(std::unique_ptr<cas_record_base>& record)
+        : record_{record}
+    {
+    }
+
+    std::unique_ptr<cas_record_base>
+    operator()() const override
+    {
+        return std::move(record_);
+    }
+
+ private:
+    std::unique_ptr<cas_record_base>& record_;
+};
+
+} // namespace
+
+void
+promote_from_cold_tier(
+    immutable_cache_shard& shard,
+    immutable_cache_record& record,
+    std::unique_lock<shard_mutex>& lock,
+    unlinked_records& unlinked)
+{
+    assert(record.cold_record);
+    assert(!record.promoting);
+    auto cold_record = std::move(record.cold_record);
+    shard.cold_list.erase(shard.cold_list.iterator_to(record));
+    auto const cold_size = cold_record->deep_size();
+    shard.cold_total_size -= cold_size;
+    shard.owner.total_cold_size -= cold_size;
+    auto const& digest = cold_record->digest();
+    std::unique_ptr<cas_record_base> hot_record;
+    if (!shard.cas.contains(digest))
+    {
+        // Decompress outside the mutex. Meanwhile, the record is on neither
+        // the eviction list nor the cold list, so it cannot be evicted;
+        // other acquisitions wait until it has been promoted.
+        record.promoting = true;
+        lock.unlock();
+        try
+        {
+            hot_record = cold_record->decompress();
+        }
+        catch (...)
+        {
+        }
+        lock.lock();
+        record.promoting = false;
+        shard.promotion_cv.notify_all();
+        if (!hot_record)
+        {
+            record.state = immutable_cache_entry_state::FAILED;
+            unlinked.cas_records.push_back(std::move(cold_record));
+            return;
+        }
+    }
+    // The shard's CAS may have got a record for the digest in the meantime;
+    // if so, hot_record is not used.
+    record.cas_record
+        = &shard.cas.ensure_record(digest, ready_cas_record_maker(hot_record));
+    if (hot_record)
+    {
+        unlinked.cas_records.push_back(std::move(hot_record));
+    }
+    unlinked.cas_records.push_back(std::move(cold_record));
+}
+
+void
+clear_unused_records(immutable_cache_impl& cache)
+{
+    for (auto& shard : cache.shards)
+    {
+        // Destroy the evicted records after releasing the mutex.
+        unlinked_records unlinked;
+        std::scoped_lock lock(shard->mutex);
+        reduce_memory_cache_size_impl(*shard, 0, unlinked, false);
+        for (auto& record : shard->cold_list)
+        {
+            auto node = shard->records.extract(&*record.key);
+            unlinked.ac_records.push_back(std::move(node.mapped()));
+        }
+        shard->cold_list.clear();
+        cache.total_cold_size -= shard->cold_total_size;
+        shard->cold_total_size = 0;
+    }
+}
+
+immutable_cache_shard::immutable_cache_shard(immutable_cache_impl& owner)
+    : owner{owner}, cas{owner.total_size, owner.total_unlocked_size}
+{
+}
+
+immutable_cache_impl::immutable_cache_impl(immutable_cache_config config)
+    : config{std::move(config)}
+{
+    auto num_shards = std::max(this->config.num_shards, std::size_t{1});
+    shards.reserve(num_shards);
+    for (std::size_t i = 0; i < num_shards; ++i)
+    {
+        shards.push_back(std::make_unique<immutable_cache_shard>(*this));
+    }
+    if (this->config.background_eviction)
+    {
+        reaper = std::make_unique<cache_reaper>(*this);
+    }
+}
+
+// Stops the reaper thread (if any) before the shards are destroyed.
+immutable_cache_impl::~immutable_cache_impl() = default;
+
+unlinked_records::~unlinked_records()
+{
+    for (auto& entry : demoted)
+    {
+        auto const size_limit
+            = entry.ac_record->owner_shard->owner.config.cold_tier_size_limit;
+        std::unique_ptr<compressed_cas_record> cold_record;
+        try
+        {
+            cold_record
+                = std::make_unique<compressed_cas_record>(*entry.value);
+        }
+        catch (...)
+        {
+            // Not being able to keep the value is no reason to fail.
+            continue;
+        }
+        if (cold_record->deep_size() <= size_limit)
+        {
+            link_cold_record(entry, std::move(cold_record), *this);
+        }
+    }
+}
+
+
+namespace {
+
+byte_vector
+compress_blob(blob const& serialized)
+{
+    byte_vector compressed(lz4::max_compressed_size(serialized.size()));
+    auto compressed_size = lz4::compress(
+        compressed.data(),
+        compressed.size(),
+        serialized.data(),
+        serialized.size());
+    compressed.resize(compressed_size);
+    compressed.shrink_to_fit();
+    return compressed;
+}
+
+} // namespace
+
+compressed_cas_record::compressed_cas_record(
+    cas_record_base const& hot_record)
+    : compressed_cas_record(
+        hot_record, hot_record.codec()->serialize(hot_record))
+{
+}
+
+compressed_cas_record::compressed_cas_record(
+    cas_record_base const& hot_record, blob const& serialized)
+    : compressed_cas_record(
+        hot_record, serialized.size(), compress_blob(serialized))
+{
+}
+
+compressed_cas_record::compressed_cas_record(
+    cas_record_base const& hot_record,
+    std::size_t serialized_size,
+    byte_vector compressed)
+    : cas_record_base(hot_record.digest(), compressed.size()),
+      serialized_size_{serialized_size},
+      data_{std::move(compressed)}
+{
+    set_codec(hot_record.codec());
+}
+
+std::unique_ptr<cas_record_base>
+compressed_cas_record::decompress() const
+{
+    byte_vector serialized(serialized_size_);
+    auto actual_size = lz4::decompress(
+        serialized.data(), serialized.size(), data_.data(), data_.size());
+    if (actual_size != serialized_size_)
+    {
+        // Corrupt data
+        CRADLE_THROW(lz4_error());
+    }
+    auto record
+        = codec()->deserialize(digest(), make_blob(std::move(serialized)));
+    record->set_codec(codec());
+    return record;
 }
 
 std::size_t
@@ -126,20 +615,25 @@ cas_cache::ensure_record(
     auto new_record = record_maker();
     auto& ret_value = *new_record;
     total_size_ += new_record->deep_size();
+    global_total_size_ += new_record->deep_size();
+    global_unlocked_size_ += new_record->deep_size();
     [[maybe_unused]] auto [_, inserted]
         = map_.insert(std::make_pair(digest, std::move(new_record)));
     assert(inserted);
     return ret_value;
 }
 
-void
+cas_cache::record_ptr_type
 cas_cache::del_record(cas_record_base const& record)
 {
     assert(record.ref_count() == 0);
     assert(record.lock_count() == 0);
     total_size_ -= record.deep_size();
-    [[maybe_unused]] auto num_deleted = map_.erase(record.digest());
-    assert(num_deleted == 1);
+    global_total_size_ -= record.deep_size();
+    global_unlocked_size_ -= record.deep_size();
+    auto node = map_.extract(record.digest());
+    assert(!node.empty());
+    return std::move(node.mapped());
 }
 
 void
@@ -149,6 +643,7 @@ cas_cache::add_lock(cas_record_base& record)
     if (record.lock_count() == 1)
     {
         total_locked_size_ += record.deep_size();
+        global_unlocked_size_ -= record.deep_size();
     }
 }
 
@@ -159,6 +654,7 @@ cas_cache::del_lock(cas_record_base& record)
     if (record.lock_count() == 0)
     {
         total_locked_size_ -= record.deep_size();
+        global_unlocked_size_ += record.deep_size();
     }
 }
 
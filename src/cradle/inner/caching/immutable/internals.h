@@ -1,13 +1,22 @@
 #ifndef CRADLE_INNER_CACHING_IMMUTABLE_INTERNALS_H
 #define CRADLE_INNER_CACHING_IMMUTABLE_INTERNALS_H
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <list>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/intrusive/list.hpp>
+#include <boost/intrusive/set.hpp>
 #include <cppcoro/shared_task.hpp>
 
 #include <cradle/inner/caching/immutable/cache.h>
@@ -18,8 +27,12 @@ namespace cradle {
 
 namespace detail {
 
+class cache_reaper;
 struct immutable_cache_impl;
+struct immutable_cache_shard;
 class cas_record_base;
+class compressed_cas_record;
+struct unlinked_records;
 
 /*
  * A record in the Action Cache.
@@ -27,10 +40,10 @@ class cas_record_base;
 struct immutable_cache_record : public boost::intrusive::list_base_hook<>
 {
     // These remain constant for the life of the record.
-    immutable_cache_impl* owner_cache;
+    immutable_cache_shard* owner_shard;
     captured_id key;
 
-    // All of the following fields are protected by the cache mutex, i.e.,
+    // All of the following fields are protected by the shard mutex, i.e.,
     // should be accessed only while holding that mutex.
 
     // This is a count of how many active pointers (immutable_cache_pointer or
@@ -48,6 +61,20 @@ struct immutable_cache_record : public boost::intrusive::list_base_hook<>
     boost::intrusive::list<immutable_cache_record>::iterator
         eviction_list_iterator;
 
+    // Links the record in the shard's priority set while it is on the
+    // eviction list; used by the GDSF eviction policy only.
+    boost::intrusive::set_member_hook<> priority_hook;
+
+    // GDSF priority, calculated when the record was put on the eviction
+    // list; records with a lower priority are evicted first.
+    double eviction_priority{0};
+
+    // Number of times the record was found in the cache.
+    int hit_count = 0;
+
+    // How long it took to resolve the value; set together with cas_record.
+    std::chrono::nanoseconds resolve_time{};
+
     // Is the data ready?
     immutable_cache_entry_state state = immutable_cache_entry_state::LOADING;
 
@@ -57,17 +84,30 @@ struct immutable_cache_record : public boost::intrusive::list_base_hook<>
     cppcoro::shared_task<void> task;
 
     // Reference to the CAS record, valid (non-null) after the task has run
-    // (i.e., a co_await on the task has finished).
+    // (i.e., a co_await on the task has finished), unless the record is in
+    // the cold tier.
     cas_record_base* cas_record{nullptr};
+
+    // Set (and cas_record reset) while the record is in the cold tier; the
+    // record is then on the shard's cold list, not on its eviction list.
+    // A cold record owns its compressed value; identical values resulting
+    // from different requests are not shared in the cold tier.
+    std::unique_ptr<compressed_cas_record> cold_record;
+
+    // Set while the record's value is being restored from the cold tier,
+    // outside the shard's mutex; see promote_from_cold_tier().
+    bool promoting{false};
 };
 
 // Indicates that a pointer started referring to the given record.
 void
 add_ref_to_cache_record(immutable_cache_record& record);
 
-// Indicates that a pointer stopped referring to the given record.
+// Indicates that a pointer stopped referring to the given record. Any records
+// evicted as a consequence are put in :unlinked.
 void
-del_ref_from_cache_record(immutable_cache_record& record);
+del_ref_from_cache_record(
+    immutable_cache_record& record, unlinked_records& unlinked);
 
 // Adds a lock to the given record. Must be paired with an
 // add_ref_to_cache_record() call.
@@ -100,6 +140,49 @@ typedef std::unordered_map<
 using cache_record_eviction_list
     = boost::intrusive::list<immutable_cache_record>;
 
+struct cache_record_priority_less
+{
+    bool
+    operator()(
+        immutable_cache_record const& a, immutable_cache_record const& b) const
+    {
+        return a.eviction_priority < b.eviction_priority;
+    }
+};
+
+/*
+ * With the GDSF eviction policy, the records in the eviction list are also
+ * in a priority set, ordered by ascending eviction priority. Records having
+ * the same priority are ordered by insertion time, so that these are evicted
+ * in LRU order.
+ */
+using cache_record_priority_set = boost::intrusive::multiset<
+    immutable_cache_record,
+    boost::intrusive::member_hook<
+        immutable_cache_record,
+        boost::intrusive::set_member_hook<>,
+        &immutable_cache_record::priority_hook>,
+    boost::intrusive::compare<cache_record_priority_less>>;
+
+/*
+ * Converts values stored in CAS records to and from a serialized form,
+ * allowing them to be kept in the cold tier.
+ * A CAS record has a codec only if its value type is serializable.
+ */
+class cas_value_codec
+{
+ public:
+    using digest_type = unique_hasher::result_t;
+
+    virtual ~cas_value_codec() = default;
+
+    virtual blob
+    serialize(cas_record_base const& record) const = 0;
+
+    virtual std::unique_ptr<cas_record_base>
+    deserialize(digest_type const& digest, blob const& serialized) const = 0;
+};
+
 /*
  * Untyped base class for a record in the CAS.
  *
@@ -132,6 +215,20 @@ class cas_record_base
         return deep_size_;
     }
 
+    // Returns the codec for this record's value, or nullptr if the value
+    // cannot be serialized.
+    cas_value_codec const*
+    codec() const
+    {
+        return codec_;
+    }
+
+    void
+    set_codec(cas_value_codec const* codec)
+    {
+        codec_ = codec;
+    }
+
     // Returns the number of AC records (locked or not) referencing this CAS
     // record.
     int
@@ -176,6 +273,7 @@ class cas_record_base
  private:
     digest_type digest_;
     std::size_t deep_size_;
+    cas_value_codec const* codec_{nullptr};
     int ref_count_{1};
     int lock_count_{0};
 };
@@ -218,6 +316,34 @@ class cas_record : public cas_record_base
     alignas(Value) char value_storage_[sizeof(Value)];
 };
 
+/*
+ * A CAS record in the cold tier: the record's value serialized by its codec,
+ * and compressed with LZ4. The deep size is the size of the compressed data.
+ */
+class compressed_cas_record : public cas_record_base
+{
+ public:
+    // Throws if the value cannot be serialized or compressed.
+    explicit compressed_cas_record(cas_record_base const& hot_record);
+
+    // Recreates the record holding the (typed) value; throws if the data
+    // cannot be decompressed or deserialized.
+    std::unique_ptr<cas_record_base>
+    decompress() const;
+
+ private:
+    compressed_cas_record(
+        cas_record_base const& hot_record, blob const& serialized);
+
+    compressed_cas_record(
+        cas_record_base const& hot_record,
+        std::size_t serialized_size,
+        byte_vector compressed);
+
+    std::size_t serialized_size_;
+    byte_vector data_;
+};
+
 /*
  * Factory of cas_record_base objects
  *
@@ -244,21 +370,28 @@ class cas_record_maker : public cas_record_maker_intf
  public:
     using digest_type = cas_record_base::digest_type;
 
-    cas_record_maker(digest_type const& digest, Value&& value)
-        : digest_{digest}, value_{std::move(value)}
+    // codec is optional; it should have static storage duration.
+    cas_record_maker(
+        digest_type const& digest,
+        Value&& value,
+        cas_value_codec const* codec = nullptr)
+        : digest_{digest}, value_{std::move(value)}, codec_{codec}
     {
     }
 
     std::unique_ptr<cas_record_base>
     operator()() const override
     {
-        return std::make_unique<detail::cas_record<Value>>(
+        auto record = std::make_unique<detail::cas_record<Value>>(
             digest_, std::move(value_));
+        record->set_codec(codec_);
+        return record;
     }
 
  private:
     digest_type const& digest_;
     Value&& value_;
+    cas_value_codec const* codec_;
 };
 
 /*
@@ -273,6 +406,17 @@ class cas_cache
     using map_type
         = std::unordered_map<digest_type, record_ptr_type, cas_record_hash>;
 
+    // global_total_size and global_unlocked_size track the total size and
+    // total unlocked size over all CAS slices in the cache (one per shard);
+    // this slice adds its share to them.
+    cas_cache(
+        std::atomic<std::size_t>& global_total_size,
+        std::atomic<std::size_t>& global_unlocked_size)
+        : global_total_size_{global_total_size},
+          global_unlocked_size_{global_unlocked_size}
+    {
+    }
+
     // Ensure that a record exists for the given value, with the given digest.
     // If a record for the digest already exists, increases the record's
     // reference count and returns a reference to that object.
@@ -284,7 +428,9 @@ class cas_cache
     ensure_record(
         digest_type const& digest, cas_record_maker_intf const& record_maker);
 
-    void
+    // Removes the record from the CAS, and returns it to the caller, who
+    // decides when to destroy it.
+    record_ptr_type
     del_record(cas_record_base const& record);
 
     void
@@ -293,6 +439,12 @@ class cas_cache
     void
     del_lock(cas_record_base& record);
 
+    bool
+    contains(digest_type const& digest) const
+    {
+        return map_.contains(digest);
+    }
+
     int
     num_records() const
     {
@@ -326,27 +478,216 @@ class cas_cache
     map_type map_;
     std::size_t total_size_{0};
     std::size_t total_locked_size_{0};
+    std::atomic<std::size_t>& global_total_size_;
+    std::atomic<std::size_t>& global_unlocked_size_;
 };
 
-struct immutable_cache_impl
+/*
+ * Mutex protecting a cache shard, keeping track of how often it was acquired,
+ * and how often an acquisition had to wait for another thread.
+ * Satisfies the Lockable requirements, so can be used with std::scoped_lock.
+ */
+class shard_mutex
 {
-    immutable_cache_config config;
+ public:
+    void
+    lock()
+    {
+        if (!mutex_.try_lock())
+        {
+            num_contended_.fetch_add(1, std::memory_order_relaxed);
+            mutex_.lock();
+        }
+        num_acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool
+    try_lock()
+    {
+        if (!mutex_.try_lock())
+        {
+            return false;
+        }
+        num_acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void
+    unlock()
+    {
+        mutex_.unlock();
+    }
+
+    uint64_t
+    num_acquisitions() const
+    {
+        return num_acquisitions_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t
+    num_contended() const
+    {
+        return num_contended_.load(std::memory_order_relaxed);
+    }
+
+ private:
+    std::mutex mutex_;
+    std::atomic<uint64_t> num_acquisitions_{0};
+    std::atomic<uint64_t> num_contended_{0};
+};
+
+/*
+ * A shard of the memory cache: a subset of the AC records (selected by the
+ * hash of their key), with their own eviction list and their own slice of the
+ * CAS, all protected by the shard's own mutex.
+ *
+ * As the CAS is sliced per shard, identical values resulting from requests
+ * in different shards are stored once per shard.
+ */
+struct immutable_cache_shard
+{
+    explicit immutable_cache_shard(immutable_cache_impl& owner);
+
+    immutable_cache_impl& owner;
     cache_record_map records;
     cache_record_eviction_list eviction_list;
+    cache_record_priority_set priority_set;
+    // GDSF clock: the priority of the most recently evicted record
+    double eviction_clock{0};
     cas_cache cas;
-    std::mutex mutex;
+    // AC records in the cold tier, in LRU order
+    cache_record_eviction_list cold_list;
+    // Total size of the compressed values of the records in cold_list
+    std::size_t cold_total_size{0};
+    shard_mutex mutex;
+    // Notified (under mutex) when a record has been promoted from the cold
+    // tier.
+    std::condition_variable_any promotion_cv;
     int hit_count{0};
+    int cold_hit_count{0};
     int miss_count{0};
 };
 
-// Evict unused entries (in LRU order) until the total size of unused entries
-// in the cache is at most :desired_size (in bytes).
+/*
+ * An AC record selected for the cold tier, unlinked from its shard while its
+ * value is being compressed.
+ */
+struct demoted_record
+{
+    std::unique_ptr<immutable_cache_record> ac_record;
+    // The record's value; owned by the same unlinked_records object.
+    cas_record_base const* value;
+};
+
+/*
+ * Records that have been unlinked from a shard, but not yet destroyed.
+ * Destroying a record holding a large value may take time, which should
+ * preferably not happen while holding the shard's mutex. The same goes for
+ * compressing the values of records demoted to the cold tier: this happens
+ * on destruction, after which the demoted records are linked into their
+ * shard's cold tier again.
+ * So an object must be destroyed while not holding any shard mutex.
+ */
+struct unlinked_records
+{
+    unlinked_records() = default;
+    unlinked_records(unlinked_records const&) = delete;
+    unlinked_records&
+    operator=(unlinked_records const&) = delete;
+
+    ~unlinked_records();
+
+    std::vector<std::unique_ptr<immutable_cache_record>> ac_records;
+    std::vector<std::unique_ptr<cas_record_base>> cas_records;
+    std::vector<demoted_record> demoted;
+};
+
+struct immutable_cache_impl
+    : public std::enable_shared_from_this<immutable_cache_impl>
+{
+    explicit immutable_cache_impl(immutable_cache_config config);
+
+    ~immutable_cache_impl();
+
+    // Returns the shard that holds (or will hold) the AC record for key.
+    immutable_cache_shard&
+    shard_for(id_interface const& key)
+    {
+        return *shards[key.hash() % shards.size()];
+    }
+
+    immutable_cache_config config;
+    // The total deep size of all CAS records (over all shards); the total
+    // size limit from the config applies to this amount.
+    std::atomic<std::size_t> total_size{0};
+    // The total deep size of all CAS records (over all shards) that are
+    // referred to by unlocked AC records only; the size limit from the config
+    // applies to this amount.
+    std::atomic<std::size_t> total_unlocked_size{0};
+    // The total size of the compressed values in the cold tier (over all
+    // shards); limited by the cold_tier_size_limit from the config.
+    std::atomic<std::size_t> total_cold_size{0};
+    // The number of calculations delayed by the total size limit
+    std::atomic<int> throttled_count{0};
+    // Calculations delayed by the total size limit wait on admission_cv
+    // (blocking), or in eviction_waiters (suspended coroutines); both are
+    // notified when values are evicted. admission_waiters counts all of
+    // them, so that evictions needn't take the mutex if there are none.
+    std::mutex admission_mutex;
+    std::condition_variable admission_cv;
+    std::map<std::uint64_t, std::function<void()>> eviction_waiters;
+    std::uint64_t next_eviction_waiter_id{0};
+    std::atomic<int> admission_waiters{0};
+    std::vector<std::unique_ptr<immutable_cache_shard>> shards;
+    // Evicts unused records in the background; set only if the config asks
+    // for background eviction. Must be destroyed before the shards.
+    std::unique_ptr<cache_reaper> reaper;
+};
+
+// Evict unused entries (in the order defined by the eviction policy, per
+// shard) until the total size of unused entries in the cache is at most
+// :desired_size (in bytes).
 // The cache doesn't know which entries are in use, so the criterion is instead
 // based on the total size of all unlocked entries (entries that are not
 // referred to by a locked AC record).
 void
 reduce_memory_cache_size(immutable_cache_impl& cache, uint64_t desired_size);
 
+// Returns true if the total size of the cache exceeds the configured limit.
+bool
+exceeds_total_size_limit(immutable_cache_impl const& cache);
+
+// See wait_for_total_size_limit(immutable_cache&, ...)
+bool
+wait_for_total_size_limit(
+    immutable_cache_impl& cache,
+    std::chrono::milliseconds timeout,
+    function_view<bool()> const& stop);
+
+// Called, with the shard's mutex held, after a value was added to the
+// shard's CAS slice: if the total size limit is exceeded, evicts unused
+// records from the shard. The evicted records are put in :unlinked.
+void
+enforce_total_size_limit(
+    immutable_cache_shard& shard, unlinked_records& unlinked);
+
+// Evicts all unused records, including those in the cold tier.
+void
+clear_unused_records(immutable_cache_impl& cache);
+
+// Moves a record from the cold tier back to the hot tier, decompressing its
+// value unless the shard's CAS already holds it. Should be called while
+// holding the shard's mutex through :lock; the mutex is released while
+// decompressing, and held again on return. Records and values to be
+// destroyed are put in :unlinked. If the value cannot be restored, the
+// record's state is set to FAILED, so that the value will be resolved again.
+void
+promote_from_cold_tier(
+    immutable_cache_shard& shard,
+    immutable_cache_record& record,
+    std::unique_lock<shard_mutex>& lock,
+    unlinked_records& unlinked);
+
 } // namespace detail
 } // namespace cradle
 
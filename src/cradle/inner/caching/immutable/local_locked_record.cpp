@@ -10,18 +10,20 @@ local_locked_cache_record::local_locked_cache_record(
     detail::immutable_cache_record& record)
     : record_{record}
 {
-    auto& cache = *record_.owner_cache;
-    std::scoped_lock<std::mutex> lock(cache.mutex);
+    auto& shard = *record_.owner_shard;
+    std::scoped_lock lock(shard.mutex);
     detail::add_ref_to_cache_record(record_);
     detail::add_lock_to_cache_record(record_);
 }
 
 local_locked_cache_record::~local_locked_cache_record()
 {
-    auto& cache = *record_.owner_cache;
-    std::scoped_lock<std::mutex> lock(cache.mutex);
+    auto& shard = *record_.owner_shard;
+    // Destroy any evicted records after releasing the mutex.
+    detail::unlinked_records unlinked;
+    std::scoped_lock lock(shard.mutex);
     detail::del_lock_from_cache_record(record_);
-    detail::del_ref_from_cache_record(record_);
+    detail::del_ref_from_cache_record(record_, unlinked);
 }
 
 } // namespace cradle
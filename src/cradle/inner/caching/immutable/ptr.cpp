@@ -14,23 +14,45 @@ acquire_cache_record(
     untyped_immutable_cache_ptr& ptr,
     create_task_function_t const& create_task)
 {
-    std::scoped_lock<std::mutex> lock(cache.mutex);
-    cache_record_map::iterator i = cache.records.find(&*key);
-    if (i != cache.records.end())
+    auto& shard = cache.shard_for(*key);
+    // Destroy any values released by a promotion after releasing the mutex.
+    unlinked_records unlinked;
+    std::unique_lock lock(shard.mutex);
+    cache_record_map::iterator i = shard.records.find(&*key);
+    // A record being promoted from the cold tier by another thread may be
+    // gone once that is done, so look it up again.
+    while (i != shard.records.end() && i->second->promoting)
     {
-        cache.hit_count += 1;
+        shard.promotion_cv.wait(lock);
+        i = shard.records.find(&*key);
+    }
+    if (i != shard.records.end())
+    {
+        auto& existing_record = *i->second;
+        if (existing_record.cold_record)
+        {
+            shard.cold_hit_count += 1;
+            promote_from_cold_tier(shard, existing_record, lock, unlinked);
+            // Other threads may have modified the map in the meantime.
+            i = shard.records.find(&*key);
+        }
+        else
+        {
+            shard.hit_count += 1;
+        }
+        existing_record.hit_count += 1;
     }
     else
     {
-        cache.miss_count += 1;
+        shard.miss_count += 1;
         auto record = std::make_unique<immutable_cache_record>();
-        record->owner_cache = &cache;
-        record->eviction_list_iterator = cache.eviction_list.end();
+        record->owner_shard = &shard;
+        record->eviction_list_iterator = shard.eviction_list.end();
         record->key = key;
         record->ref_count = 0;
         record->lock_count = 0;
         record->task = create_task(ptr);
-        i = cache.records.emplace(&*record->key, std::move(record)).first;
+        i = shard.records.emplace(&*record->key, std::move(record)).first;
     }
     immutable_cache_record* record = i->second.get();
     // TODO: Better (optional) retry logic.
@@ -43,6 +65,23 @@ acquire_cache_record(
     return record;
 }
 
+cache_record_pin::cache_record_pin(immutable_cache_record& record)
+    : cache_{record.owner_shard->owner.shared_from_this()}, record_{record}
+{
+    auto& shard = *record_.owner_shard;
+    std::scoped_lock lock(shard.mutex);
+    add_ref_to_cache_record(record_);
+}
+
+cache_record_pin::~cache_record_pin()
+{
+    auto& shard = *record_.owner_shard;
+    // Destroy any evicted records after releasing the mutex.
+    unlinked_records unlinked;
+    std::scoped_lock lock(shard.mutex);
+    del_ref_from_cache_record(record_, unlinked);
+}
+
 } // namespace detail
 
 untyped_immutable_cache_ptr::untyped_immutable_cache_ptr(
@@ -56,34 +95,47 @@ untyped_immutable_cache_ptr::untyped_immutable_cache_ptr(
 
 untyped_immutable_cache_ptr::~untyped_immutable_cache_ptr()
 {
-    auto& cache = *record_.owner_cache;
-    std::scoped_lock<std::mutex> lock(cache.mutex);
-    detail::del_ref_from_cache_record(record_);
+    auto& shard = *record_.owner_shard;
+    // Destroy any evicted records after releasing the mutex.
+    detail::unlinked_records unlinked;
+    std::scoped_lock lock(shard.mutex);
+    detail::del_ref_from_cache_record(record_, unlinked);
 }
 
 void
 untyped_immutable_cache_ptr::record_value_untyped(
     detail::cas_record_base::digest_type const& digest,
-    detail::cas_record_maker_intf const& record_maker)
+    detail::cas_record_maker_intf const& record_maker,
+    std::chrono::nanoseconds resolve_time)
 {
-    auto& cache = *record_.owner_cache;
-    std::scoped_lock<std::mutex> lock(cache.mutex);
+    auto& shard = *record_.owner_shard;
+    // Destroy any evicted records after releasing the mutex.
+    detail::unlinked_records unlinked;
+    std::scoped_lock lock(shard.mutex);
     assert(record_.state == immutable_cache_entry_state::LOADING);
     record_.state = immutable_cache_entry_state::READY;
+    record_.resolve_time = resolve_time;
     assert(record_.cas_record == nullptr);
-    auto& cas_record = cache.cas.ensure_record(digest, record_maker);
+    auto& cas_record = shard.cas.ensure_record(digest, record_maker);
     record_.cas_record = &cas_record;
     if (record_.lock_count > 0)
     {
-        cache.cas.add_lock(cas_record);
+        shard.cas.add_lock(cas_record);
     }
+    detail::enforce_total_size_limit(shard, unlinked);
+}
+
+digest_algorithm
+untyped_immutable_cache_ptr::digest_algo() const
+{
+    return record_.owner_shard->owner.config.algorithm;
 }
 
 void
 untyped_immutable_cache_ptr::record_failure()
 {
-    auto& cache = *record_.owner_cache;
-    std::scoped_lock<std::mutex> lock(cache.mutex);
+    auto& shard = *record_.owner_shard;
+    std::scoped_lock lock(shard.mutex);
     // Alternatively, make state atomic
     record_.state = immutable_cache_entry_state::FAILED;
 }
@@ -1,6 +1,9 @@
 #ifndef CRADLE_INNER_CACHING_IMMUTABLE_PTR_H
 #define CRADLE_INNER_CACHING_IMMUTABLE_PTR_H
 
+#include <chrono>
+#include <memory>
+
 #include <cppcoro/shared_task.hpp>
 
 #include <cradle/inner/caching/immutable/cache.h>
@@ -16,8 +19,30 @@ struct immutable_cache;
 
 namespace detail {
 
+struct immutable_cache_impl;
 struct immutable_cache_record;
 
+// Keeps an AC record in use, like an immutable_cache_ptr does: the record
+// (and the CAS record it refers to) will not be evicted while this object
+// exists. The record's cache is kept alive too, even if the
+// immutable_cache owning it is reset.
+class cache_record_pin
+{
+ public:
+    explicit cache_record_pin(immutable_cache_record& record);
+
+    ~cache_record_pin();
+
+    cache_record_pin(cache_record_pin const&) = delete;
+    cache_record_pin&
+    operator=(cache_record_pin const&)
+        = delete;
+
+ private:
+    std::shared_ptr<immutable_cache_impl> cache_;
+    immutable_cache_record& record_;
+};
+
 } // namespace detail
 
 using ensure_value_task_t = cppcoro::shared_task<void>;
@@ -101,6 +126,10 @@ class untyped_immutable_cache_ptr
     void
     record_failure();
 
+    // The algorithm for the digests of the values in the cache
+    digest_algorithm
+    digest_algo() const;
+
  protected:
     // the internal cache record for the entry
     detail::immutable_cache_record& record_;
@@ -108,7 +137,8 @@ class untyped_immutable_cache_ptr
     void
     record_value_untyped(
         detail::cas_record_base::digest_type const& digest,
-        detail::cas_record_maker_intf const& record_maker);
+        detail::cas_record_maker_intf const& record_maker,
+        std::chrono::nanoseconds resolve_time);
 };
 
 // immutable_cache_ptr<T> represents one's interest in a particular immutable
@@ -125,18 +155,44 @@ class immutable_cache_ptr : public untyped_immutable_cache_ptr
  public:
     using untyped_immutable_cache_ptr::untyped_immutable_cache_ptr;
 
+    // resolve_time is how long it took to obtain the value; the GDSF
+    // eviction policy tends to retain values that were expensive to obtain.
+    // codec is needed for the value to go to the cold tier; it should have
+    // static storage duration.
     void
-    record_value(Value&& value)
+    record_value(
+        Value&& value,
+        std::chrono::nanoseconds resolve_time = {},
+        detail::cas_value_codec const* codec = nullptr)
     {
-        unique_hasher hasher;
+        unique_hasher hasher{digest_algo()};
         update_unique_hash(hasher, value);
         auto digest{hasher.get_result()};
         record_value_untyped(
-            digest, detail::cas_record_maker(digest, std::move(value)));
+            digest,
+            detail::cas_record_maker(digest, std::move(value), codec),
+            resolve_time);
     }
 
     Value
     get_value() const
+    {
+        return get_value_ref();
+    }
+
+    // Returns a pointer to the value in the cache, avoiding a copy.
+    // The pointer (and its copies) keep the value in the cache, so the
+    // pointer may outlive this object.
+    std::shared_ptr<Value const>
+    get_shared_value() const
+    {
+        auto pin = std::make_shared<detail::cache_record_pin>(record_);
+        return std::shared_ptr<Value const>(std::move(pin), &get_value_ref());
+    }
+
+ private:
+    Value const&
+    get_value_ref() const
     {
         assert(record_.cas_record != nullptr);
         using typed_cas_record = detail::cas_record<Value>;
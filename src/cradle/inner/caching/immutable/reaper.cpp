@@ -0,0 +1,48 @@
+#include <cradle/inner/caching/immutable/internals.h>
+#include <cradle/inner/caching/immutable/reaper.h>
+
+namespace cradle {
+
+namespace detail {
+
+cache_reaper::cache_reaper(immutable_cache_impl& cache)
+    : cache_{cache}, thread_{[this](std::stop_token stoken) { run(stoken); }}
+{
+}
+
+void
+cache_reaper::wake_up()
+{
+    {
+        std::scoped_lock lock{mutex_};
+        woken_up_ = true;
+    }
+    cv_.notify_one();
+}
+
+void
+cache_reaper::run(std::stop_token stoken)
+{
+    auto const& config = cache_.config;
+    uint64_t low_watermark
+        = config.unused_size_limit * config.low_watermark_percentage / 100;
+    for (;;)
+    {
+        {
+            std::unique_lock lock{mutex_};
+            if (!cv_.wait(lock, stoken, [this] { return woken_up_; }))
+            {
+                // Stop requested
+                return;
+            }
+            woken_up_ = false;
+        }
+        // Locks each shard in turn, and destroys the evicted records
+        // after releasing the shard's mutex.
+        reduce_memory_cache_size(cache_, low_watermark);
+    }
+}
+
+} // namespace detail
+
+} // namespace cradle
@@ -0,0 +1,44 @@
+#ifndef CRADLE_INNER_CACHING_IMMUTABLE_REAPER_H
+#define CRADLE_INNER_CACHING_IMMUTABLE_REAPER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace cradle {
+
+namespace detail {
+
+struct immutable_cache_impl;
+
+// Evicts unused records from the memory cache in a background thread, and
+// destroys them, without the thread that released them having to wait for
+// that.
+class cache_reaper
+{
+ public:
+    explicit cache_reaper(immutable_cache_impl& cache);
+
+    // Requests the thread to bring the total size of unused records down to
+    // the cache's low watermark.
+    // Can be called while holding a shard mutex.
+    void
+    wake_up();
+
+ private:
+    immutable_cache_impl& cache_;
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    bool woken_up_{false};
+    // Note: ~jthread calls request_stop() then join()
+    std::jthread thread_;
+
+    void
+    run(std::stop_token stoken);
+};
+
+} // namespace detail
+
+} // namespace cradle
+
+#endif
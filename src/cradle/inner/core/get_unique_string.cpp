@@ -12,4 +12,12 @@ get_unique_string(id_interface const& id)
     return hasher.get_string();
 }
 
+std::string
+get_unique_string(id_interface const& id, digest_algorithm algo)
+{
+    unique_hasher hasher{algo};
+    id.update_hash(hasher);
+    return hasher.get_string();
+}
+
 } // namespace cradle
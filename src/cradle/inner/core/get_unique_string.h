@@ -15,6 +15,16 @@ get_unique_string_tmpl(auto const& value)
     return hasher.get_string();
 }
 
+// Variant using a specific digest algorithm, e.g. to satisfy an external
+// storage that checks digests itself.
+std::string
+get_unique_string_tmpl(auto const& value, digest_algorithm algo)
+{
+    unique_hasher hasher{algo};
+    update_unique_hash(hasher, value);
+    return hasher.get_string();
+}
+
 // Get a string that is unique for the given ID (based on its hash).
 // The primary purpose of these strings is to act as keys in the disk cache.
 // A disk cache item corresponds to a request, either old-style (Thinknode),
@@ -46,6 +56,11 @@ struct id_interface;
 std::string
 get_unique_string(id_interface const& id);
 
+// Variant using a specific digest algorithm, typically the one from
+// inner_resources::digest_algo().
+std::string
+get_unique_string(id_interface const& id, digest_algorithm algo);
+
 } // namespace cradle
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef CRADLE_INNER_CORE_TYPE_DEFINITIONS_H
 #define CRADLE_INNER_CORE_TYPE_DEFINITIONS_H
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -26,12 +28,47 @@ some(T&& x)
 
 typedef std::vector<std::uint8_t> byte_vector;
 
+// A digest over a range of bytes; see unique_hash.h.
+struct memoized_digest
+{
+    std::byte const* data{};
+    std::size_t size{};
+    // A digest_algorithm value
+    std::uint8_t algorithm{};
+    std::array<std::uint8_t, 32> value{};
+};
+
 // Owns the data to which a blob refers.
 class data_owner
 {
  public:
     virtual ~data_owner() = default;
 
+    // Returns the digest memoized over (part of) the owned data, if any.
+    // See update_unique_hash(unique_hasher&, blob const&); the data must not
+    // be modified anymore once a digest has been memoized.
+    memoized_digest const*
+    get_memoized_digest() const noexcept
+    {
+        return digest_state_.load(std::memory_order_acquire) == digest_ready
+                   ? &digest_
+                   : nullptr;
+    }
+
+    // Memoizes a digest over (part of) the owned data; a no-op if a digest
+    // has been memoized already.
+    void
+    memoize_digest(memoized_digest const& digest) const noexcept
+    {
+        auto expected{digest_empty};
+        if (digest_state_.compare_exchange_strong(
+                expected, digest_writing, std::memory_order_relaxed))
+        {
+            digest_ = digest;
+            digest_state_.store(digest_ready, std::memory_order_release);
+        }
+    }
+
     // Returns a pointer to the data. Throws if not supported.
     virtual std::uint8_t*
     data()
@@ -63,6 +100,14 @@ class data_owner
     on_write_completed()
     {
     }
+
+ private:
+    static constexpr std::uint8_t digest_empty{0};
+    static constexpr std::uint8_t digest_writing{1};
+    static constexpr std::uint8_t digest_ready{2};
+
+    mutable std::atomic<std::uint8_t> digest_state_{digest_empty};
+    mutable memoized_digest digest_;
 };
 
 // A blob represents a sequence of bytes. It is intended to be immutable: once
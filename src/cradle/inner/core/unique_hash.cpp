@@ -1,7 +1,73 @@
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <new>
+
+#include <BS_thread_pool.hpp>
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+
 #include <cradle/inner/core/unique_hash.h>
 
 namespace cradle {
 
+std::string
+to_string(digest_algorithm algo)
+{
+    switch (algo)
+    {
+        case digest_algorithm::SHA256:
+            return "sha256";
+        case digest_algorithm::XXH3_128:
+            return "xxh3_128";
+    }
+    return "unknown";
+}
+
+std::optional<digest_algorithm>
+parse_digest_algorithm(std::string const& name)
+{
+    if (name == "sha256")
+    {
+        return digest_algorithm::SHA256;
+    }
+    if (name == "xxh3_128")
+    {
+        return digest_algorithm::XXH3_128;
+    }
+    return std::nullopt;
+}
+
+static_assert(
+    get_digest_size(digest_algorithm::XXH3_128) == sizeof(XXH128_canonical_t));
+
+// Returns the XXH3 state living in the hasher's xxh3_state_ storage.
+static XXH3_state_t*
+get_xxh3_state(std::byte* storage)
+{
+    return std::launder(reinterpret_cast<XXH3_state_t*>(storage));
+}
+
+unique_hasher::unique_hasher(digest_algorithm algo) : algo_{algo}
+{
+    if (algo_ == digest_algorithm::SHA256)
+    {
+        SHA256_Init(&sha256_ctx_);
+    }
+    else
+    {
+        static_assert(sizeof(XXH3_state_t) <= xxh3_state_size);
+        static_assert(alignof(XXH3_state_t) <= xxh3_state_alignment);
+        XXH3_128bits_reset(new (xxh3_state_) XXH3_state_t);
+    }
+}
+
+void
+unique_hasher::xxh3_update(void const* data, size_t len)
+{
+    XXH3_128bits_update(get_xxh3_state(xxh3_state_), data, len);
+}
+
 std::string
 unique_hasher::get_string()
 {
@@ -9,10 +75,11 @@ unique_hasher::get_string()
 
     // This low-level code is much (say, 40x) faster than an implementation
     // based on std::ostringstream or fmt::format.
-    std::string s(result_size * 2, '?');
+    std::size_t const digest_size{get_digest_size(algo_)};
+    std::string s(digest_size * 2, '?');
     char* p = s.data();
     // Clang completely unrolls this loop.
-    for (std::size_t i = 0; i < result_size; ++i)
+    for (std::size_t i = 0; i < digest_size; ++i)
     {
         static const char x[] = "0123456789abcdef";
         uint8_t val = result_.data()[i];
@@ -27,11 +94,93 @@ unique_hasher::finish()
 {
     if (!finished_)
     {
-        SHA256_Final(result_.data(), &ctx_);
+        if (algo_ == digest_algorithm::SHA256)
+        {
+            SHA256_Final(result_.data(), &sha256_ctx_);
+        }
+        else
+        {
+            XXH128_canonical_t canonical;
+            XXH128_canonicalFromHash(
+                &canonical,
+                XXH3_128bits_digest(get_xxh3_state(xxh3_state_)));
+            static_assert(sizeof(canonical) <= result_size);
+            std::memcpy(result_.data(), &canonical, sizeof(canonical));
+            std::memset(
+                result_.data() + sizeof(canonical),
+                0,
+                result_size - sizeof(canonical));
+        }
         finished_ = true;
     }
 }
 
+// The pool hashing the leaves of a tree hash; it has a thread per core.
+static BS::thread_pool&
+get_tree_hash_pool()
+{
+    static BS::thread_pool the_pool;
+    return the_pool;
+}
+
+void
+update_unique_hash_tree(
+    unique_hasher& hasher,
+    void const* data,
+    std::size_t size,
+    unsigned max_concurrency)
+{
+    auto const* bytes = static_cast<unsigned char const*>(data);
+    std::size_t const num_leaves
+        = (size + tree_hash_leaf_size - 1) / tree_hash_leaf_size;
+    std::vector<unique_hasher::result_t> leaf_results(num_leaves);
+    auto const algo = hasher.algorithm();
+    auto hash_leaves = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            std::size_t const offset = i * tree_hash_leaf_size;
+            unique_hasher leaf_hasher{algo};
+            leaf_hasher.encode_bytes(
+                bytes + offset, std::min(tree_hash_leaf_size, size - offset));
+            leaf_results[i] = leaf_hasher.get_result();
+        }
+    };
+
+    // Split the leaves into contiguous blocks, one per thread. The calling
+    // thread hashes the first block itself, instead of just waiting.
+    auto& pool = get_tree_hash_pool();
+    std::size_t num_threads = pool.get_thread_count() + 1;
+    if (max_concurrency > 0)
+    {
+        num_threads = std::min<std::size_t>(num_threads, max_concurrency);
+    }
+    std::size_t const num_blocks
+        = std::max<std::size_t>(std::min(num_leaves, num_threads), 1);
+    auto block_begin = [&](std::size_t block) {
+        return block * num_leaves / num_blocks;
+    };
+    std::vector<std::future<void>> futures;
+    futures.reserve(num_blocks - 1);
+    for (std::size_t block = 1; block < num_blocks; ++block)
+    {
+        auto begin = block_begin(block);
+        auto end = block_begin(block + 1);
+        futures.push_back(pool.submit_task(
+            [&hash_leaves, begin, end] { hash_leaves(begin, end); }));
+    }
+    hash_leaves(0, block_begin(1));
+    for (auto& future : futures)
+    {
+        future.get();
+    }
+
+    update_unique_hash(hasher, uint64_t{size});
+    for (auto const& leaf_result : leaf_results)
+    {
+        hasher.combine(leaf_result);
+    }
+}
+
 void
 update_unique_hash(unique_hasher& hasher, std::string const& val)
 {
@@ -44,12 +193,62 @@ update_unique_hash(unique_hasher& hasher, char const* val)
     hasher.encode_bytes(val, std::strlen(val));
 }
 
+static std::atomic<std::size_t> the_avoided_hash_bytes{0};
+
+std::size_t
+get_avoided_hash_bytes()
+{
+    return the_avoided_hash_bytes.load(std::memory_order_relaxed);
+}
+
+// Returns the digest over a plain blob's data, memoizing it in the blob's
+// owner.
+static unique_hasher::result_t
+get_blob_digest(blob const& val, digest_algorithm algo)
+{
+    static_assert(
+        sizeof(memoized_digest::value) == sizeof(unique_hasher::result_t));
+    auto const algo_value{static_cast<std::uint8_t>(algo)};
+    auto const* owner = val.owner();
+    if (owner)
+    {
+        auto const* memo = owner->get_memoized_digest();
+        if (memo && memo->data == val.data() && memo->size == val.size()
+            && memo->algorithm == algo_value)
+        {
+            the_avoided_hash_bytes.fetch_add(
+                val.size(), std::memory_order_relaxed);
+            return memo->value;
+        }
+    }
+    unique_hasher blob_hasher{algo};
+    if (val.size() >= tree_hash_threshold)
+    {
+        update_unique_hash_tree(blob_hasher, val.data(), val.size());
+    }
+    else
+    {
+        blob_hasher.encode_bytes(val.data(), val.size());
+    }
+    auto result{blob_hasher.get_result()};
+    if (owner)
+    {
+        owner->memoize_digest(
+            memoized_digest{val.data(), val.size(), algo_value, result});
+    }
+    return result;
+}
+
 void
 update_unique_hash(unique_hasher& hasher, blob const& val)
 {
     // A tag byte is used to distinguish between:
-    // - A plain blob, where the hash is calculated over the blob data.
+    // - A small plain blob, where the hash is calculated over the blob data.
     // - A blob file, where the hash is calculated over the file path.
+    // - A large plain blob, where the hash is calculated over the blob's
+    //   tree hash.
+    // - A medium-sized plain blob, where the hash is calculated over the
+    //   blob's digest.
     // Without the tag, a hash over a plain blob containing something that
     // looks like a file path might be equal to the hash over a blob file.
     if (auto const* owner = val.mapped_file_data_owner())
@@ -58,6 +257,12 @@ update_unique_hash(unique_hasher& hasher, blob const& val)
         auto path{owner->mapped_file()};
         hasher.encode_bytes(path.data(), path.size());
     }
+    else if (val.size() >= blob_digest_threshold)
+    {
+        bool const tree{val.size() >= tree_hash_threshold};
+        update_unique_hash(hasher, tree ? uint8_t{0x02} : uint8_t{0x03});
+        hasher.combine(get_blob_digest(val, hasher.algorithm()));
+    }
     else
     {
         update_unique_hash(hasher, uint8_t{0x00});
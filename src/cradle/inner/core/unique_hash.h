@@ -6,6 +6,7 @@
 #include <concepts>
 #include <cstddef>
 #include <cstring>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -15,6 +16,33 @@
 
 namespace cradle {
 
+// The algorithms that a unique_hasher can use.
+enum class digest_algorithm
+{
+    // SHA-256 (OpenSSL); a 256-bit cryptographic hash.
+    SHA256,
+    // XXH3 (xxHash), 128-bit variant; non-cryptographic, but much faster,
+    // especially on small inputs. The probability of an accidental collision
+    // is still negligible.
+    XXH3_128,
+};
+
+// Returns the name of algo, as used in configurations and persisted caches.
+std::string
+to_string(digest_algorithm algo);
+
+// Parses a name returned by to_string(digest_algorithm); returns std::nullopt
+// for an unknown name.
+std::optional<digest_algorithm>
+parse_digest_algorithm(std::string const& name);
+
+// Returns the number of bytes in a digest calculated with algo.
+constexpr std::size_t
+get_digest_size(digest_algorithm algo)
+{
+    return algo == digest_algorithm::SHA256 ? SHA256_DIGEST_LENGTH : 16;
+}
+
 // Creates a cryptographic-strength hash value that should prevent collisions
 // between different items written to the disk cache.
 // The hash function is assumed to be so strong that collisions will not occur
@@ -23,19 +51,38 @@ class unique_hasher
 {
  public:
     using byte_t = unsigned char;
+    // The size of a result_t, large enough for any algorithm. A result
+    // calculated with a smaller digest has its remaining bytes set to zero.
     static constexpr size_t result_size = SHA256_DIGEST_LENGTH;
     using result_t = std::array<unsigned char, result_size>;
 
-    unique_hasher()
+    // A default-constructed hasher uses SHA-256. Code that hashes on behalf
+    // of an inner_resources object should use that object's algorithm
+    // instead (see inner_resources::digest_algo()).
+    unique_hasher() : unique_hasher(digest_algorithm::SHA256)
+    {
+    }
+
+    explicit unique_hasher(digest_algorithm algo);
+
+    digest_algorithm
+    algorithm() const
     {
-        SHA256_Init(&ctx_);
+        return algo_;
     }
 
     void
     encode_bytes(void const* data, size_t len)
     {
         assert(!finished_);
-        SHA256_Update(&ctx_, data, len);
+        if (algo_ == digest_algorithm::SHA256)
+        {
+            SHA256_Update(&sha256_ctx_, data, len);
+        }
+        else
+        {
+            xxh3_update(data, len);
+        }
     }
 
     void
@@ -77,7 +124,20 @@ class unique_hasher
     void
     finish();
 
-    SHA256_CTX ctx_;
+    void
+    xxh3_update(void const* data, size_t len);
+
+    // Storage for an XXH3_state_t, keeping xxHash out of this header; the
+    // size and alignment are checked in unique_hash.cpp.
+    static constexpr std::size_t xxh3_state_size = 576;
+    static constexpr std::size_t xxh3_state_alignment = 64;
+
+    digest_algorithm algo_;
+    union
+    {
+        SHA256_CTX sha256_ctx_;
+        alignas(xxh3_state_alignment) std::byte xxh3_state_[xxh3_state_size];
+    };
     result_t result_;
     bool finished_{false};
 };
@@ -97,9 +157,39 @@ update_unique_hash(unique_hasher& hasher, std::string const& val);
 void
 update_unique_hash(unique_hasher& hasher, char const* val);
 
+// A plain blob of at least this size is hashed via its own digest, which is
+// memoized in the blob's data owner; so each buffer is hashed at most once.
+inline constexpr std::size_t blob_digest_threshold{0x10'00};
+
+// Blobs of at least this size are hashed as a tree, via
+// update_unique_hash_tree().
+inline constexpr std::size_t tree_hash_threshold{0x40'00'00};
+
+// The size of a leaf in a tree hash (except the last one).
+inline constexpr std::size_t tree_hash_leaf_size{0x10'00'00};
+
+// Updates hasher with the size of the data plus the digests over fixed-size
+// leaves of the data. The leaves are hashed concurrently, on a dedicated
+// thread pool plus the calling thread, using at most max_concurrency threads;
+// 0 means all threads.
+// Leaf digests use the hasher's algorithm. The result differs from the one
+// calculated by a plain encode_bytes() over the same data.
+void
+update_unique_hash_tree(
+    unique_hasher& hasher,
+    void const* data,
+    std::size_t size,
+    unsigned max_concurrency = 0);
+
+// A large plain blob is hashed as a tree; see tree_hash_threshold.
 void
 update_unique_hash(unique_hasher& hasher, blob const& val);
 
+// Returns the total number of bytes that did not need to be hashed, in this
+// process, thanks to a memoized blob digest.
+std::size_t
+get_avoided_hash_bytes();
+
 void
 update_unique_hash(unique_hasher& hasher, byte_vector const& val);
 
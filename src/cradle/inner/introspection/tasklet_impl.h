@@ -183,6 +183,12 @@ class tasklet_admin
     void
     set_capturing_enabled(bool enabled);
 
+    bool
+    capturing_enabled() const
+    {
+        return capturing_enabled_;
+    }
+
     void
     set_logging_enabled(bool enabled);
 
@@ -113,4 +113,10 @@ introspection_clear_info(tasklet_admin& admin)
     admin.clear_info();
 }
 
+async_queue_depths
+introspection_get_async_queue_depths(async_scheduler& scheduler)
+{
+    return scheduler.get_queue_depths();
+}
+
 } // namespace cradle
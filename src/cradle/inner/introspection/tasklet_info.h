@@ -7,6 +7,7 @@
 #include <vector>
 
 #include <cradle/inner/introspection/tasklet.h>
+#include <cradle/inner/service/async_scheduler.h>
 
 namespace cradle {
 
@@ -162,6 +163,13 @@ introspection_set_logging_enabled(tasklet_admin& admin, bool enabled);
 void
 introspection_clear_info(tasklet_admin& admin);
 
+/**
+ * Retrieves the number of asynchronous work items waiting to be run, per
+ * priority
+ */
+async_queue_depths
+introspection_get_async_queue_depths(async_scheduler& scheduler);
+
 } // namespace cradle
 
 #endif
@@ -1,5 +1,6 @@
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <stdexcept>
 
 #include <cppcoro/sync_wait.hpp>
@@ -10,6 +11,7 @@
 #include <cradle/inner/remote/wait_async.h>
 #include <cradle/inner/requests/context_base.h>
 #include <cradle/inner/requests/test_context.h>
+#include <cradle/inner/service/resolve_durations.h>
 #include <cradle/inner/service/resources.h>
 
 namespace cradle {
@@ -175,12 +177,43 @@ subs_available_matcher::operator()(async_status status) const
 
 } // namespace
 
-local_tree_context_base::local_tree_context_base(inner_resources& resources)
+local_tree_context_base::local_tree_context_base(
+    inner_resources& resources, async_scheduling scheduling)
     : resources_{resources},
       ctoken_{csource_.token()},
       logger_{spdlog::get("cradle")},
-      the_data_owner_factory_{resources}
+      the_data_owner_factory_{resources},
+      scheduling_{std::move(scheduling)}
 {
+    if (scheduling_.deadline)
+    {
+        auto& scheduler{resources.the_async_scheduler()};
+        deadline_key_ = scheduler.request_cancellation_at(
+            *scheduling_.deadline, csource_);
+    }
+}
+
+local_tree_context_base::~local_tree_context_base()
+{
+    if (deadline_key_)
+    {
+        resources_.the_async_scheduler().drop_deadline(*deadline_key_);
+    }
+}
+
+bool
+local_tree_context_base::cancel_if_past_deadline() noexcept
+{
+    if (!scheduling_.deadline || async_clock::now() < *scheduling_.deadline)
+    {
+        return false;
+    }
+    if (!past_deadline_.exchange(true))
+    {
+        logger_->info("local_tree_context_base: past deadline, cancelling");
+        csource_.request_cancellation();
+    }
+    return true;
 }
 
 std::shared_ptr<data_owner>
@@ -356,13 +389,37 @@ local_async_context_base::reschedule_if_opportune()
             reschedule);
         if (reschedule)
         {
-            auto& thread_pool{get_resources().get_async_thread_pool()};
-            co_await thread_pool.schedule();
+            auto& resources{get_resources()};
+            co_await resources.the_async_scheduler().schedule(
+                tree_ctx_.get_scheduling(), predict_remaining_path());
         }
     }
+    // Don't start a calculation past the deadline (which may have passed
+    // while waiting in the scheduler's queue).
+    if (tree_ctx_.cancel_if_past_deadline())
+    {
+        throw_async_cancelled();
+    }
     co_return;
 }
 
+std::chrono::microseconds
+local_async_context_base::predict_remaining_path() const
+{
+    // This request's function still has to run, followed by those of its
+    // ancestors.
+    auto& durations{tree_ctx_.get_resources().the_resolve_durations()};
+    std::chrono::microseconds remaining{};
+    for (auto const* ctx = this; ctx; ctx = ctx->parent_)
+    {
+        if (ctx->essentials_)
+        {
+            remaining += durations.predict(ctx->essentials_->uuid_str);
+        }
+    }
+    return remaining;
+}
+
 bool
 local_async_context_base::decide_reschedule_sub()
 {
@@ -413,6 +470,7 @@ local_async_context_base::update_status_error(std::string const& errmsg)
 bool
 local_async_context_base::is_cancellation_requested() const noexcept
 {
+    tree_ctx_.cancel_if_past_deadline();
     auto token{tree_ctx_.get_cancellation_token()};
     return token.is_cancellation_requested();
 }
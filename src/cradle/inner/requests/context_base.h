@@ -2,9 +2,11 @@
 #define CRADLE_INNER_REQUEST_CONTEXT_BASE_H
 
 #include <atomic>
+#include <chrono>
 #include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <vector>
 
 #include <cppcoro/cancellation_registration.hpp>
@@ -16,6 +18,7 @@
 #include <cradle/inner/remote/proxy.h>
 #include <cradle/inner/requests/generic.h>
 #include <cradle/inner/requests/test_context.h>
+#include <cradle/inner/service/async_scheduler.h>
 #include <cradle/inner/service/resources.h>
 
 /*
@@ -138,7 +141,8 @@ class sync_context_base : public virtual local_sync_context_intf,
  * same context tree (relating to the same root request).
  *
  * In particular, it owns a cppcoro::cancellation_source object, which is
- * shared by all contexts in the tree.
+ * shared by all contexts in the tree; and the scheduling parameters (priority
+ * and deadline) that all contexts in the tree inherit.
  *
  * Note that an object of this class must not be re-used across multiple
  * context trees.
@@ -146,7 +150,11 @@ class sync_context_base : public virtual local_sync_context_intf,
 class local_tree_context_base
 {
  public:
-    local_tree_context_base(inner_resources& resources);
+    local_tree_context_base(
+        inner_resources& resources, async_scheduling scheduling = {});
+
+    // Drops the deadline registration, if any.
+    ~local_tree_context_base();
 
     // Once created, these objects should not be moved.
     local_tree_context_base(local_tree_context_base const&) = delete;
@@ -176,6 +184,16 @@ class local_tree_context_base
         return ctoken_;
     }
 
+    async_scheduling const&
+    get_scheduling() const
+    {
+        return scheduling_;
+    }
+
+    // Requests cancellation if the deadline has passed; returns true if so.
+    bool
+    cancel_if_past_deadline() noexcept;
+
     spdlog::logger&
     get_logger() noexcept
     {
@@ -198,6 +216,35 @@ class local_tree_context_base
     cppcoro::cancellation_token ctoken_;
     std::shared_ptr<spdlog::logger> logger_;
     data_owner_factory the_data_owner_factory_;
+    async_scheduling const scheduling_;
+    // Set if the scheduler will cancel the tree at the deadline
+    std::optional<async_scheduler::deadline_key> deadline_key_;
+    std::atomic<bool> past_deadline_{false};
+};
+
+/*
+ * Mixin for a context object owning local context trees (see
+ * local_async_ctx_owner_intf), holding the scheduling parameters for the
+ * trees that it creates.
+ */
+class async_scheduling_context_mixin
+{
+ public:
+    // Sets the priority and deadline for subsequent resolutions.
+    void
+    set_scheduling(async_scheduling const& scheduling)
+    {
+        scheduling_ = scheduling;
+    }
+
+    async_scheduling const&
+    get_scheduling() const
+    {
+        return scheduling_;
+    }
+
+ private:
+    async_scheduling scheduling_;
 };
 
 /*
@@ -330,6 +377,18 @@ class local_async_context_base : public virtual local_async_context_intf,
     void
     update_status_error(std::string const& errmsg) override;
 
+    float
+    get_progress() override
+    {
+        return progress_;
+    }
+
+    void
+    update_progress(float progress) override
+    {
+        progress_ = progress;
+    }
+
     void
     request_cancellation() override
     {
@@ -376,6 +435,7 @@ class local_async_context_base : public virtual local_async_context_intf,
     async_id const id_;
     std::atomic<async_status> status_;
     std::string errmsg_;
+    std::atomic<float> progress_{};
     // Using shared_ptr ensures that local_async_context_base objects are not
     // relocated during tree build-up / visit.
     // It cannot be unique_ptr because there can be two owners: the parent
@@ -396,6 +456,11 @@ class local_async_context_base : public virtual local_async_context_intf,
     bool
     decide_reschedule_sub();
 
+    // Predicts the time from starting this request's function until the
+    // root request finishes (see resolve_durations.h).
+    std::chrono::microseconds
+    predict_remaining_path() const;
+
     void
     cancel_delegate() noexcept;
 };
@@ -1,6 +1,7 @@
 #ifndef CRADLE_INNER_REQUESTS_FUNCTION_H
 #define CRADLE_INNER_REQUESTS_FUNCTION_H
 
+#include <chrono>
 #include <concepts>
 #include <functional>
 #include <memory>
@@ -13,6 +14,8 @@
 
 #include <cereal/types/memory.hpp>
 #include <cereal/types/tuple.hpp>
+#include <cppcoro/static_thread_pool.hpp>
+#include <cppcoro/sync_wait.hpp>
 #include <cppcoro/task.hpp>
 #include <cppcoro/when_all.hpp>
 #include <fmt/format.h>
@@ -27,16 +30,19 @@
 #include <cradle/inner/encodings/msgpack_packer.h>
 #include <cradle/inner/requests/containment_data.h>
 #include <cradle/inner/requests/generic.h>
+#include <cradle/inner/requests/interning.h>
 #include <cradle/inner/requests/normalization_uuid.h>
 #include <cradle/inner/requests/request_props.h>
 #include <cradle/inner/requests/types.h>
 #include <cradle/inner/requests/uuid.h>
 #include <cradle/inner/requests/value.h>
 #include <cradle/inner/resolve/creq_controller.h>
+#include <cradle/inner/resolve/incremental.h>
 #include <cradle/inner/resolve/resolve_impl.h>
 #include <cradle/inner/resolve/resolve_request.h>
 #include <cradle/inner/resolve/seri_registry.h>
 #include <cradle/inner/resolve/seri_resolver.h>
+#include <cradle/inner/service/resolve_durations.h>
 
 namespace cradle {
 
@@ -167,6 +173,27 @@ class function_request_intf : public base_request_intf
 
     virtual cppcoro::task<Value>
     resolve(local_context_intf& ctx, cache_record_lock* lock_ptr) const = 0;
+
+    virtual cppcoro::task<std::shared_ptr<Value const>>
+    resolve_shared(local_context_intf& ctx) const = 0;
+
+    virtual cppcoro::task<Value>
+    resolve_incrementally(
+        local_context_intf& ctx,
+        incremental_graph& graph,
+        incremental_node_ptr const& old_node,
+        incremental_node_ptr& new_node) const = 0;
+
+    virtual bool
+    is_direct_resolvable() const = 0;
+
+    virtual Value
+    resolve_directly(local_context_intf& ctx) const = 0;
+
+    // Returns a copy of this implementation, with containment set; for a
+    // request whose implementation is shared (e.g., interned).
+    virtual std::shared_ptr<function_request_intf>
+    copy_with_containment(containment_data const& containment) const = 0;
 };
 
 template<typename Ctx, typename Args, std::size_t... Ix>
@@ -178,6 +205,34 @@ make_sync_sub_tasks(Ctx& ctx, Args const& args, std::index_sequence<Ix...>)
         resolve_request(ctx, std::get<Ix>(args), constraints)...);
 }
 
+// Resolves arg, which is a subrequest or a plain value; a subrequest is
+// resolved on a thread in pool.
+template<typename Ctx, typename Arg>
+auto
+resolve_sync_sub_on_pool(
+    Ctx& ctx, cppcoro::static_thread_pool& pool, Arg const& arg)
+    -> decltype(resolve_request(ctx, arg, ResolutionConstraintsLocalSync{}))
+{
+    if constexpr (Request<Arg>)
+    {
+        co_await pool.schedule();
+    }
+    co_return co_await resolve_request(
+        ctx, arg, ResolutionConstraintsLocalSync{});
+}
+
+template<typename Ctx, typename Args, std::size_t... Ix>
+auto
+make_parallel_sync_sub_tasks(
+    Ctx& ctx,
+    cppcoro::static_thread_pool& pool,
+    Args const& args,
+    std::index_sequence<Ix...>)
+{
+    return std::make_tuple(
+        resolve_sync_sub_on_pool(ctx, pool, std::get<Ix>(args))...);
+}
+
 template<typename Ctx, typename Args, std::size_t... Ix>
 auto
 make_async_sub_tasks(Ctx& ctx, Args const& args, std::index_sequence<Ix...>)
@@ -187,6 +242,54 @@ make_async_sub_tasks(Ctx& ctx, Args const& args, std::index_sequence<Ix...>)
         ctx.get_local_sub(Ix), std::get<Ix>(args), constraints)...);
 }
 
+// A subrequest that may be resolvable without coroutines (see
+// function_request_impl::resolve_directly()): a request for a plain function
+// that is not retried. Its caching level and introspection are erased, so
+// is_direct_resolvable() tells at runtime if it really is.
+template<typename Arg>
+concept DirectResolvableRequest
+    = Request<Arg> && !Arg::for_coroutine && !Arg::retryable
+      && requires(Arg const& arg, local_context_intf& ctx) {
+             { arg.is_direct_resolvable() } -> std::same_as<bool>;
+             arg.resolve_directly(ctx);
+         };
+
+template<typename Arg>
+inline constexpr bool is_direct_resolvable_arg_v
+    = !Request<Arg> || DirectResolvableRequest<Arg>;
+
+// Returns true if arg, which satisfies is_direct_resolvable_arg_v, can be
+// resolved without coroutines.
+template<typename Arg>
+bool
+is_direct_resolvable_arg(Arg const& arg)
+{
+    if constexpr (Request<Arg>)
+    {
+        return arg.is_direct_resolvable();
+    }
+    else
+    {
+        return true;
+    }
+}
+
+// Resolves arg, which is a DirectResolvableRequest or a plain value, on the
+// current stack.
+template<typename Arg>
+decltype(auto)
+resolve_arg_directly(local_context_intf& ctx, Arg const& arg)
+{
+    if constexpr (Request<Arg>)
+    {
+        return arg.resolve_directly(ctx);
+    }
+    else
+    {
+        return (arg);
+    }
+}
+
 template<typename Tuple, std::size_t... Ix>
 auto
 when_all_wrapper(Tuple&& tasks, std::index_sequence<Ix...>)
@@ -382,12 +485,23 @@ class function_request_impl final
     using ArgIndices = std::index_sequence_for<Args...>;
 
     static constexpr bool func_is_coro = ImplProps::for_local_coroutine;
+    static constexpr std::size_t num_subrequests
+        = (std::size_t{Request<Args>} + ... + 0);
     static constexpr bool func_is_plain
         = std::is_function_v<std::remove_pointer_t<Function>>;
     static constexpr bool introspective = ImplProps::introspective;
     static constexpr caching_level_type caching_level = ImplProps::level;
     static constexpr bool value_based_caching
         = is_value_based(ImplProps::level);
+    // True if the request tree below this request may be resolvable without
+    // coroutines (see resolve_directly()): the function is a plain one, the
+    // request is neither cached nor introspective, and each argument is a
+    // plain value or a subrequest for a plain function. Whether it really is,
+    // depends on the subrequests' erased properties, and on containment;
+    // see is_direct_resolvable().
+    static constexpr bool direct_resolvable
+        = !func_is_coro && is_uncached(ImplProps::level) && !introspective
+          && (is_direct_resolvable_arg_v<Args> && ...);
 
     // The caller ensures that (ignoring const, references and function
     // pointers):
@@ -407,6 +521,7 @@ class function_request_impl final
         static_assert(
             std::
                 is_same_v<std::decay_t<CtorFunction>, std::decay_t<Function>>);
+        update_args_direct_resolvable();
     }
 
     // Constructs an object to be deserialized.
@@ -417,6 +532,19 @@ class function_request_impl final
     {
     }
 
+    // Constructs a copy of other that runs contained.
+    function_request_impl(
+        function_request_impl const& other,
+        containment_data const& containment)
+        : intrsp_mixin_type{static_cast<intrsp_mixin_type const&>(other)},
+          uuid_{other.uuid_},
+          function_{other.function_},
+          args_{other.args_},
+          containment_{std::make_unique<containment_data>(containment)},
+          args_direct_resolvable_{other.args_direct_resolvable_}
+    {
+    }
+
     // Constructs a function_request_impl instantiation object to be
     // deserialized.
     // The type of this function is seri_registry::create_t, so that
@@ -498,9 +626,10 @@ class function_request_impl final
     void
     update_hash(unique_hasher& hasher) const override
     {
-        if (!this->have_unique_hash_)
+        if (!this->have_unique_hash_
+            || this->unique_hash_algo_ != hasher.algorithm())
         {
-            calc_unique_hash();
+            calc_unique_hash(hasher.algorithm());
         }
         hasher.combine(this->unique_hash_);
     }
@@ -555,6 +684,7 @@ class function_request_impl final
     {
         this->load_intrsp_state(archive);
         archive(cereal::make_nvp("args", args_));
+        update_args_direct_resolvable();
         containment_ = containment_data::load(archive);
         auto& resources{archive.get_resources()};
         auto the_seri_registry{resources.get_seri_registry()};
@@ -620,6 +750,7 @@ class function_request_impl final
     {
         this->load_intrsp_state(msgpack_objs[0]);
         msgpack_objs[1].convert(args_);
+        update_args_direct_resolvable();
         containment_ = containment_data::load(msgpack_objs[2]);
         auto& resources{get_current_inner_resources()};
         auto the_seri_registry{resources.get_seri_registry()};
@@ -634,6 +765,91 @@ class function_request_impl final
         return resolve_impl(ctx, *this, lock_ptr);
     }
 
+    cppcoro::task<std::shared_ptr<Value const>>
+    resolve_shared(local_context_intf& ctx) const override
+    {
+        return resolve_impl_shared(ctx, *this);
+    }
+
+    // Resolves this request as part of an incremental resolution (see
+    // incremental.h), setting new_node. old_node is the node at the same
+    // position in the previous graph, or nullptr.
+    cppcoro::task<Value>
+    resolve_incrementally(
+        local_context_intf& ctx,
+        incremental_graph& graph,
+        incremental_node_ptr const& old_node,
+        incremental_node_ptr& new_node) const override
+    {
+        if (old_node && old_node->request.hash() == hash()
+            && old_node->request.matches(*this))
+        {
+            graph.stats().num_unchanged += 1;
+            new_node = old_node;
+            co_return *std::static_pointer_cast<Value const>(old_node->value);
+        }
+        auto node = std::make_shared<incremental_node>();
+        node->request = get_captured_id();
+        node->subs.resize(sizeof...(Args));
+        auto sub_tasks = make_incremental_sub_tasks(
+            ctx, graph, old_node, *node, args_, ArgIndices{});
+        auto sub_results
+            = co_await when_all_wrapper(std::move(sub_tasks), ArgIndices{});
+        auto const algo{ctx.get_resources().digest_algo()};
+        node->inputs_digest = get_incremental_inputs_digest(
+            *node, sub_results, algo, ArgIndices{});
+        if (old_node && node->inputs_digest
+            && old_node->inputs_digest == node->inputs_digest)
+        {
+            graph.stats().num_cut_off += 1;
+            node->value_digest = old_node->value_digest;
+            node->value = old_node->value;
+        }
+        else
+        {
+            graph.stats().num_recomputed += 1;
+            auto value{co_await call_function(ctx, std::move(sub_results))};
+            node->value_digest = get_incremental_value_digest(value, algo);
+            node->value = std::make_shared<Value const>(std::move(value));
+        }
+        new_node = node;
+        co_return *std::static_pointer_cast<Value const>(node->value);
+    }
+
+    // Returns true if the request tree below this request can be resolved
+    // without coroutines: the tree has no coroutine functions, and no
+    // caching, introspection or containment.
+    bool
+    is_direct_resolvable() const override
+    {
+        return !containment_ && args_direct_resolvable_;
+    }
+
+    // Resolves this request synchronously, calling the function on the
+    // current stack instead of from a coroutine; subrequests are resolved
+    // the same way. Should be called only if is_direct_resolvable() returns
+    // true for the root of the tree, and the resources allow direct
+    // resolution.
+    Value
+    resolve_directly(local_context_intf& ctx) const override
+    {
+        if constexpr (direct_resolvable)
+        {
+            return call_function_directly(ctx);
+        }
+        else
+        {
+            throw not_implemented_error{
+                "function_request_impl::resolve_directly()"};
+        }
+    }
+
+    std::shared_ptr<intf_type>
+    copy_with_containment(containment_data const& containment) const override
+    {
+        return std::make_shared<this_type>(*this, containment);
+    }
+
  public: // called from resolve_impl.h
     // TODO should these be in some interface or concept?
 
@@ -717,6 +933,16 @@ class function_request_impl final
         auto sub_tasks = make_sync_sub_tasks(ctx, args_, ArgIndices{});
         auto sub_results
             = co_await when_all_wrapper(std::move(sub_tasks), ArgIndices{});
+        co_return co_await call_contained(ctx, sub_results);
+    }
+
+    // Calls the function in a subprocess, passing the resolved argument
+    // values.
+    template<typename SubResults>
+    cppcoro::task<Value>
+    call_contained(
+        local_context_intf& ctx, SubResults const& sub_results) const
+    {
         creq_controller ctl{containment_->dll_dir_, containment_->dll_name_};
         auto seri_resp = co_await ctl.resolve(
             ctx, serialize_contained_request(sub_results));
@@ -765,10 +991,28 @@ class function_request_impl final
     cppcoro::task<Value>
     resolve_sync_local(local_context_intf& ctx) const
     {
-        // If there is no coroutine function and no caching in the request
-        // tree, there is nothing to co_await on (but how useful would such
-        // a request be?).
-        // TODO consider optimizing resolve() for "simple" request trees
+        // Subrequests are independent, so two or more of them can be
+        // resolved in parallel, if the resources provide a thread pool.
+        if constexpr (num_subrequests > 1)
+        {
+            if (auto* pool = ctx.get_resources().get_sync_thread_pool())
+            {
+                return resolve_sync_parallel(ctx, *pool);
+            }
+        }
+        // If there is no coroutine function, and no caching, introspection
+        // or containment in the request tree, there is nothing to co_await
+        // on, and the tree is resolved without coroutines. Not if
+        // subrequests should be resolved in parallel, as that needs
+        // coroutines further down the tree.
+        if constexpr (direct_resolvable)
+        {
+            if (ctx.get_resources().allows_direct_resolution()
+                && is_direct_resolvable())
+            {
+                return resolve_sync_direct(ctx);
+            }
+        }
         // The std::forward probably doesn't help as all resolve_request()
         // variants take the arg as const&.
         if constexpr (!func_is_coro)
@@ -822,6 +1066,61 @@ class function_request_impl final
         }
     }
 
+    cppcoro::task<Value>
+    resolve_sync_direct(local_context_intf& ctx) const
+    {
+        co_return call_function_directly(ctx);
+    }
+
+    // A plain argument value is passed as const reference, or, if the
+    // function takes it by rvalue reference, as a copy.
+    Value
+    call_function_directly(local_context_intf& ctx) const
+    {
+        return std::apply(
+            [&](auto const&... args) {
+                if constexpr (std::is_invocable_v<
+                                  stored_function_t&,
+                                  decltype(resolve_arg_directly(
+                                      ctx, args))...>)
+                {
+                    return (*function_)(resolve_arg_directly(ctx, args)...);
+                }
+                else
+                {
+                    auto copy = [](auto&& v) {
+                        return std::remove_cvref_t<decltype(v)>(
+                            std::forward<decltype(v)>(v));
+                    };
+                    return (*function_)(
+                        copy(resolve_arg_directly(ctx, args))...);
+                }
+            },
+            args_);
+    }
+
+    // Resolves the subrequests in parallel, each on a thread in pool; the
+    // function is then called on the thread that finished last.
+    cppcoro::task<Value>
+    resolve_sync_parallel(
+        local_context_intf& ctx, cppcoro::static_thread_pool& pool) const
+    {
+        auto sub_tasks
+            = make_parallel_sync_sub_tasks(ctx, pool, args_, ArgIndices{});
+        auto sub_results
+            = co_await when_all_wrapper(std::move(sub_tasks), ArgIndices{});
+        if constexpr (func_is_coro)
+        {
+            co_return co_await std::apply(
+                *function_,
+                std::tuple_cat(std::tie(ctx), std::move(sub_results)));
+        }
+        else
+        {
+            co_return std::apply(*function_, std::move(sub_results));
+        }
+    }
+
     cppcoro::task<Value>
     resolve_sync_non_coro(local_context_intf& ctx) const
     {
@@ -848,6 +1147,19 @@ class function_request_impl final
                     std::move(sub_tasks), ArgIndices{})));
     }
 
+    // Records how long the function itself took, for scheduling the next
+    // resolutions of this request type (see resolve_durations.h).
+    void
+    record_duration(
+        local_async_context_intf& ctx,
+        std::chrono::steady_clock::time_point start) const
+    {
+        ctx.get_resources().the_resolve_durations().record(
+            uuid_.str(),
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start));
+    }
+
     cppcoro::task<Value>
     resolve_async_non_coro(local_async_context_intf& ctx) const
     {
@@ -869,7 +1181,9 @@ class function_request_impl final
             // Rescheduling allows tasks to run in parallel, but is not
             // always opportune
             co_await ctx.reschedule_if_opportune();
+            auto start{std::chrono::steady_clock::now()};
             auto result = std::apply(*function_, std::move(sub_results));
+            record_duration(ctx, start);
             ctx.update_status(async_status::FINISHED);
             co_return result;
         }
@@ -906,9 +1220,11 @@ class function_request_impl final
             // Rescheduling allows tasks to run in parallel, but is not
             // always opportune
             co_await ctx.reschedule_if_opportune();
+            auto start{std::chrono::steady_clock::now()};
             auto result = co_await std::apply(
                 *function_,
                 std::tuple_cat(std::tie(ctx), std::move(sub_results)));
+            record_duration(ctx, start);
             ctx.update_status(async_status::FINISHED);
             co_return result;
         }
@@ -924,6 +1240,62 @@ class function_request_impl final
         }
     }
 
+    // Calls the function, passing the resolved argument values; in a
+    // subprocess if the request is contained.
+    template<typename SubResults>
+    cppcoro::task<Value>
+    call_function(local_context_intf& ctx, SubResults sub_results) const
+    {
+        if (containment_)
+        {
+            co_return co_await call_contained(ctx, sub_results);
+        }
+        if constexpr (!func_is_coro)
+        {
+            co_return std::apply(*function_, std::move(sub_results));
+        }
+        else
+        {
+            if constexpr (sizeof...(Args) == 1)
+            {
+                if constexpr (std::same_as<
+                                  typename first_element<Args...>::type,
+                                  Value>)
+                {
+                    if (is_normalizer())
+                    {
+                        co_return std::get<0>(std::move(sub_results));
+                    }
+                }
+            }
+            co_return co_await std::apply(
+                *function_,
+                std::tuple_cat(std::tie(ctx), std::move(sub_results)));
+        }
+    }
+
+    // Returns the digest over uuid_ and the argument values; node holds the
+    // digests of the values of any function request arguments.
+    template<typename SubResults, std::size_t... Ix>
+    std::optional<unique_hasher::result_t>
+    get_incremental_inputs_digest(
+        incremental_node const& node,
+        SubResults const& sub_results,
+        digest_algorithm algo,
+        std::index_sequence<Ix...>) const
+    {
+        unique_hasher hasher{algo};
+        update_unique_hash(hasher, uuid_);
+        bool hashable = (update_incremental_inputs_digest(
+                             hasher, node.subs[Ix], std::get<Ix>(sub_results))
+                         && ...);
+        if (!hashable)
+        {
+            return std::nullopt;
+        }
+        return hasher.get_result();
+    }
+
     // Shortcuts resolving a request generated by a normalize_arg() call:
     // just return the value that was passed to normalize_arg().
     cppcoro::task<Value>
@@ -953,6 +1325,11 @@ class function_request_impl final
     // Containment data if function should run contained.
     std::unique_ptr<containment_data> containment_;
 
+    // True if direct_resolvable, and each subrequest argument's tree can be
+    // resolved without coroutines. Set once the arguments are known, so that
+    // is_direct_resolvable() needn't walk the tree each time it is called.
+    bool args_direct_resolvable_{false};
+
     // Used when this request's caching level is at least memory; _OR_ if a
     // (direct or indirect) subrequest of a request with such a caching level.
     mutable std::optional<size_t> hash_;
@@ -961,8 +1338,22 @@ class function_request_impl final
     // _OR_ if a (direct or indirect) subrequest of a request with such a
     // caching level; _OR_ when storing the request.
     mutable unique_hasher::result_t unique_hash_;
+    mutable digest_algorithm unique_hash_algo_{};
     mutable bool have_unique_hash_{false};
 
+    void
+    update_args_direct_resolvable()
+    {
+        if constexpr (direct_resolvable)
+        {
+            args_direct_resolvable_ = std::apply(
+                [](auto const&... args) {
+                    return (is_direct_resolvable_arg(args) && ...);
+                },
+                args_);
+        }
+    }
+
     bool
     is_normalizer() const
     {
@@ -970,9 +1361,9 @@ class function_request_impl final
     }
 
     void
-    calc_unique_hash() const
+    calc_unique_hash(digest_algorithm algo) const
     {
-        unique_hasher hasher;
+        unique_hasher hasher{algo};
         update_unique_hash(hasher, uuid_);
         std::apply(
             [&hasher](auto&&... args) {
@@ -980,6 +1371,7 @@ class function_request_impl final
             },
             args_);
         this->unique_hash_ = hasher.get_result();
+        this->unique_hash_algo_ = algo;
         this->have_unique_hash_ = true;
     }
 };
@@ -1036,16 +1428,37 @@ class function_request : public ObjectProps::retrier_type
             make_request_impl_props_type<Props>,
             std::remove_cvref_t<Function>,
             std::remove_cvref_t<Args>...>;
-        impl_ = std::make_shared<impl_type>(
+        auto impl = std::make_shared<impl_type>(
             make_request_impl_props(std::forward<Props>(props)),
             std::forward<Function>(function),
             std::forward<Args>(args)...);
+        // An introspective implementation is not interned: its title is not
+        // part of its identity, so it could end up with the title of another
+        // request.
+        auto* table = get_current_request_interning_table();
+        if (table && !impl_type::introspective)
+        {
+            impl_ = table->intern(std::move(impl));
+        }
+        else
+        {
+            impl_ = std::move(impl);
+        }
     }
 
+    // If the implementation is shared with other requests (e.g., because it
+    // was interned), this request gets its own copy first.
     void
     set_containment(containment_data const& containment)
     {
-        impl_->set_containment(containment);
+        if (impl_.use_count() > 1)
+        {
+            impl_ = impl_->copy_with_containment(containment);
+        }
+        else
+        {
+            impl_->set_containment(containment);
+        }
     }
 
     caching_level_type
@@ -1140,6 +1553,34 @@ class function_request : public ObjectProps::retrier_type
         return impl_->resolve(ctx, lock_ptr);
     }
 
+    cppcoro::task<std::shared_ptr<Value const>>
+    resolve_shared(local_context_intf& ctx) const
+    {
+        return impl_->resolve_shared(ctx);
+    }
+
+    cppcoro::task<Value>
+    resolve_incrementally(
+        local_context_intf& ctx,
+        incremental_graph& graph,
+        incremental_node_ptr const& old_node,
+        incremental_node_ptr& new_node) const
+    {
+        return impl_->resolve_incrementally(ctx, graph, old_node, new_node);
+    }
+
+    bool
+    is_direct_resolvable() const
+    {
+        return impl_->is_direct_resolvable();
+    }
+
+    Value
+    resolve_directly(local_context_intf& ctx) const
+    {
+        return impl_->resolve_directly(ctx);
+    }
+
  public: // Interface for cereal + msgpack
     // Used for creating placeholder subrequests in the catalog;
     // also called when deserializing a subrequest.
@@ -1420,9 +1861,10 @@ class proxy_request_impl final
     void
     update_hash(unique_hasher& hasher) const override
     {
-        if (!this->have_unique_hash_)
+        if (!this->have_unique_hash_
+            || this->unique_hash_algo_ != hasher.algorithm())
         {
-            calc_unique_hash();
+            calc_unique_hash(hasher.algorithm());
         }
         hasher.combine(this->unique_hash_);
     }
@@ -1501,12 +1943,13 @@ class proxy_request_impl final
 
     // Used when storing the request.
     mutable unique_hasher::result_t unique_hash_;
+    mutable digest_algorithm unique_hash_algo_{};
     mutable bool have_unique_hash_{false};
 
     void
-    calc_unique_hash() const
+    calc_unique_hash(digest_algorithm algo) const
     {
-        unique_hasher hasher;
+        unique_hasher hasher{algo};
         update_unique_hash(hasher, uuid_);
         std::apply(
             [&hasher](auto&&... args) {
@@ -1514,6 +1957,7 @@ class proxy_request_impl final
             },
             args_);
         this->unique_hash_ = hasher.get_result();
+        this->unique_hash_algo_ = algo;
         this->have_unique_hash_ = true;
     }
 };
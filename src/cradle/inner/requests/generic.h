@@ -541,6 +541,18 @@ class local_async_context_intf : public virtual local_context_intf,
     update_status_error(std::string const& errmsg)
         = 0;
 
+    // Gets the progress of this task's own calculation, as a fraction between
+    // 0 and 1. Stays 0 unless the request's function reports its progress.
+    virtual float
+    get_progress()
+        = 0;
+
+    // Updates the progress of this task's own calculation; called by a
+    // request function (while the status is SELF_RUNNING).
+    virtual void
+    update_progress(float progress)
+        = 0;
+
     // Requests cancellation of all tasks in the same context tree.
     // This is a non-coroutine version of
     // async_context_intf::request_cancellation_coro().
@@ -780,6 +792,16 @@ class remote_async_ctx_owner_intf : public virtual context_intf
 template<typename Ctx>
 concept Context = std::convertible_to<Ctx&, context_intf&>;
 
+// Context owner that can create a new owner with the same settings, so that
+// several root requests can be resolved at the same time, each in its own
+// context tree (see resolve_requests()).
+template<typename Ctx>
+concept SpawnableContext = requires(Ctx const& ctx) {
+    {
+        ctx.spawn()
+    } -> std::same_as<std::unique_ptr<Ctx>>;
+};
+
 // Context that supports remote resolution
 template<typename Ctx>
 concept RemoteContext = std::convertible_to<Ctx&, remote_context_intf&>;
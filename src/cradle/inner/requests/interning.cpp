@@ -0,0 +1,53 @@
+#include <cradle/inner/requests/interning.h>
+
+namespace cradle {
+
+static thread_local request_interning_table* current_interning_table{
+    nullptr};
+
+std::size_t
+request_interning_table::size() const
+{
+    std::scoped_lock lock{mutex_};
+    return entries_.size();
+}
+
+std::size_t
+request_interning_table::num_hits() const
+{
+    std::scoped_lock lock{mutex_};
+    return num_hits_;
+}
+
+std::shared_ptr<void>
+request_interning_table::intern_untyped(
+    std::shared_ptr<void> owner, id_interface const& id)
+{
+    std::scoped_lock lock{mutex_};
+    auto [it, inserted] = entries_.insert(entry{std::move(owner), &id});
+    if (!inserted)
+    {
+        ++num_hits_;
+    }
+    return it->owner;
+}
+
+request_interning_scope::request_interning_scope(
+    request_interning_table& table)
+    : previous_{current_interning_table}
+{
+    current_interning_table = &table;
+}
+
+request_interning_scope::~request_interning_scope()
+{
+    current_interning_table = previous_;
+}
+
+request_interning_table*
+get_current_request_interning_table()
+{
+    return current_interning_table;
+}
+
+} // namespace cradle
@@ -0,0 +1,112 @@
+#ifndef CRADLE_INNER_REQUESTS_INTERNING_H
+#define CRADLE_INNER_REQUESTS_INTERNING_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include <cradle/inner/core/id.h>
+
+namespace cradle {
+
+/*
+ * Hash-consing of request trees: a table of request implementations, so that
+ * structurally identical (sub)requests share a single implementation object.
+ *
+ * Interning is opt-in: a function_request constructor looks up its
+ * implementation in the table only while a request_interning_scope is active
+ * on the current thread. Two implementations are identical if they compare
+ * equal as id_interface objects: same type, same uuid, and equal arguments.
+ * As subrequests are interned first, comparing arguments mostly comes down
+ * to comparing pointers, and each unique node's hash values are calculated
+ * once only.
+ *
+ * Introspective implementations are not interned, as their titles are not
+ * part of their identity. An interned implementation is shared, so
+ * function_request::set_containment() copies it first.
+ */
+class request_interning_table
+{
+ public:
+    // Returns the implementation in the table that equals impl; if there is
+    // none, adds impl to the table and returns it.
+    template<typename Impl>
+    std::shared_ptr<Impl>
+    intern(std::shared_ptr<Impl> impl)
+    {
+        id_interface const& id{*impl};
+        // An equal implementation must have the same type (Impl).
+        return std::static_pointer_cast<Impl>(
+            intern_untyped(std::move(impl), id));
+    }
+
+    // Returns the number of implementations in the table.
+    std::size_t
+    size() const;
+
+    // Returns the number of intern() calls that returned an existing
+    // implementation.
+    std::size_t
+    num_hits() const;
+
+ private:
+    struct entry
+    {
+        std::shared_ptr<void> owner;
+        id_interface const* id;
+    };
+
+    struct entry_hash
+    {
+        std::size_t
+        operator()(entry const& e) const
+        {
+            return e.id->hash();
+        }
+    };
+
+    struct entry_equal
+    {
+        bool
+        operator()(entry const& a, entry const& b) const
+        {
+            return a.id->equals(*b.id);
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_set<entry, entry_hash, entry_equal> entries_;
+    std::size_t num_hits_{0};
+
+    std::shared_ptr<void>
+    intern_untyped(std::shared_ptr<void> owner, id_interface const& id);
+};
+
+// While an object of this class exists, function_request objects constructed
+// on the current thread intern their implementations in table.
+// Scopes can be nested; the innermost one is active.
+class request_interning_scope
+{
+ public:
+    explicit request_interning_scope(request_interning_table& table);
+
+    ~request_interning_scope();
+
+    request_interning_scope(request_interning_scope const&) = delete;
+    request_interning_scope&
+    operator=(request_interning_scope const&)
+        = delete;
+
+ private:
+    request_interning_table* previous_;
+};
+
+// Returns the table of the active request_interning_scope on the current
+// thread, or nullptr if there is none.
+request_interning_table*
+get_current_request_interning_table();
+
+} // namespace cradle
+
+#endif
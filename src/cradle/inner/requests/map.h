@@ -0,0 +1,285 @@
+#ifndef CRADLE_INNER_REQUESTS_MAP_H
+#define CRADLE_INNER_REQUESTS_MAP_H
+
+// Map requests: applying a function to each element of a vector
+//
+// Expressing "apply f to each of 10,000 elements" with plain function
+// requests takes 10,000 function_request objects, each with its own hash,
+// cache record, context and coroutine frame. A map request is a single
+// function_request whose function applies f to each element of a vector:
+// - The whole result is cached like any function_request's result, according
+//   to the request's caching level.
+// - If that level is not "none", each element's result is cached in the
+//   memory cache as well, under a key derived from the request's uuid and the
+//   element; so a changed vector recalculates the new elements only.
+// - The elements are processed in batches, which run in parallel on the
+//   resources' async scheduler, with the priority and deadline of the
+//   resolution (if asynchronous). An asynchronous resolution can be
+//   cancelled between batches.
+// - Each batch is a tasklet, a child of the context's current tasklet (if
+//   introspection is enabled). In an asynchronous resolution, the request's
+//   progress (the fraction of elements done) is updated after each batch.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <cppcoro/shared_task.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/when_all.hpp>
+#include <fmt/format.h>
+
+#include <cradle/inner/caching/immutable/ptr.h>
+#include <cradle/inner/core/hash.h>
+#include <cradle/inner/core/id.h>
+#include <cradle/inner/core/unique_hash.h>
+#include <cradle/inner/introspection/tasklet.h>
+#include <cradle/inner/requests/cast_ctx.h>
+#include <cradle/inner/requests/context_base.h>
+#include <cradle/inner/requests/function.h>
+#include <cradle/inner/requests/generic.h>
+#include <cradle/inner/requests/uuid.h>
+#include <cradle/inner/service/async_scheduler.h>
+#include <cradle/inner/service/resources.h>
+
+namespace cradle {
+
+// The number of elements in a batch; one batch runs on one thread.
+inline constexpr std::size_t map_batch_size{256};
+
+namespace detail {
+
+// The memory cache key for the result of applying a map request's function
+// to one element.
+template<typename Elem>
+class map_element_id : public id_interface
+{
+ public:
+    // uuid_hash is invoke_hash(*uuid), calculated once for all elements.
+    map_element_id(
+        std::shared_ptr<request_uuid const> uuid,
+        std::size_t uuid_hash,
+        Elem elem)
+        : uuid_{std::move(uuid)}, uuid_hash_{uuid_hash}, elem_{std::move(elem)}
+    {
+    }
+
+    bool
+    equals(id_interface const& other) const override
+    {
+        auto const& other_id = static_cast<map_element_id const&>(other);
+        return (uuid_ == other_id.uuid_ || *uuid_ == *other_id.uuid_)
+               && elem_ == other_id.elem_;
+    }
+
+    bool
+    less_than(id_interface const& other) const override
+    {
+        auto const& other_id = static_cast<map_element_id const&>(other);
+        if (uuid_ != other_id.uuid_ && *uuid_ != *other_id.uuid_)
+        {
+            return *uuid_ < *other_id.uuid_;
+        }
+        return elem_ < other_id.elem_;
+    }
+
+    size_t
+    hash() const override
+    {
+        return combine_hashes(uuid_hash_, invoke_hash(elem_));
+    }
+
+    void
+    update_hash(unique_hasher& hasher) const override
+    {
+        update_unique_hash(hasher, *uuid_);
+        update_unique_hash(hasher, elem_);
+    }
+
+ private:
+    std::shared_ptr<request_uuid const> uuid_;
+    std::size_t uuid_hash_;
+    Elem elem_;
+};
+
+} // namespace detail
+
+/*
+ * The function of a map request: applies Function to each element of a
+ * vector. Function is a plain (non-coroutine) function taking one element.
+ */
+template<typename Function>
+class map_function
+{
+ public:
+    map_function(
+        request_uuid const& uuid, Function function, bool cache_elements)
+        : uuid_{std::make_shared<request_uuid const>(uuid)},
+          uuid_hash_{invoke_hash(uuid)},
+          function_{std::move(function)},
+          cache_elements_{cache_elements}
+    {
+    }
+
+    template<typename Ctx, typename Elem>
+    cppcoro::task<std::vector<std::invoke_result_t<Function const&, Elem>>>
+    operator()(Ctx& ctx, std::vector<Elem> elems) const
+    {
+        using result_type = std::invoke_result_t<Function const&, Elem>;
+        auto& scheduler{ctx.get_resources().the_async_scheduler()};
+        async_scheduling scheduling;
+        if (auto* actx = dynamic_cast<local_async_context_base*>(&ctx))
+        {
+            scheduling = actx->get_tree_context().get_scheduling();
+        }
+        std::atomic<std::size_t> num_done{};
+        std::vector<cppcoro::task<std::vector<result_type>>> batches;
+        for (std::size_t begin = 0; begin < elems.size();
+             begin += map_batch_size)
+        {
+            auto end = std::min(begin + map_batch_size, elems.size());
+            batches.push_back(map_batch(
+                ctx, scheduler, scheduling, elems, begin, end, num_done));
+        }
+        auto batch_results = co_await cppcoro::when_all(std::move(batches));
+        std::vector<result_type> results;
+        results.reserve(elems.size());
+        for (auto& batch_result : batch_results)
+        {
+            std::move(
+                batch_result.begin(),
+                batch_result.end(),
+                std::back_inserter(results));
+        }
+        co_return results;
+    }
+
+ private:
+    std::shared_ptr<request_uuid const> uuid_;
+    std::size_t uuid_hash_;
+    Function function_;
+    bool cache_elements_;
+
+    template<typename Ctx, typename Elem>
+    cppcoro::task<std::vector<std::invoke_result_t<Function const&, Elem>>>
+    map_batch(
+        Ctx& ctx,
+        async_scheduler& scheduler,
+        async_scheduling scheduling,
+        std::vector<Elem> const& elems,
+        std::size_t begin,
+        std::size_t end,
+        std::atomic<std::size_t>& num_done) const
+    {
+        tasklet_tracker* tasklet{};
+        if (auto* ictx = cast_ctx_to_ptr<introspective_context_intf>(ctx))
+        {
+            tasklet = create_tasklet_tracker(
+                ctx.get_resources().the_tasklet_admin(),
+                "map",
+                fmt::format("map batch [{}, {})", begin, end),
+                ictx->get_tasklet());
+        }
+        co_await scheduler.schedule(scheduling);
+        tasklet_run run{tasklet};
+        auto* actx = cast_ctx_to_ptr<local_async_context_intf>(ctx);
+        if (actx && actx->is_cancellation_requested())
+        {
+            actx->throw_async_cancelled();
+        }
+        std::vector<std::invoke_result_t<Function const&, Elem>> results;
+        results.reserve(end - begin);
+        bool use_cache
+            = cache_elements_ && ctx.get_resources().support_caching();
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            if (use_cache)
+            {
+                results.push_back(co_await map_element_cached(ctx, elems[i]));
+            }
+            else
+            {
+                results.push_back(function_(elems[i]));
+            }
+        }
+        auto done = num_done.fetch_add(end - begin) + (end - begin);
+        if (actx)
+        {
+            actx->update_progress(static_cast<float>(done) / elems.size());
+        }
+        co_return results;
+    }
+
+    template<typename Ctx, typename Elem>
+    cppcoro::task<std::invoke_result_t<Function const&, Elem>>
+    map_element_cached(Ctx& ctx, Elem const& elem) const
+    {
+        using ptr_type
+            = immutable_cache_ptr<std::invoke_result_t<Function const&, Elem>>;
+        ptr_type ptr{
+            ctx.get_resources().memory_cache(),
+            captured_id{
+                new detail::map_element_id<Elem>{uuid_, uuid_hash_, elem}},
+            [this, &elem](untyped_immutable_cache_ptr& ptr) {
+                return map_element_on_cache_miss(
+                    static_cast<ptr_type&>(ptr), elem);
+            }};
+        co_await ptr.ensure_value_task();
+        co_return ptr.get_value();
+    }
+
+    template<typename Ptr, typename Elem>
+    cppcoro::shared_task<void>
+    map_element_on_cache_miss(Ptr& ptr, Elem const& elem) const
+    {
+        try
+        {
+            auto start_time = std::chrono::steady_clock::now();
+            auto value = function_(elem);
+            ptr.record_value(
+                std::move(value),
+                std::chrono::steady_clock::now() - start_time);
+        }
+        catch (...)
+        {
+            ptr.record_failure();
+            throw;
+        }
+        co_return;
+    }
+};
+
+/*
+ * Creates a request applying function to each element of elems, which is a
+ * std::vector, or a request resolving to one. The request resolves to a
+ * vector holding the results, in the order of the elements.
+ *
+ * props must be for a coroutine (request_function_t::coro), as the request's
+ * function needs the context; function itself is a plain function taking
+ * one element. The uuid in props identifies function.
+ */
+template<typename Props, typename Function, typename Elems>
+    requires std::remove_cvref_t<Props>::for_local_coroutine
+auto
+rq_map(Props&& props, Function&& function, Elems&& elems)
+{
+    using props_type = std::remove_cvref_t<Props>;
+    map_function<std::remove_cvref_t<Function>> map_func{
+        props.get_uuid(),
+        std::forward<Function>(function),
+        is_cached(props_type::level)};
+    return rq_function(
+        std::forward<Props>(props),
+        std::move(map_func),
+        std::forward<Elems>(elems));
+}
+
+} // namespace cradle
+
+#endif
@@ -22,6 +22,9 @@ to_string(async_status s)
         case async_status::CREATED:
             res = "CREATED";
             break;
+        case async_status::THROTTLED:
+            res = "THROTTLED";
+            break;
         case async_status::SUBS_RUNNING:
             res = "SUBS_RUNNING";
             break;
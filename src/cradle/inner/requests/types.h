@@ -14,6 +14,7 @@ namespace cradle {
 enum class async_status
 {
     CREATED, // Task was created
+    THROTTLED, // Task delayed because the memory cache is over its budget
     SUBS_RUNNING, // Subtasks running, main task waiting for them
     SELF_RUNNING, // Subtasks finished, main task running
     CANCELLED, // Cancellation completed
@@ -0,0 +1,177 @@
+#include <array>
+#include <atomic>
+#include <new>
+
+#include <cradle/inner/resolve/frame_pool.h>
+
+namespace cradle {
+
+namespace {
+
+// Frame sizes are rounded up to a multiple of this granularity.
+constexpr std::size_t size_granularity = 64;
+// Frames up to this size are pooled.
+constexpr std::size_t max_pooled_size = 2048;
+constexpr std::size_t num_size_classes = max_pooled_size / size_granularity;
+// Maximum number of free frames kept per size class; a frame freed when its
+// free list is full goes back to the heap.
+constexpr std::size_t max_free_per_class = 256;
+
+std::atomic<bool> pool_enabled{true};
+
+// Set when the current thread's pool has been destroyed. A frame allocated
+// or freed during thread exit, after that, bypasses the pool.
+thread_local bool pool_destroyed{false};
+
+struct free_frame
+{
+    free_frame* next;
+};
+
+class coroutine_frame_pool
+{
+ public:
+    coroutine_frame_pool() = default;
+
+    coroutine_frame_pool(coroutine_frame_pool const&) = delete;
+    coroutine_frame_pool&
+    operator=(coroutine_frame_pool const&)
+        = delete;
+
+    ~coroutine_frame_pool()
+    {
+        pool_destroyed = true;
+        for (auto& list : free_lists_)
+        {
+            while (list.head)
+            {
+                free_frame* next = list.head->next;
+                ::operator delete(list.head);
+                list.head = next;
+            }
+        }
+    }
+
+    void*
+    allocate(std::size_t size)
+    {
+        stats_.num_allocations += 1;
+        if (size > max_pooled_size)
+        {
+            stats_.num_heap_allocations += 1;
+            return ::operator new(size);
+        }
+        std::size_t ix = size_class(size);
+        auto& list = free_lists_[ix];
+        if (list.head && pool_enabled.load(std::memory_order_relaxed))
+        {
+            stats_.num_reused += 1;
+            free_frame* frame = list.head;
+            list.head = frame->next;
+            list.size -= 1;
+            return frame;
+        }
+        stats_.num_heap_allocations += 1;
+        return ::operator new((ix + 1) * size_granularity);
+    }
+
+    void
+    deallocate(void* frame, std::size_t size) noexcept
+    {
+        stats_.num_deallocations += 1;
+        if (size > max_pooled_size)
+        {
+            ::operator delete(frame);
+            return;
+        }
+        auto& list = free_lists_[size_class(size)];
+        if (list.size >= max_free_per_class
+            || !pool_enabled.load(std::memory_order_relaxed))
+        {
+            ::operator delete(frame);
+            return;
+        }
+        auto* node = static_cast<free_frame*>(frame);
+        node->next = list.head;
+        list.head = node;
+        list.size += 1;
+    }
+
+    coroutine_frame_pool_stats const&
+    get_stats() const
+    {
+        return stats_;
+    }
+
+    void
+    reset_stats()
+    {
+        stats_ = coroutine_frame_pool_stats{};
+    }
+
+ private:
+    struct free_list
+    {
+        free_frame* head{nullptr};
+        std::size_t size{0};
+    };
+
+    std::array<free_list, num_size_classes> free_lists_;
+    coroutine_frame_pool_stats stats_;
+
+    static std::size_t
+    size_class(std::size_t size)
+    {
+        return size == 0 ? 0 : (size - 1) / size_granularity;
+    }
+};
+
+coroutine_frame_pool&
+this_thread_pool()
+{
+    thread_local coroutine_frame_pool the_pool;
+    return the_pool;
+}
+
+} // namespace
+
+void*
+allocate_coroutine_frame(std::size_t size)
+{
+    if (pool_destroyed)
+    {
+        return ::operator new(size);
+    }
+    return this_thread_pool().allocate(size);
+}
+
+void
+deallocate_coroutine_frame(void* frame, std::size_t size) noexcept
+{
+    if (pool_destroyed)
+    {
+        ::operator delete(frame);
+        return;
+    }
+    this_thread_pool().deallocate(frame, size);
+}
+
+coroutine_frame_pool_stats
+get_coroutine_frame_pool_stats()
+{
+    return this_thread_pool().get_stats();
+}
+
+void
+reset_coroutine_frame_pool_stats()
+{
+    this_thread_pool().reset_stats();
+}
+
+void
+set_coroutine_frame_pool_enabled(bool enabled)
+{
+    pool_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+} // namespace cradle
@@ -0,0 +1,65 @@
+#ifndef CRADLE_INNER_RESOLVE_FRAME_POOL_H
+#define CRADLE_INNER_RESOLVE_FRAME_POOL_H
+
+#include <cstddef>
+
+/*
+ * Per-thread pool for coroutine frames
+ *
+ * Resolving a request creates several short-lived coroutine frames per
+ * request node. The coroutines returning a pooled_task (see pooled_task.h)
+ * allocate their frames from a pool owned by the current thread, instead of
+ * from the global heap.
+ *
+ * Only the coroutines inside the resolve path return a pooled_task; the
+ * public resolve functions, and the function_request virtuals, return a
+ * cppcoro::task, whose frames still come from the heap.
+ *
+ * The pool keeps freed frames in per-size-class free lists, and reuses them
+ * for later frames of the same size class. Frames larger than the largest
+ * size class come from the heap. A frame may be freed on a different thread
+ * than the one that allocated it (e.g., when an async resolution hops between
+ * pool threads); it then goes to the freeing thread's pool.
+ */
+
+namespace cradle {
+
+struct coroutine_frame_pool_stats
+{
+    // Frames allocated on this thread
+    std::size_t num_allocations{0};
+    // Allocations satisfied from a free list
+    std::size_t num_reused{0};
+    // Allocations that needed the global heap
+    std::size_t num_heap_allocations{0};
+    // Frames freed on this thread
+    std::size_t num_deallocations{0};
+};
+
+// Allocates a coroutine frame of the given size from the current thread's
+// pool. Throws std::bad_alloc on failure.
+void*
+allocate_coroutine_frame(std::size_t size);
+
+// Returns a coroutine frame to the current thread's pool; size must be the
+// size that was passed to allocate_coroutine_frame().
+void
+deallocate_coroutine_frame(void* frame, std::size_t size) noexcept;
+
+// Returns the statistics for the current thread's pool
+coroutine_frame_pool_stats
+get_coroutine_frame_pool_stats();
+
+// Resets the statistics for the current thread's pool
+void
+reset_coroutine_frame_pool_stats();
+
+// Enables or disables reusing frames, on all threads; enabled by default.
+// While disabled, each frame comes from the heap. Intended for measuring the
+// pool's effect.
+void
+set_coroutine_frame_pool_enabled(bool enabled);
+
+} // namespace cradle
+
+#endif
@@ -0,0 +1,36 @@
+#include <cradle/inner/resolve/incremental.h>
+
+namespace cradle {
+
+namespace {
+
+std::size_t
+count_nodes(incremental_node const& node)
+{
+    std::size_t count{1};
+    for (auto const& sub : node.subs)
+    {
+        if (sub)
+        {
+            count += count_nodes(*sub);
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+std::size_t
+incremental_graph::size() const
+{
+    return root_ ? count_nodes(*root_) : 0;
+}
+
+void
+incremental_graph::clear()
+{
+    root_.reset();
+    stats_ = incremental_stats{};
+}
+
+} // namespace cradle
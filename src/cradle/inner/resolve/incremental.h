@@ -0,0 +1,282 @@
+#ifndef CRADLE_INNER_RESOLVE_INCREMENTAL_H
+#define CRADLE_INNER_RESOLVE_INCREMENTAL_H
+
+// Incremental re-resolution of a request tree
+//
+// An interactive application typically resolves a large request tree, changes
+// a single leaf value, and resolves the modified tree again. With
+// composition-based caching, the changed leaf changes the captured id of all
+// its ancestors, so these are all recalculated, and the memory cache fills up
+// with near-duplicates.
+//
+// An incremental_graph remembers the request graph of the last resolution,
+// and the values of its function requests. A new request tree is matched
+// against that graph, by position in the tree:
+// - A function request that equals the one at the same position last time is
+//   not resolved: its previous value is used, and its subtree is skipped.
+// - Otherwise, its arguments are resolved first (incrementally). If their
+//   values have the same digests as last time (e.g., a changed leaf was
+//   recalculated, but yielded the same value), the previous value is used
+//   without calling the request's function ("early cutoff"), much like
+//   value-based caching would do.
+// - Otherwise, the request's function is called.
+//
+// Function requests resolved this way bypass the memory and secondary caches:
+// their values live in the graph, which holds the latest version only. Other
+// requests (e.g., proxy requests) are resolved as usual.
+//
+// Function requests are resolved locally; incremental resolution as a whole
+// is synchronous.
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <cppcoro/task.hpp>
+
+#include <cradle/inner/core/exception.h>
+#include <cradle/inner/core/id.h>
+#include <cradle/inner/core/unique_hash.h>
+#include <cradle/inner/requests/generic.h>
+#include <cradle/inner/resolve/resolve_request.h>
+
+namespace cradle {
+
+// A node in an incremental_graph, for a function request that was resolved
+// incrementally. A node is immutable once it is part of a graph, so that an
+// unchanged subtree can be shared between two consecutive graphs.
+struct incremental_node
+{
+    captured_id request;
+    // Digest over the request's uuid and its argument values; not set if an
+    // argument value cannot be hashed.
+    std::optional<unique_hasher::result_t> inputs_digest;
+    // Digest over the value; not set if the value cannot be hashed.
+    std::optional<unique_hasher::result_t> value_digest;
+    // The value; its type is the request's value_type.
+    std::shared_ptr<void const> value;
+    // One entry per argument; nullptr if the argument is not a function
+    // request.
+    std::vector<std::shared_ptr<incremental_node const>> subs;
+};
+
+using incremental_node_ptr = std::shared_ptr<incremental_node const>;
+
+struct incremental_stats
+{
+    // Function requests equal to the previous ones; their values and
+    // subtrees were reused.
+    std::size_t num_unchanged{0};
+    // Function requests whose argument values were unchanged (early cutoff)
+    std::size_t num_cut_off{0};
+    // Function requests whose function was called
+    std::size_t num_recomputed{0};
+};
+
+/*
+ * The state of an incremental resolution: the request graph resolved last
+ * time, plus statistics.
+ *
+ * An object is not thread-safe; it should be used for one resolution at a
+ * time.
+ */
+class incremental_graph
+{
+ public:
+    // Statistics on the last resolve_request_incrementally() call
+    incremental_stats const&
+    get_stats() const
+    {
+        return stats_;
+    }
+
+    // Returns the number of nodes (function requests) in the graph.
+    std::size_t
+    size() const;
+
+    // Forgets the last resolution (and the values it produced).
+    void
+    clear();
+
+ public: // for resolve_request_incrementally() and function_request_impl
+    incremental_node_ptr const&
+    get_root() const
+    {
+        return root_;
+    }
+
+    void
+    set_root(incremental_node_ptr root)
+    {
+        root_ = std::move(root);
+    }
+
+    incremental_stats&
+    stats()
+    {
+        return stats_;
+    }
+
+ private:
+    incremental_node_ptr root_;
+    incremental_stats stats_;
+};
+
+template<typename T>
+concept UniquelyHashable
+    = requires(unique_hasher& hasher, T const& value) {
+          update_unique_hash(hasher, value);
+      };
+
+// Returns the digest over value, if its type supports that.
+template<typename Value>
+std::optional<unique_hasher::result_t>
+get_incremental_value_digest(Value const& value, digest_algorithm algo)
+{
+    if constexpr (UniquelyHashable<Value>)
+    {
+        unique_hasher hasher{algo};
+        update_unique_hash(hasher, value);
+        return hasher.get_result();
+    }
+    else
+    {
+        return std::nullopt;
+    }
+}
+
+// Updates hasher with the digest of an argument value, which comes from sub
+// if the argument is a function request. Returns false if the value cannot
+// be hashed.
+template<typename Value>
+bool
+update_incremental_inputs_digest(
+    unique_hasher& hasher, incremental_node_ptr const& sub, Value const& value)
+{
+    if (sub)
+    {
+        if (!sub->value_digest)
+        {
+            return false;
+        }
+        hasher.combine(*sub->value_digest);
+        return true;
+    }
+    if constexpr (UniquelyHashable<Value>)
+    {
+        update_unique_hash(hasher, value);
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+// Returns the node for the ix'th argument in the previous graph, if any.
+inline incremental_node_ptr const&
+get_old_incremental_sub(incremental_node_ptr const& old_node, std::size_t ix)
+{
+    static incremental_node_ptr const none;
+    if (old_node && ix < old_node->subs.size())
+    {
+        return old_node->subs[ix];
+    }
+    return none;
+}
+
+template<typename Req>
+concept IncrementalRequest = requires(
+    Req const& req,
+    local_context_intf& ctx,
+    incremental_graph& graph,
+    incremental_node_ptr const& old_node,
+    incremental_node_ptr& new_node) {
+    req.resolve_incrementally(ctx, graph, old_node, new_node);
+};
+
+// Resolves arg, which is a subrequest or a plain value, as part of an
+// incremental resolution. new_node is set if arg is a function request.
+// If arg is not a function request, it is resolved as usual, within the
+// limits set by constraints.
+template<typename Arg, typename Constraints>
+cppcoro::task<arg_type<Arg>>
+resolve_arg_incrementally(
+    local_context_intf& ctx,
+    incremental_graph& graph,
+    incremental_node_ptr const& old_node,
+    incremental_node_ptr& new_node,
+    Arg const& arg,
+    Constraints constraints)
+{
+    if constexpr (IncrementalRequest<Arg>)
+    {
+        co_return co_await arg.resolve_incrementally(
+            ctx, graph, old_node, new_node);
+    }
+    else
+    {
+        co_return co_await resolve_request(ctx, arg, constraints);
+    }
+}
+
+template<typename Args, std::size_t... Ix>
+auto
+make_incremental_sub_tasks(
+    local_context_intf& ctx,
+    incremental_graph& graph,
+    incremental_node_ptr const& old_node,
+    incremental_node& new_node,
+    Args const& args,
+    std::index_sequence<Ix...>)
+{
+    // The arguments of a function request resolved locally, like
+    // make_sync_sub_tasks() does.
+    return std::make_tuple(resolve_arg_incrementally(
+        ctx,
+        graph,
+        get_old_incremental_sub(old_node, Ix),
+        new_node.subs[Ix],
+        std::get<Ix>(args),
+        ResolutionConstraintsLocalSync{})...);
+}
+
+/*
+ * Resolves req, reusing what can be reused from the previous resolution
+ * recorded in graph, and records the new request graph in graph.
+ *
+ * If the resolution throws, graph keeps the previous resolution.
+ *
+ * ctx must be a synchronous context; req and graph must stay alive until the
+ * returned task has completed. If req is not a function request (e.g., a
+ * proxy request), it is resolved as usual, within the limits set by
+ * constraints.
+ */
+template<Request Req, typename Constraints = NoResolutionConstraints>
+cppcoro::task<typename Req::value_type>
+resolve_request_incrementally(
+    local_context_intf& ctx,
+    Req const& req,
+    incremental_graph& graph,
+    Constraints constraints = Constraints())
+{
+    static_assert(!Constraints::force_async);
+    if (ctx.is_async())
+    {
+        throw not_implemented_error{
+            "incremental resolution in an asynchronous context"};
+    }
+    graph.stats() = incremental_stats{};
+    incremental_node_ptr new_root;
+    auto value = co_await resolve_arg_incrementally(
+        ctx, graph, graph.get_root(), new_root, req, constraints);
+    graph.set_root(std::move(new_root));
+    co_return value;
+}
+
+} // namespace cradle
+
+#endif
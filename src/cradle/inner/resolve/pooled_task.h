@@ -0,0 +1,251 @@
+#ifndef CRADLE_INNER_RESOLVE_POOLED_TASK_H
+#define CRADLE_INNER_RESOLVE_POOLED_TASK_H
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <cradle/inner/resolve/frame_pool.h>
+
+namespace cradle {
+
+/*
+ * A lazily started coroutine task, like cppcoro::task, whose frame is
+ * allocated from the current thread's coroutine frame pool (see
+ * frame_pool.h).
+ *
+ * Used by the coroutines inside the resolve path; the public resolve
+ * functions keep returning cppcoro::task. A pooled_task can be co_await'ed
+ * once, from any coroutine.
+ */
+template<typename T = void>
+class pooled_task;
+
+namespace detail {
+
+class pooled_task_promise_base
+{
+ public:
+    static void*
+    operator new(std::size_t size)
+    {
+        return allocate_coroutine_frame(size);
+    }
+
+    static void
+    operator delete(void* frame, std::size_t size) noexcept
+    {
+        deallocate_coroutine_frame(frame, size);
+    }
+
+    std::suspend_always
+    initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    struct final_awaiter
+    {
+        bool
+        await_ready() noexcept
+        {
+            return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<>
+        await_suspend(std::coroutine_handle<Promise> coro) noexcept
+        {
+            return coro.promise().continuation_;
+        }
+
+        void
+        await_resume() noexcept
+        {
+        }
+    };
+
+    final_awaiter
+    final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void
+    unhandled_exception() noexcept
+    {
+        exception_ = std::current_exception();
+    }
+
+    void
+    set_continuation(std::coroutine_handle<> continuation) noexcept
+    {
+        continuation_ = continuation;
+    }
+
+ protected:
+    void
+    rethrow_if_exception()
+    {
+        if (exception_)
+        {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+ private:
+    std::coroutine_handle<> continuation_{std::noop_coroutine()};
+    std::exception_ptr exception_;
+};
+
+template<typename T>
+class pooled_task_promise : public pooled_task_promise_base
+{
+ public:
+    pooled_task<T>
+    get_return_object() noexcept;
+
+    template<typename Value>
+        requires std::is_convertible_v<Value&&, T>
+    void
+    return_value(Value&& value)
+    {
+        value_.emplace(std::forward<Value>(value));
+    }
+
+    T
+    result()
+    {
+        rethrow_if_exception();
+        return std::move(*value_);
+    }
+
+ private:
+    std::optional<T> value_;
+};
+
+template<>
+class pooled_task_promise<void> : public pooled_task_promise_base
+{
+ public:
+    pooled_task<void>
+    get_return_object() noexcept;
+
+    void
+    return_void() noexcept
+    {
+    }
+
+    void
+    result()
+    {
+        rethrow_if_exception();
+    }
+};
+
+} // namespace detail
+
+template<typename T>
+class [[nodiscard]] pooled_task
+{
+    static_assert(!std::is_reference_v<T>);
+
+ public:
+    using promise_type = detail::pooled_task_promise<T>;
+    using value_type = T;
+
+    explicit pooled_task(std::coroutine_handle<promise_type> coro) noexcept
+        : coro_{coro}
+    {
+    }
+
+    pooled_task(pooled_task&& other) noexcept
+        : coro_{std::exchange(other.coro_, nullptr)}
+    {
+    }
+
+    pooled_task&
+    operator=(pooled_task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (coro_)
+            {
+                coro_.destroy();
+            }
+            coro_ = std::exchange(other.coro_, nullptr);
+        }
+        return *this;
+    }
+
+    pooled_task(pooled_task const&) = delete;
+    pooled_task&
+    operator=(pooled_task const&)
+        = delete;
+
+    ~pooled_task()
+    {
+        if (coro_)
+        {
+            coro_.destroy();
+        }
+    }
+
+    auto
+    operator co_await() const noexcept
+    {
+        struct awaiter
+        {
+            std::coroutine_handle<promise_type> coro;
+
+            bool
+            await_ready() const noexcept
+            {
+                return coro.done();
+            }
+
+            std::coroutine_handle<>
+            await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                coro.promise().set_continuation(awaiting);
+                return coro;
+            }
+
+            T
+            await_resume()
+            {
+                return coro.promise().result();
+            }
+        };
+        return awaiter{coro_};
+    }
+
+ private:
+    std::coroutine_handle<promise_type> coro_;
+};
+
+namespace detail {
+
+template<typename T>
+pooled_task<T>
+pooled_task_promise<T>::get_return_object() noexcept
+{
+    return pooled_task<T>{
+        std::coroutine_handle<pooled_task_promise>::from_promise(*this)};
+}
+
+inline pooled_task<void>
+pooled_task_promise<void>::get_return_object() noexcept
+{
+    return pooled_task<void>{
+        std::coroutine_handle<pooled_task_promise>::from_promise(*this)};
+}
+
+} // namespace detail
+
+} // namespace cradle
+
+#endif
@@ -5,7 +5,9 @@
 // Any Req in this file is a function_request_impl instance.
 // "A request" stands for a function_request_impl object.
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <utility>
 
 #include <cppcoro/shared_task.hpp>
@@ -15,10 +17,13 @@
 #include <cradle/inner/caching/immutable/local_locked_record.h>
 #include <cradle/inner/caching/immutable/lock.h>
 #include <cradle/inner/caching/immutable/ptr.h>
+#include <cradle/inner/core/get_unique_string.h>
 #include <cradle/inner/encodings/msgpack_value.h>
 #include <cradle/inner/requests/cast_ctx.h>
 #include <cradle/inner/requests/generic.h>
+#include <cradle/inner/resolve/pooled_task.h>
 #include <cradle/inner/resolve/util.h>
+#include <cradle/inner/service/resources.h>
 #include <cradle/inner/service/secondary_cached_blob.h>
 #include <cradle/inner/service/secondary_storage_intf.h>
 
@@ -65,40 +70,114 @@ cppcoro::task<typename Req::value_type> resolve_request_direct(
     co_return co_await resolve_request_call(ctx, req);
 }
 
-// Resolves a memory-cached request using some sort of secondary cache.
+// Codec allowing values of a fully-cached request to go to the memory cache's
+// cold tier; uses the same msgpack serialization as the secondary cache.
+template<typename Value>
+class msgpack_cas_value_codec : public detail::cas_value_codec
+{
+ public:
+    static msgpack_cas_value_codec const instance;
+
+    blob
+    serialize(detail::cas_record_base const& record) const override
+    {
+        auto const& typed_record
+            = static_cast<detail::cas_record<Value> const&>(record);
+        // The cold tier should not depend on blob files that may disappear.
+        return serialize_value(typed_record.value(), false);
+    }
+
+    std::unique_ptr<detail::cas_record_base>
+    deserialize(
+        digest_type const& digest, blob const& serialized) const override
+    {
+        return std::make_unique<detail::cas_record<Value>>(
+            digest, deserialize_value<Value>(serialized));
+    }
+};
+
+template<typename Value>
+msgpack_cas_value_codec<Value> const
+    msgpack_cas_value_codec<Value>::instance{};
+
+// Returns the codec for the values of Req, or nullptr if these values need
+// not be serializable.
+template<typename Req>
+detail::cas_value_codec const*
+get_cas_value_codec()
+{
+    if constexpr (is_fully_cached(Req::caching_level))
+    {
+        return &msgpack_cas_value_codec<typename Req::value_type>::instance;
+    }
+    else
+    {
+        return nullptr;
+    }
+}
+
+// Resolves a memory-cached request, recording the value in ptr's record.
 // A memory-cached request needs no secondary cache, so it can be resolved
 // right away (by calling the request's function).
 template<typename Req>
     requires(is_memory_cached(Req::caching_level))
-cppcoro::task<typename Req::value_type> resolve_secondary_cached(
-    caching_context_intf& ctx, Req const& req)
+pooled_task<void> resolve_secondary_cached(
+    caching_context_intf& ctx,
+    Req const& req,
+    immutable_cache_ptr<typename Req::value_type>& ptr)
 {
-    return resolve_request_direct(ctx, req);
+    auto start_time = std::chrono::steady_clock::now();
+    auto value = co_await resolve_request_direct(ctx, req);
+    ptr.record_value(
+        std::move(value), std::chrono::steady_clock::now() - start_time);
 }
 
 // Resolves a fully-cached request using some sort of secondary cache, and some
-// sort of serialization.
+// sort of serialization; recording the value in ptr's record.
+// A value calculated by the request's function goes straight into the memory
+// cache. Serializing it and writing it to the secondary cache happen in the
+// background, using the value in the memory cache (so without a copy).
 template<typename Req>
     requires(is_fully_cached(Req::caching_level))
-cppcoro::task<typename Req::value_type> resolve_secondary_cached(
-    caching_context_intf& ctx, Req const& req)
+pooled_task<void> resolve_secondary_cached(
+    caching_context_intf& ctx,
+    Req const& req,
+    immutable_cache_ptr<typename Req::value_type>& ptr)
 {
     using Value = typename Req::value_type;
     inner_resources& resources{ctx.get_resources()};
-    auto& cache = resources.secondary_cache();
-    bool allow_blob_files = cache.allow_blob_files();
-    auto create_blob_task = [&]() -> cppcoro::task<blob> {
-        co_return serialize_value(
-            co_await resolve_request_direct(ctx, req), allow_blob_files);
-    };
-    co_return deserialize_value<Value>(co_await secondary_cached_blob(
-        resources, req.get_captured_id(), std::move(create_blob_task)));
+    auto start_time = std::chrono::steady_clock::now();
+    std::string key{
+        get_unique_string(*req.get_captured_id(), resources.digest_algo())};
+    auto opt_blob = co_await read_secondary_cached_blob(resources, key);
+    if (opt_blob)
+    {
+        ptr.record_value(
+            deserialize_value<Value>(*opt_blob),
+            std::chrono::steady_clock::now() - start_time,
+            get_cas_value_codec<Req>());
+        co_return;
+    }
+
+    auto value = co_await resolve_request_direct(ctx, req);
+    ptr.record_value(
+        std::move(value),
+        std::chrono::steady_clock::now() - start_time,
+        get_cas_value_codec<Req>());
+    bool allow_blob_files = resources.secondary_cache().allow_blob_files();
+    resources.write_secondary_cache_in_background(
+        std::move(key),
+        [shared_value = ptr.get_shared_value(), allow_blob_files] {
+            return serialize_value(*shared_value, allow_blob_files);
+        });
 }
 
 // Called if the action cache contains no record for this request.
 // Resolves the request, stores the result in the CAS, updates the action
 // cache. The cache is accessed via ptr. The caller should ensure that ctx, req
 // and ptr outlive the coroutine.
+// The time needed to resolve the request is recorded as well, so that the
+// cache's eviction policy can take it into account.
 template<typename Req>
     requires(is_cached(Req::caching_level))
 cppcoro::shared_task<void> resolve_request_on_memory_cache_miss(
@@ -108,7 +187,8 @@ cppcoro::shared_task<void> resolve_request_on_memory_cache_miss(
 {
     try
     {
-        ptr.record_value(co_await resolve_secondary_cached(ctx, req));
+        co_await admit_calculation(ctx);
+        co_await resolve_secondary_cached(ctx, req, ptr);
     }
     catch (...)
     {
@@ -117,31 +197,16 @@ cppcoro::shared_task<void> resolve_request_on_memory_cache_miss(
     }
 }
 
-// Resolves a request, with caching, and with or without introspection,
-// depending on the request's compile-time attributes.
+// Ensures that ptr's record holds the value for req, resolving the request if
+// needed; with or without introspection, depending on the request's
+// compile-time attributes.
 template<typename Req>
     requires(is_cached(Req::caching_level) && !Req::value_based_caching)
-cppcoro::task<typename Req::value_type> resolve_request_cached(
-    caching_context_intf& ctx, Req const& req, cache_record_lock* lock_ptr)
+pooled_task<void> ensure_cached_value(
+    caching_context_intf& ctx,
+    Req const& req,
+    immutable_cache_ptr<typename Req::value_type>& ptr)
 {
-    using value_type = typename Req::value_type;
-    using ptr_type = immutable_cache_ptr<value_type>;
-    // While ptr lives, the corresponding cache record lives too.
-    // ptr lives until the shared_task has run (on behalf of the current
-    // request, or a previous one), and the value has been retrieved from the
-    // cache record.
-    ptr_type ptr{
-        ctx.get_resources().memory_cache(),
-        req.get_captured_id(),
-        [&ctx, &req](untyped_immutable_cache_ptr& ptr) {
-            return resolve_request_on_memory_cache_miss(
-                ctx, req, static_cast<ptr_type&>(ptr));
-        }};
-    if (lock_ptr != nullptr)
-    {
-        lock_ptr->set_record(
-            std::make_unique<local_locked_cache_record>(ptr.get_record()));
-    }
     if constexpr (Req::introspective)
     {
         auto& intr_ctx = cast_ctx_to_ref<introspective_context_intf>(ctx);
@@ -165,10 +230,68 @@ cppcoro::task<typename Req::value_type> resolve_request_cached(
     {
         actx->update_status(async_status::FINISHED);
     }
+}
+
+// Creates a ptr to the memory cache record for req; the record's shared task
+// will resolve the request if the cache does not yet hold its value.
+template<typename Req>
+    requires(is_cached(Req::caching_level) && !Req::value_based_caching)
+immutable_cache_ptr<typename Req::value_type> make_cache_ptr(
+    caching_context_intf& ctx, Req const& req)
+{
+    using ptr_type = immutable_cache_ptr<typename Req::value_type>;
+    return ptr_type{
+        ctx.get_resources().memory_cache(),
+        req.get_captured_id(),
+        [&ctx, &req](untyped_immutable_cache_ptr& ptr) {
+            return resolve_request_on_memory_cache_miss(
+                ctx, req, static_cast<ptr_type&>(ptr));
+        }};
+}
+
+// Resolves a request, with caching, and with or without introspection,
+// depending on the request's compile-time attributes.
+template<typename Req>
+    requires(is_cached(Req::caching_level) && !Req::value_based_caching)
+cppcoro::task<typename Req::value_type> resolve_request_cached(
+    caching_context_intf& ctx, Req const& req, cache_record_lock* lock_ptr)
+{
+    // While ptr lives, the corresponding cache record lives too.
+    // ptr lives until the shared_task has run (on behalf of the current
+    // request, or a previous one), and the value has been retrieved from the
+    // cache record.
+    auto ptr{make_cache_ptr(ctx, req)};
+    if (lock_ptr != nullptr)
+    {
+        lock_ptr->set_record(
+            std::make_unique<local_locked_cache_record>(ptr.get_record()));
+    }
+    co_await ensure_cached_value(ctx, req, ptr);
     // Finally, return the shared_task's value.
     co_return ptr.get_value();
 }
 
+// Like resolve_request_cached(), but returns a pointer to the value in the
+// cache instead of a copy; the pointer keeps the value in the cache.
+template<typename Req>
+    requires(is_cached(Req::caching_level) && !Req::value_based_caching)
+pooled_task<std::shared_ptr<typename Req::value_type const>>
+    resolve_request_cached_shared(caching_context_intf& ctx, Req const& req)
+{
+    auto ptr{make_cache_ptr(ctx, req)};
+    co_await ensure_cached_value(ctx, req, ptr);
+    co_return ptr.get_shared_value();
+}
+
+template<typename Req>
+    requires(is_cached(Req::caching_level) && Req::value_based_caching)
+pooled_task<std::shared_ptr<typename Req::value_type const>>
+    resolve_request_cached_shared(caching_context_intf& ctx, Req const& req)
+{
+    auto clone{co_await req.make_flattened_clone(ctx)};
+    co_return co_await resolve_request_cached_shared(ctx, *clone);
+}
+
 template<typename Req>
     requires(is_cached(Req::caching_level) && Req::value_based_caching)
 cppcoro::task<typename Req::value_type> resolve_request_cached(
@@ -206,6 +329,26 @@ resolve_impl(
     }
 }
 
+// Like resolve_impl(), but returns a shared pointer to the value. A value
+// from the memory cache is not copied: the pointer refers to the value in the
+// cache, and keeps it there.
+template<typename Req>
+cppcoro::task<std::shared_ptr<typename Req::value_type const>>
+resolve_impl_shared(local_context_intf& ctx, Req const& req)
+{
+    using Value = typename Req::value_type;
+    if constexpr (!is_uncached(Req::caching_level))
+    {
+        if (ctx.get_resources().support_caching())
+        {
+            auto& cac_ctx = cast_ctx_to_ref<caching_context_intf>(ctx);
+            co_return co_await resolve_request_cached_shared(cac_ctx, req);
+        }
+    }
+    co_return std::make_shared<Value const>(
+        co_await resolve_request_direct(ctx, req));
+}
+
 } // namespace cradle
 
 #endif
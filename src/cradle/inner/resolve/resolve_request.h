@@ -1,11 +1,18 @@
 #ifndef CRADLE_INNER_RESOLVE_RESOLVE_REQUEST_H
 #define CRADLE_INNER_RESOLVE_RESOLVE_REQUEST_H
 
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <cppcoro/task.hpp>
+#include <cppcoro/when_all.hpp>
 #include <fmt/format.h>
 
 #include <cradle/inner/caching/immutable/cache.h>
@@ -18,6 +25,7 @@
 #include <cradle/inner/requests/generic.h>
 #include <cradle/inner/resolve/remote.h>
 #include <cradle/inner/resolve/util.h>
+#include <cradle/inner/service/async_scheduler.h>
 #include <cradle/inner/service/resources.h>
 #include <cradle/inner/service/secondary_cached_blob.h>
 #include <cradle/inner/service/secondary_storage_intf.h>
@@ -26,7 +34,8 @@
 /*
  * Service resolving a request to a value
  *
- * The public interface is resolve_request().
+ * The public interface is resolve_request(), and resolve_requests() for
+ * batches.
  */
 
 namespace cradle {
@@ -120,13 +129,14 @@ cppcoro::task<Val> resolve_request_local(
     co_return val;
 }
 
+// Prepares ctx for resolving req locally: if ctx is an async root, its
+// context tree is (re-)created. Returns the context to resolve req with.
 template<Request Req, typename Constraints>
-cppcoro::task<typename Req::value_type>
-resolve_request_local(
+local_context_intf&
+prepare_local_resolution(
     local_context_intf& ctx,
     Req const& req,
     bool retrying,
-    cache_record_lock* lock_ptr,
     Constraints constraints)
 {
     // Prepare and populate ctx if it is an async root.
@@ -168,8 +178,20 @@ resolve_request_local(
             }
         }
     }
+    return *new_ctx;
+}
 
-    return req.resolve(*new_ctx, lock_ptr);
+template<Request Req, typename Constraints>
+cppcoro::task<typename Req::value_type>
+resolve_request_local(
+    local_context_intf& ctx,
+    Req const& req,
+    bool retrying,
+    cache_record_lock* lock_ptr,
+    Constraints constraints)
+{
+    auto& new_ctx{prepare_local_resolution(ctx, req, retrying, constraints)};
+    return req.resolve(new_ctx, lock_ptr);
 }
 
 template<Request Req>
@@ -370,6 +392,219 @@ resolve_request(
     return resolve_request(ctx, req, constraints, lock_ptr);
 }
 
+/*
+ * Resolves a request to a shared pointer to an immutable value.
+ *
+ * If the value comes from the memory cache, it is not copied out of the
+ * cache: the returned pointer refers to the value in the cache, and keeps the
+ * cache record alive (and counted as in use) for as long as the pointer or a
+ * copy of it exists. This makes a cache hit on a large value an O(1)
+ * operation.
+ *
+ * This is supported for requests having a resolve_shared() member (e.g.,
+ * function_request), resolved locally; synchronously or asynchronously.
+ * Otherwise, the request is resolved by resolve_request(), and the resulting
+ * value is moved into the shared pointer.
+ *
+ * The pointer stays valid if the memory cache is reset; the value then
+ * lives on outside the new cache.
+ */
+template<
+    Context Ctx,
+    Request Req,
+    typename Constraints = DefaultResolutionConstraints<Ctx>>
+cppcoro::task<std::shared_ptr<typename Req::value_type const>>
+resolve_request_shared(
+    Ctx& ctx, Req const& req, Constraints constraints = Constraints())
+{
+    static_assert(ValidContext<Ctx>);
+    static_assert(MatchingContextRequest<Ctx, Req>);
+    static_assert(MatchingContextConstraints<Ctx, Constraints>);
+    static_assert(MatchingRequestConstraints<Req, Constraints>);
+
+    using Value = typename Req::value_type;
+    if constexpr (
+        !Req::is_proxy && !Req::retryable && !constraints.force_remote
+        && requires(local_context_intf& loc_ctx) {
+               req.resolve_shared(loc_ctx);
+           })
+    {
+        if (constraints.force_local || !ctx.remotely())
+        {
+            auto& loc_ctx{cast_ctx_to_ref<local_context_intf>(ctx)};
+            auto& new_ctx{
+                prepare_local_resolution(loc_ctx, req, false, constraints)};
+            co_return co_await req.resolve_shared(new_ctx);
+        }
+    }
+    co_return std::make_shared<Value const>(
+        co_await resolve_request(ctx, req));
+}
+
+/*****************************************************************************
+ * Public interface: resolve_requests()
+ */
+
+// The outcome of resolving one request in a batch: either a value, or the
+// exception thrown while resolving the request.
+template<typename Value>
+class batch_resolution_result
+{
+ public:
+    explicit batch_resolution_result(Value value) : value_{std::move(value)}
+    {
+    }
+
+    explicit batch_resolution_result(std::exception_ptr error)
+        : error_{std::move(error)}
+    {
+    }
+
+    bool
+    has_value() const
+    {
+        return !error_;
+    }
+
+    // Returns the value, or rethrows the exception.
+    Value const&
+    value() const
+    {
+        if (error_)
+        {
+            std::rethrow_exception(error_);
+        }
+        return *value_;
+    }
+
+    // Returns the exception, or nullptr if there is a value.
+    std::exception_ptr const&
+    error() const
+    {
+        return error_;
+    }
+
+ private:
+    std::optional<Value> value_;
+    std::exception_ptr error_;
+};
+
+template<Context Ctx, Request Req>
+cppcoro::task<batch_resolution_result<typename Req::value_type>>
+resolve_request_in_batch(Ctx& ctx, Req const& req)
+{
+    using result_type = batch_resolution_result<typename Req::value_type>;
+    try
+    {
+        co_return result_type{co_await resolve_request(ctx, req)};
+    }
+    catch (...)
+    {
+        co_return result_type{std::current_exception()};
+    }
+}
+
+// Resolves req in a new context spawned from owner, on one of the async
+// scheduler's threads: the root request of an async or remote resolution
+// runs on the thread that starts it, so this lets the roots run in parallel.
+template<SpawnableContext Ctx, Request Req>
+cppcoro::task<batch_resolution_result<typename Req::value_type>>
+resolve_request_in_spawned_context(Ctx const& owner, Req const& req)
+{
+    std::unique_ptr<Ctx> ctx{owner.spawn()};
+    auto& resources{ctx->get_resources()};
+    co_await resources.the_async_scheduler().schedule(ctx->get_scheduling());
+    co_return co_await resolve_request_in_batch(*ctx, req);
+}
+
+/*
+ * Resolves a batch of requests, returning the results in the order of reqs.
+ *
+ * Identical requests (i.e., having equal captured id's) are resolved once
+ * only. The unique requests are resolved concurrently, so that their cache
+ * lookups, secondary cache accesses and calculations can overlap:
+ * - If ctx is local and synchronous, they all use ctx.
+ * - Otherwise, each resolution needs its own context tree. If Ctx is a
+ *   SpawnableContext, each request gets its own context, spawned from ctx;
+ *   if not, the requests are resolved one after the other.
+ *
+ * An exception thrown while resolving a request does not affect the other
+ * requests; it is stored in that request's result.
+ *
+ * The requests must stay alive until the returned task has completed.
+ */
+template<Context Ctx, Request Req>
+    requires requires(Req const& req) { req.get_captured_id(); }
+cppcoro::task<std::vector<batch_resolution_result<typename Req::value_type>>>
+resolve_requests(Ctx& ctx, std::vector<Req> const& reqs)
+{
+    using result_type = batch_resolution_result<typename Req::value_type>;
+
+    // Map each request to the first one that it equals.
+    std::vector<Req const*> unique_reqs;
+    std::vector<std::size_t> unique_ixs;
+    unique_ixs.reserve(reqs.size());
+    {
+        std::unordered_map<
+            id_interface const*,
+            std::size_t,
+            id_interface_pointer_hash,
+            id_interface_pointer_equality_test>
+            index;
+        for (auto const& req : reqs)
+        {
+            // The id is owned by req, so the pointer stays valid.
+            auto [it, inserted] = index.try_emplace(
+                &*req.get_captured_id(), unique_reqs.size());
+            if (inserted)
+            {
+                unique_reqs.push_back(&req);
+            }
+            unique_ixs.push_back(it->second);
+        }
+    }
+
+    std::vector<result_type> unique_results;
+    bool const shared_ctx{!ctx.remotely() && !ctx.is_async()};
+    if (shared_ctx || SpawnableContext<Ctx>)
+    {
+        std::vector<cppcoro::task<result_type>> tasks;
+        tasks.reserve(unique_reqs.size());
+        for (auto const* req : unique_reqs)
+        {
+            if constexpr (SpawnableContext<Ctx>)
+            {
+                tasks.push_back(
+                    shared_ctx
+                        ? resolve_request_in_batch(ctx, *req)
+                        : resolve_request_in_spawned_context(ctx, *req));
+            }
+            else
+            {
+                tasks.push_back(resolve_request_in_batch(ctx, *req));
+            }
+        }
+        unique_results = co_await cppcoro::when_all(std::move(tasks));
+    }
+    else
+    {
+        unique_results.reserve(unique_reqs.size());
+        for (auto const* req : unique_reqs)
+        {
+            unique_results.push_back(
+                co_await resolve_request_in_batch(ctx, *req));
+        }
+    }
+
+    std::vector<result_type> results;
+    results.reserve(reqs.size());
+    for (auto ix : unique_ixs)
+    {
+        results.push_back(unique_results[ix]);
+    }
+    co_return results;
+}
+
 } // namespace cradle
 
 #endif
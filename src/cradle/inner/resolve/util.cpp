@@ -1,5 +1,15 @@
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include <cppcoro/cancellation_registration.hpp>
+#include <cppcoro/cancellation_source.hpp>
+
+#include <cradle/inner/caching/immutable/cache.h>
 #include <cradle/inner/introspection/tasklet.h>
 #include <cradle/inner/requests/cast_ctx.h>
+#include <cradle/inner/requests/context_base.h>
 #include <cradle/inner/requests/generic.h>
 #include <cradle/inner/resolve/seri_req.h>
 #include <cradle/inner/resolve/util.h>
@@ -34,6 +44,165 @@ coawait_introspection::~coawait_introspection()
     }
 }
 
+namespace {
+
+// Shared between a throttled calculation and the events that can end its
+// wait; the first event resumes the calculation on the async scheduler.
+struct admission_wake_state
+{
+    admission_wake_state(
+        async_scheduler& scheduler, async_scheduling const& scheduling)
+        : scheduler{scheduler}, scheduling{scheduling}
+    {
+    }
+
+    void
+    wake()
+    {
+        std::scoped_lock lock{mutex};
+        if (woken)
+        {
+            return;
+        }
+        woken = true;
+        if (suspended)
+        {
+            scheduler.post(scheduling, handle);
+        }
+    }
+
+    async_scheduler& scheduler;
+    async_scheduling const scheduling;
+    std::coroutine_handle<> handle;
+    std::mutex mutex;
+    // Set once the coroutine is suspended
+    bool suspended{false};
+    bool woken{false};
+};
+
+// Suspends a throttled calculation until a value is removed from the memory
+// cache, cancellation is requested, or the deadline passes; without blocking
+// the thread.
+class admission_wait
+{
+ public:
+    admission_wait(
+        immutable_cache& cache,
+        async_scheduler& scheduler,
+        async_scheduling const& scheduling,
+        std::optional<cppcoro::cancellation_token> const& cancellation,
+        async_clock::time_point deadline)
+        : cache_{cache},
+          scheduler_{scheduler},
+          cancellation_{cancellation},
+          deadline_{deadline},
+          state_{std::make_shared<admission_wake_state>(scheduler, scheduling)}
+    {
+    }
+
+    bool
+    await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool
+    await_suspend(std::coroutine_handle<> handle)
+    {
+        auto state{state_};
+        state->handle = handle;
+        auto wake = [state] { state->wake(); };
+        waiter_id_ = add_eviction_waiter(cache_, wake);
+        if (cancellation_)
+        {
+            cancellation_registration_.emplace(*cancellation_, wake);
+        }
+        deadline_key_
+            = scheduler_.request_cancellation_at(deadline_, timeout_source_);
+        timeout_registration_.emplace(timeout_source_.token(), wake);
+        // A value could have been evicted before the waiter was added.
+        if (!exceeds_total_size_limit(cache_))
+        {
+            state->wake();
+        }
+        // Once suspended is set, the coroutine may be resumed on another
+        // thread, so this object must not be accessed anymore.
+        std::scoped_lock lock{state->mutex};
+        if (state->woken)
+        {
+            return false;
+        }
+        state->suspended = true;
+        return true;
+    }
+
+    void
+    await_resume()
+    {
+        remove_eviction_waiter(cache_, waiter_id_);
+        scheduler_.drop_deadline(deadline_key_);
+    }
+
+ private:
+    immutable_cache& cache_;
+    async_scheduler& scheduler_;
+    std::optional<cppcoro::cancellation_token> cancellation_;
+    async_clock::time_point deadline_;
+    std::shared_ptr<admission_wake_state> state_;
+    std::uint64_t waiter_id_{};
+    cppcoro::cancellation_source timeout_source_;
+    async_scheduler::deadline_key deadline_key_{};
+    std::optional<cppcoro::cancellation_registration>
+        cancellation_registration_;
+    std::optional<cppcoro::cancellation_registration> timeout_registration_;
+};
+
+} // namespace
+
+pooled_task<void>
+admit_calculation(caching_context_intf& ctx)
+{
+    auto& cache{ctx.get_resources().memory_cache()};
+    if (!exceeds_total_size_limit(cache))
+    {
+        co_return;
+    }
+    record_throttled_calculation(cache);
+    auto const timeout{get_config(cache).admission_timeout};
+    auto* actx = cast_ctx_to_ptr<local_async_context_intf>(ctx);
+    if (!actx)
+    {
+        // A synchronous resolution occupies its thread anyway.
+        wait_for_total_size_limit(cache, timeout, [] { return false; });
+        co_return;
+    }
+    actx->update_status(async_status::THROTTLED);
+    auto& scheduler{ctx.get_resources().the_async_scheduler()};
+    async_scheduling scheduling;
+    std::optional<cppcoro::cancellation_token> cancellation;
+    if (auto* base_ctx = dynamic_cast<local_async_context_base*>(actx))
+    {
+        auto& tree_ctx{base_ctx->get_tree_context()};
+        scheduling = tree_ctx.get_scheduling();
+        cancellation = tree_ctx.get_cancellation_token();
+    }
+    auto const deadline{async_clock::now() + timeout};
+    while (exceeds_total_size_limit(cache)
+           && !actx->is_cancellation_requested()
+           && async_clock::now() < deadline)
+    {
+        co_await admission_wait{
+            cache, scheduler, scheduling, cancellation, deadline};
+    }
+    if (actx->is_cancellation_requested())
+    {
+        actx->throw_async_cancelled();
+    }
+    // The status stays THROTTLED until the calculation reports its progress
+    // (e.g., SUBS_RUNNING), or its value is found in the secondary cache
+    // (FINISHED).
+}
+
 cppcoro::task<serialized_result>
 resolve_serialized_introspective(
     introspective_context_intf& ctx,
@@ -5,6 +5,7 @@
 
 #include <cppcoro/task.hpp>
 
+#include <cradle/inner/resolve/pooled_task.h>
 #include <cradle/inner/resolve/seri_lock.h>
 
 namespace cradle {
@@ -29,7 +30,17 @@ class coawait_introspection
     tasklet_tracker* tasklet_;
 };
 
-inline cppcoro::task<void>
+// Delays a new calculation while the memory cache exceeds its total size
+// limit, giving other calculations the opportunity to finish and release
+// memory; but no longer than the cache's admission timeout. In an async
+// context, the calculation's coroutine is suspended, and its status is
+// THROTTLED; it is resumed on the async scheduler when values are evicted
+// from the cache, or cancellation is requested. In a sync context, the
+// thread is blocked.
+pooled_task<void>
+admit_calculation(caching_context_intf& ctx);
+
+inline pooled_task<void>
 dummy_coroutine()
 {
     co_return;
@@ -0,0 +1,152 @@
+#include <cradle/inner/service/async_scheduler.h>
+
+namespace cradle {
+
+char const*
+to_string(async_priority priority)
+{
+    switch (priority)
+    {
+        case async_priority::BATCH:
+            return "BATCH";
+        case async_priority::NORMAL:
+            return "NORMAL";
+        case async_priority::INTERACTIVE:
+            return "INTERACTIVE";
+    }
+    return "unknown";
+}
+
+async_scheduler::async_scheduler(std::size_t num_threads)
+    : timer_thread_{[this] { run_timer(); }}
+{
+    threads_.reserve(num_threads);
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+        threads_.emplace_back([this] { run(); });
+    }
+}
+
+async_scheduler::~async_scheduler()
+{
+    {
+        std::scoped_lock lock{mutex_};
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_)
+    {
+        thread.join();
+    }
+    {
+        std::scoped_lock lock{deadlines_mutex_};
+        stopping_timer_ = true;
+    }
+    deadlines_cv_.notify_all();
+    timer_thread_.join();
+}
+
+async_queue_depths
+async_scheduler::get_queue_depths() const
+{
+    std::scoped_lock lock{mutex_};
+    return depths_;
+}
+
+async_scheduler::deadline_key
+async_scheduler::request_cancellation_at(
+    async_clock::time_point deadline, cppcoro::cancellation_source source)
+{
+    deadline_key key{deadline};
+    bool earliest{};
+    {
+        std::scoped_lock lock{deadlines_mutex_};
+        key.seq = next_deadline_seq_++;
+        auto it = deadlines_.emplace(key, std::move(source)).first;
+        earliest = it == deadlines_.begin();
+    }
+    if (earliest)
+    {
+        deadlines_cv_.notify_one();
+    }
+    return key;
+}
+
+void
+async_scheduler::drop_deadline(deadline_key const& key)
+{
+    // The timer thread may wake up needlessly for a dropped deadline.
+    std::scoped_lock lock{deadlines_mutex_};
+    deadlines_.erase(key);
+}
+
+void
+async_scheduler::enqueue(
+    async_scheduling const& scheduling,
+    std::chrono::microseconds predicted_duration,
+    std::coroutine_handle<> handle)
+{
+    {
+        std::scoped_lock lock{mutex_};
+        queue_.push(work_item{
+            scheduling.priority,
+            scheduling.deadline.value_or(async_clock::time_point::max()),
+            predicted_duration,
+            next_seq_++,
+            handle});
+        depths_[static_cast<std::size_t>(scheduling.priority)] += 1;
+    }
+    cv_.notify_one();
+}
+
+void
+async_scheduler::run()
+{
+    for (;;)
+    {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock lock{mutex_};
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+            {
+                // stopping_, and all work has been done
+                return;
+            }
+            auto const& item{queue_.top()};
+            handle = item.handle;
+            depths_[static_cast<std::size_t>(item.priority)] -= 1;
+            queue_.pop();
+        }
+        handle.resume();
+    }
+}
+
+void
+async_scheduler::run_timer()
+{
+    std::unique_lock lock{deadlines_mutex_};
+    while (!stopping_timer_)
+    {
+        if (deadlines_.empty())
+        {
+            deadlines_cv_.wait(lock);
+            continue;
+        }
+        auto it = deadlines_.begin();
+        if (async_clock::now() < it->first.deadline)
+        {
+            deadlines_cv_.wait_until(lock, it->first.deadline);
+            continue;
+        }
+        auto source{std::move(it->second)};
+        deadlines_.erase(it);
+        // Cancellation callbacks could take a while, or could schedule a
+        // new deadline.
+        lock.unlock();
+        source.request_cancellation();
+        lock.lock();
+    }
+}
+
+} // namespace cradle
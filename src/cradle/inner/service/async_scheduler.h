@@ -0,0 +1,232 @@
+#ifndef CRADLE_INNER_SERVICE_ASYNC_SCHEDULER_H
+#define CRADLE_INNER_SERVICE_ASYNC_SCHEDULER_H
+
+// Scheduling of asynchronous work by priority and deadline.
+//
+// An asynchronous resolution can have a priority and a deadline, set on its
+// root context and shared by all contexts in the tree. When a subrequest
+// moves to another thread (see reschedule_if_opportune()), it is queued on
+// the async_scheduler, which runs work with a higher priority first, and
+// among work with equal priority, work with an earlier deadline. Remaining
+// ties are broken by the predicted duration (see resolve_durations.h): the
+// expected time from starting the work until its request tree's root
+// finishes. Work with the longest remaining path, so on the critical path,
+// goes first.
+//
+// The scheduler also enforces the deadlines: a timer thread cancels each
+// resolution as soon as its deadline passes, even if the resolution is not
+// waiting in the queue at the time.
+
+#include <array>
+#include <chrono>
+#include <compare>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <cppcoro/cancellation_source.hpp>
+
+namespace cradle {
+
+enum class async_priority
+{
+    // Background work, e.g. batch recomputations
+    BATCH,
+    // The default
+    NORMAL,
+    // Work that a user is waiting for
+    INTERACTIVE,
+};
+
+inline constexpr std::size_t num_async_priorities{3};
+
+char const*
+to_string(async_priority priority);
+
+using async_clock = std::chrono::steady_clock;
+
+// The scheduling parameters of an asynchronous resolution.
+struct async_scheduling
+{
+    async_priority priority{async_priority::NORMAL};
+    // A resolution still running after its deadline is cancelled.
+    std::optional<async_clock::time_point> deadline;
+};
+
+// The number of work items waiting to be run, per priority; indexed by
+// static_cast<std::size_t>(async_priority).
+using async_queue_depths = std::array<std::size_t, num_async_priorities>;
+
+/*
+ * A thread pool whose work items are coroutines, which are run in order of
+ * priority, then deadline, then predicted duration (longest first), then
+ * submission.
+ */
+class async_scheduler
+{
+ public:
+    explicit async_scheduler(std::size_t num_threads);
+
+    // Runs the work that is still queued, then stops the threads.
+    ~async_scheduler();
+
+    async_scheduler(async_scheduler const&) = delete;
+    async_scheduler&
+    operator=(async_scheduler const&)
+        = delete;
+
+    class schedule_operation
+    {
+     public:
+        schedule_operation(
+            async_scheduler& scheduler,
+            async_scheduling const& scheduling,
+            std::chrono::microseconds predicted_duration)
+            : scheduler_{scheduler},
+              scheduling_{scheduling},
+              predicted_duration_{predicted_duration}
+        {
+        }
+
+        bool
+        await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void
+        await_suspend(std::coroutine_handle<> handle)
+        {
+            scheduler_.enqueue(scheduling_, predicted_duration_, handle);
+        }
+
+        void
+        await_resume() const noexcept
+        {
+        }
+
+     private:
+        async_scheduler& scheduler_;
+        async_scheduling scheduling_;
+        std::chrono::microseconds predicted_duration_;
+    };
+
+    // co_await'ing the returned object resumes the calling coroutine on one
+    // of the scheduler's threads. predicted_duration is the expected time
+    // from starting the work until the work that depends on it finishes.
+    schedule_operation
+    schedule(
+        async_scheduling const& scheduling,
+        std::chrono::microseconds predicted_duration = {})
+    {
+        return schedule_operation{*this, scheduling, predicted_duration};
+    }
+
+    // Queues the coroutine for handle, which was suspended by some other
+    // awaitable than the one returned by schedule(), to be resumed on one of
+    // the scheduler's threads.
+    void
+    post(async_scheduling const& scheduling, std::coroutine_handle<> handle)
+    {
+        enqueue(scheduling, {}, handle);
+    }
+
+    async_queue_depths
+    get_queue_depths() const;
+
+    // Identifies a request_cancellation_at() registration
+    struct deadline_key
+    {
+        async_clock::time_point deadline;
+        std::uint64_t seq;
+
+        auto
+        operator<=>(deadline_key const&) const
+            = default;
+    };
+
+    // Requests cancellation on source when deadline has passed. The returned
+    // key should be passed to drop_deadline() once the cancellation is no
+    // longer needed, so that the scheduler releases source.
+    deadline_key
+    request_cancellation_at(
+        async_clock::time_point deadline, cppcoro::cancellation_source source);
+
+    // Drops a request_cancellation_at() registration, unless it has been
+    // acted upon already.
+    void
+    drop_deadline(deadline_key const& key);
+
+ private:
+    struct work_item
+    {
+        async_priority priority;
+        async_clock::time_point deadline;
+        std::chrono::microseconds predicted_duration;
+        std::uint64_t seq;
+        std::coroutine_handle<> handle;
+    };
+
+    // Orders work items so that the most urgent one is on top of a
+    // std::priority_queue.
+    struct less_urgent
+    {
+        bool
+        operator()(work_item const& a, work_item const& b) const
+        {
+            if (a.priority != b.priority)
+            {
+                return a.priority < b.priority;
+            }
+            if (a.deadline != b.deadline)
+            {
+                return a.deadline > b.deadline;
+            }
+            if (a.predicted_duration != b.predicted_duration)
+            {
+                return a.predicted_duration < b.predicted_duration;
+            }
+            return a.seq > b.seq;
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::priority_queue<work_item, std::vector<work_item>, less_urgent>
+        queue_;
+    std::uint64_t next_seq_{0};
+    async_queue_depths depths_{};
+    bool stopping_{false};
+    std::vector<std::thread> threads_;
+
+    // The cancellation sources to trigger, by deadline
+    std::mutex deadlines_mutex_;
+    std::condition_variable deadlines_cv_;
+    std::map<deadline_key, cppcoro::cancellation_source> deadlines_;
+    std::uint64_t next_deadline_seq_{0};
+    bool stopping_timer_{false};
+    std::thread timer_thread_;
+
+    void
+    enqueue(
+        async_scheduling const& scheduling,
+        std::chrono::microseconds predicted_duration,
+        std::coroutine_handle<> handle);
+
+    void
+    run();
+
+    void
+    run_timer();
+};
+
+} // namespace cradle
+
+#endif
@@ -0,0 +1,137 @@
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <cradle/inner/fs/file_io.h>
+#include <cradle/inner/service/resolve_durations.h>
+
+namespace cradle {
+
+namespace {
+
+// The weight of a new duration in the moving average is 1 / this value.
+constexpr long long duration_smoothing = 4;
+
+} // namespace
+
+resolve_durations::shard&
+resolve_durations::shard_for(std::string const& uuid_str)
+{
+    return shards_[std::hash<std::string>{}(uuid_str) % num_shards];
+}
+
+resolve_durations::shard const&
+resolve_durations::shard_for(std::string const& uuid_str) const
+{
+    return shards_[std::hash<std::string>{}(uuid_str) % num_shards];
+}
+
+void
+resolve_durations::record(
+    std::string const& uuid_str, std::chrono::microseconds duration)
+{
+    auto& the_shard{shard_for(uuid_str)};
+    std::int64_t const micros{duration.count()};
+    {
+        std::shared_lock lock{the_shard.mutex};
+        auto it = the_shard.durations.find(uuid_str);
+        if (it != the_shard.durations.end())
+        {
+            auto& average{it->second};
+            auto old_micros = average.load(std::memory_order_relaxed);
+            while (!average.compare_exchange_weak(
+                old_micros,
+                old_micros + (micros - old_micros) / duration_smoothing,
+                std::memory_order_relaxed))
+            {
+            }
+            return;
+        }
+    }
+    std::unique_lock lock{the_shard.mutex};
+    // Another thread could have inserted the uuid in the meantime; its
+    // duration then remains.
+    the_shard.durations.try_emplace(uuid_str, micros);
+}
+
+std::chrono::microseconds
+resolve_durations::predict(std::string const& uuid_str) const
+{
+    auto const& the_shard{shard_for(uuid_str)};
+    std::shared_lock lock{the_shard.mutex};
+    auto it = the_shard.durations.find(uuid_str);
+    return std::chrono::microseconds{
+        it != the_shard.durations.end()
+            ? it->second.load(std::memory_order_relaxed)
+            : 0};
+}
+
+std::size_t
+resolve_durations::size() const
+{
+    std::size_t count{0};
+    for (auto const& the_shard : shards_)
+    {
+        std::shared_lock lock{the_shard.mutex};
+        count += the_shard.durations.size();
+    }
+    return count;
+}
+
+void
+resolve_durations::save(file_path const& path) const
+{
+    std::ofstream file;
+    open_file(file, path, std::ios::out | std::ios::trunc);
+    for (auto const& the_shard : shards_)
+    {
+        std::shared_lock lock{the_shard.mutex};
+        for (auto const& [uuid_str, duration] : the_shard.durations)
+        {
+            file << uuid_str << '\t'
+                 << duration.load(std::memory_order_relaxed) << '\n';
+        }
+    }
+}
+
+void
+resolve_durations::load(file_path const& path)
+{
+    if (!std::filesystem::exists(path))
+    {
+        return;
+    }
+    std::ifstream file;
+    open_file(file, path, std::ios::in);
+    // Reaching the end of the file should not throw.
+    file.exceptions(std::ios::badbit);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        auto tab = line.rfind('\t');
+        if (tab == std::string::npos || tab == 0)
+        {
+            continue;
+        }
+        std::int64_t micros{};
+        try
+        {
+            micros = std::stoll(line.substr(tab + 1));
+        }
+        catch (std::exception const&)
+        {
+            // Skip a malformed line
+            continue;
+        }
+        auto uuid_str{line.substr(0, tab)};
+        auto& the_shard{shard_for(uuid_str)};
+        std::unique_lock lock{the_shard.mutex};
+        the_shard.durations[uuid_str].store(
+            micros, std::memory_order_relaxed);
+    }
+}
+
+} // namespace cradle
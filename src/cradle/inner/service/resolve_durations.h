@@ -0,0 +1,80 @@
+#ifndef CRADLE_INNER_SERVICE_RESOLVE_DURATIONS_H
+#define CRADLE_INNER_SERVICE_RESOLVE_DURATIONS_H
+
+// Statistics on how long it takes to resolve requests, per request uuid.
+//
+// A recorded duration covers running the request's function only, excluding
+// its subrequests. When a subrequest, whose own subrequests have been
+// resolved, is queued on the async scheduler (see reschedule_if_opportune()),
+// what remains on its path to the root of the request tree is running its own
+// function, and then that of each of its ancestors. The sum of these
+// predictions estimates the length of the remaining path; the scheduler
+// starts the work with the longest remaining path first, so that the critical
+// path of a request tree does not end up waiting behind shorter work.
+//
+// The statistics can be saved to a file at shutdown, and loaded at startup.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include <cradle/inner/fs/types.h>
+
+namespace cradle {
+
+// Thread-safe. The statistics are sharded by uuid, and a duration for a
+// known uuid is recorded under a shared lock only, so that concurrent
+// recordings don't serialize.
+class resolve_durations
+{
+ public:
+    // Records the duration of resolving a request. The prediction for the
+    // uuid is a moving average, favoring recent durations.
+    void
+    record(std::string const& uuid_str, std::chrono::microseconds duration);
+
+    // Returns the predicted duration of resolving a request with the given
+    // uuid; zero if nothing was recorded for it.
+    std::chrono::microseconds
+    predict(std::string const& uuid_str) const;
+
+    // Returns the number of uuid's having a prediction.
+    std::size_t
+    size() const;
+
+    // Writes the predictions to path, one "uuid<TAB>microseconds" per line.
+    void
+    save(file_path const& path) const;
+
+    // Reads predictions written by save(), replacing any existing ones for
+    // the same uuid's. Does nothing if the file does not exist.
+    void
+    load(file_path const& path);
+
+ private:
+    struct shard
+    {
+        mutable std::shared_mutex mutex;
+        // The predictions in microseconds; updated without an exclusive lock
+        std::unordered_map<std::string, std::atomic<std::int64_t>> durations;
+    };
+
+    static constexpr std::size_t num_shards{16};
+
+    std::array<shard, num_shards> shards_;
+
+    shard&
+    shard_for(std::string const& uuid_str);
+
+    shard const&
+    shard_for(std::string const& uuid_str) const;
+};
+
+} // namespace cradle
+
+#endif
@@ -3,6 +3,7 @@
 #include <string>
 #include <thread>
 
+#include <cppcoro/sync_wait.hpp>
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
@@ -23,18 +24,64 @@
 #include <cradle/inner/service/resources.h>
 #include <cradle/inner/service/resources_impl.h>
 #include <cradle/inner/service/secondary_storage_intf.h>
+#include <cradle/inner/service/warm_start.h>
 #include <cradle/inner/utilities/logging.h>
 #include <cradle/rpclib/client/proxy.h>
 #include <cradle/rpclib/common/config.h>
 
 namespace cradle {
 
+static immutable_cache_eviction_policy
+get_eviction_policy(service_config const& config)
+{
+    auto policy = config.get_string_or_default(
+        inner_config_keys::MEMORY_CACHE_EVICTION_POLICY, "lru");
+    if (policy == "lru")
+    {
+        return immutable_cache_eviction_policy::LRU;
+    }
+    if (policy == "gdsf")
+    {
+        return immutable_cache_eviction_policy::GDSF;
+    }
+    throw config_error{
+        fmt::format("invalid memory cache eviction policy {}", policy)};
+}
+
 static immutable_cache_config
 make_immutable_cache_config(service_config const& config)
 {
     return immutable_cache_config{
         .unused_size_limit = config.get_number_or_default(
-            inner_config_keys::MEMORY_CACHE_UNUSED_SIZE_LIMIT, 0x40'00'00'00)};
+            inner_config_keys::MEMORY_CACHE_UNUSED_SIZE_LIMIT, 0x40'00'00'00),
+        .num_shards = config.get_number_or_default(
+            inner_config_keys::MEMORY_CACHE_NUM_SHARDS, 1),
+        .eviction_policy = get_eviction_policy(config),
+        .background_eviction = config.get_bool_or_default(
+            inner_config_keys::MEMORY_CACHE_BACKGROUND_EVICTION, false),
+        .low_watermark_percentage = config.get_number_or_default(
+            inner_config_keys::MEMORY_CACHE_LOW_WATERMARK_PERCENTAGE, 90),
+        .cold_tier_size_limit = config.get_number_or_default(
+            inner_config_keys::MEMORY_CACHE_COLD_TIER_SIZE_LIMIT, 0),
+        .total_size_limit = config.get_number_or_default(
+            inner_config_keys::MEMORY_CACHE_TOTAL_SIZE_LIMIT, 0),
+        .admission_timeout = std::chrono::milliseconds(
+            config.get_number_or_default(
+                inner_config_keys::MEMORY_CACHE_ADMISSION_TIMEOUT, 1000)),
+        .algorithm = get_digest_algorithm(config)};
+}
+
+digest_algorithm
+get_digest_algorithm(service_config const& config)
+{
+    auto name = config.get_string_or_default(
+        inner_config_keys::DIGEST_ALGORITHM, "sha256");
+    auto algo = parse_digest_algorithm(name);
+    if (!algo)
+    {
+        throw config_error{fmt::format("invalid digest algorithm {}", name)};
+    }
+    return *algo;
 }
 
 static std::unique_ptr<cradle::immutable_cache>
@@ -91,6 +138,12 @@ inner_resources::config() const
     return impl_->config_;
 }
 
+digest_algorithm
+inner_resources::digest_algo() const
+{
+    return impl_->digest_algo_;
+}
+
 bool
 inner_resources::support_caching() const
 {
@@ -111,6 +164,7 @@ inner_resources::reset_memory_cache()
 {
     auto& impl{*impl_};
     impl.check_support_caching();
+    wait_for_secondary_cache_writes();
     impl.logger_->info("reset memory cache");
     impl.memory_cache_->reset(make_immutable_cache_config(impl.config_));
 }
@@ -143,9 +197,91 @@ inner_resources::secondary_cache()
 void
 inner_resources::clear_secondary_cache()
 {
+    wait_for_secondary_cache_writes();
     secondary_cache().clear();
 }
 
+void
+inner_resources::save_warm_start_keys()
+{
+    auto& impl{*impl_};
+    auto path = impl.config_.get_optional_string(
+        inner_config_keys::MEMORY_CACHE_WARM_START_FILE);
+    if (!path || !impl.memory_cache_)
+    {
+        return;
+    }
+    impl.logger_->info("saving warm start keys to {}", *path);
+    cradle::save_warm_start_keys(*impl.memory_cache_, *path);
+}
+
+void
+inner_resources::start_warm_start_prefetch()
+{
+    auto& impl{*impl_};
+    auto path = impl.config_.get_optional_string(
+        inner_config_keys::MEMORY_CACHE_WARM_START_FILE);
+    if (!path || !impl.memory_cache_)
+    {
+        return;
+    }
+    if (impl.warm_start_prefetcher_)
+    {
+        throw std::logic_error("warm start prefetch already started");
+    }
+    auto keys{load_warm_start_keys(*path)};
+    if (keys.empty())
+    {
+        return;
+    }
+    // Prefetching more than the memory cache would retain seems pointless.
+    auto size_limit{
+        make_immutable_cache_config(impl.config_).unused_size_limit};
+    impl.warm_start_prefetcher_ = std::make_unique<warm_start_prefetcher>(
+        secondary_cache(), impl.async_scheduler_, std::move(keys), size_limit);
+}
+
+std::optional<blob>
+inner_resources::take_prefetched_value(std::string const& key)
+{
+    auto* prefetcher = impl_->warm_start_prefetcher_.get();
+    if (!prefetcher)
+    {
+        return std::nullopt;
+    }
+    return prefetcher->take(key);
+}
+
+void
+inner_resources::write_secondary_cache_in_background(
+    std::string key, std::function<blob()> make_value)
+{
+    auto& impl{*impl_};
+    impl.secondary_write_pool_.detach_task(
+        [&cache = secondary_cache(),
+         &logger = *impl.logger_,
+         key = std::move(key),
+         make_value = std::move(make_value)] {
+            try
+            {
+                cppcoro::sync_wait(cache.write(key, make_value()));
+            }
+            catch (std::exception const& e)
+            {
+                logger.warn(
+                    "error writing secondary cache entry {}: {}",
+                    key,
+                    e.what());
+            }
+        });
+}
+
+void
+inner_resources::wait_for_secondary_cache_writes()
+{
+    impl_->secondary_write_pool_.wait();
+}
+
 void
 inner_resources::set_requests_storage(
     std::unique_ptr<secondary_storage_intf> storage, bool is_default)
@@ -254,10 +390,60 @@ inner_resources::get_async_db()
     return impl_->the_async_db_.get();
 }
 
-cppcoro::static_thread_pool&
-inner_resources::get_async_thread_pool()
+async_scheduler&
+inner_resources::the_async_scheduler()
+{
+    return impl_->async_scheduler_;
+}
+
+resolve_durations&
+inner_resources::the_resolve_durations()
+{
+    return impl_->resolve_durations_;
+}
+
+void
+inner_resources::load_resolve_durations()
+{
+    auto& impl{*impl_};
+    auto path = impl.config_.get_optional_string(
+        inner_config_keys::RESOLVE_DURATIONS_FILE);
+    if (!path)
+    {
+        return;
+    }
+    impl.logger_->info("loading resolve durations from {}", *path);
+    impl.resolve_durations_.load(*path);
+}
+
+void
+inner_resources::save_resolve_durations()
 {
-    return impl_->async_pool_;
+    auto& impl{*impl_};
+    auto path = impl.config_.get_optional_string(
+        inner_config_keys::RESOLVE_DURATIONS_FILE);
+    if (!path)
+    {
+        return;
+    }
+    impl.logger_->info("saving resolve durations to {}", *path);
+    impl.resolve_durations_.save(*path);
+}
+
+cppcoro::static_thread_pool*
+inner_resources::get_sync_thread_pool()
+{
+    if (impl_->the_tasklet_admin_.capturing_enabled())
+    {
+        return nullptr;
+    }
+    return impl_->sync_pool_.get();
+}
+
+bool
+inner_resources::allows_direct_resolution()
+{
+    return impl_->direct_resolution_ && !get_sync_thread_pool();
 }
 
 void
@@ -403,6 +589,7 @@ io_svc_func(inner_resources_impl& impl)
 inner_resources_impl::inner_resources_impl(
     inner_resources& wrapper, service_config const& config)
     : config_{config},
+      digest_algo_{get_digest_algorithm(config)},
       logger_{ensure_logger("svc")},
       memory_cache_{create_memory_cache(config)},
       blob_dir_{std::make_unique<blob_file_directory>(config)},
@@ -414,10 +601,19 @@ inner_resources_impl::inner_resources_impl(
       http_pool_{cppcoro::static_thread_pool(
           static_cast<uint32_t>(config.get_number_or_default(
               inner_config_keys::HTTP_CONCURRENCY, 36)))},
-      async_pool_{cppcoro::static_thread_pool(
-          static_cast<uint32_t>(config.get_number_or_default(
-              inner_config_keys::ASYNC_CONCURRENCY, 20)))}
+      async_scheduler_{static_cast<std::size_t>(config.get_number_or_default(
+          inner_config_keys::ASYNC_CONCURRENCY, 20))},
+      secondary_write_pool_{2}
 {
+    auto sync_concurrency{static_cast<uint32_t>(config.get_number_or_default(
+        inner_config_keys::SYNC_CONCURRENCY, 0))};
+    if (sync_concurrency > 0)
+    {
+        sync_pool_ = std::make_unique<cppcoro::static_thread_pool>(
+            sync_concurrency);
+    }
+    direct_resolution_ = config.get_bool_or_default(
+        inner_config_keys::DIRECT_RESOLUTION, true);
 }
 
 inner_resources_impl::~inner_resources_impl()
@@ -1,14 +1,17 @@
 #ifndef CRADLE_INNER_SERVICE_RESOURCES_H
 #define CRADLE_INNER_SERVICE_RESOURCES_H
 
+#include <functional>
 #include <memory>
 #include <optional>
+#include <string>
 
 #include <cppcoro/io_service.hpp>
 #include <cppcoro/static_thread_pool.hpp>
 #include <cppcoro/task.hpp>
 #include <spdlog/spdlog.h>
 
+#include <cradle/inner/core/unique_hash.h>
 #include <cradle/inner/io/http_requests.h>
 #include <cradle/inner/remote/types.h>
 #include <cradle/inner/resolve/seri_lock.h>
@@ -17,6 +20,8 @@
 namespace cradle {
 
 class async_db;
+class async_scheduler;
+class resolve_durations;
 class blob_file_writer;
 class dll_collection;
 class domain;
@@ -39,6 +44,58 @@ struct inner_config_keys
     inline static std::string const MEMORY_CACHE_UNUSED_SIZE_LIMIT{
         "memory_cache/unused_size_limit"};
 
+    // (Optional integer)
+    // The number of shards that the memory cache is split into; each shard
+    // has its own lock, reducing contention between threads.
+    inline static std::string const MEMORY_CACHE_NUM_SHARDS{
+        "memory_cache/num_shards"};
+
+    // (Optional string)
+    // The policy deciding which unused memory cache entries to evict first:
+    // "lru" (least recently used; the default), or "gdsf" (taking into
+    // account how long it took to resolve an entry, its size, and its number
+    // of hits).
+    inline static std::string const MEMORY_CACHE_EVICTION_POLICY{
+        "memory_cache/eviction_policy"};
+
+    // (Optional boolean)
+    // Whether unused memory cache entries are evicted by a background
+    // thread, instead of by the thread releasing them.
+    inline static std::string const MEMORY_CACHE_BACKGROUND_EVICTION{
+        "memory_cache/background_eviction"};
+
+    // (Optional integer)
+    // With background eviction: the background thread evicts entries until
+    // the size of the unused entries is at most this percentage of
+    // memory_cache/unused_size_limit.
+    inline static std::string const MEMORY_CACHE_LOW_WATERMARK_PERCENTAGE{
+        "memory_cache/low_watermark_percentage"};
+
+    // (Optional integer)
+    // The maximum size of the memory cache's cold tier, holding compressed
+    // values of evicted entries; 0 (the default) disables the cold tier.
+    inline static std::string const MEMORY_CACHE_COLD_TIER_SIZE_LIMIT{
+        "memory_cache/cold_tier_size_limit"};
+
+    // (Optional integer)
+    // The maximum total size of the values in the memory cache, whether in
+    // use or not; 0 (the default) means no limit. New calculations are
+    // throttled while the limit is exceeded.
+    inline static std::string const MEMORY_CACHE_TOTAL_SIZE_LIMIT{
+        "memory_cache/total_size_limit"};
+
+    // (Optional integer)
+    // The maximum time, in milliseconds, that a new calculation is delayed
+    // while the memory cache's total size limit is exceeded.
+    inline static std::string const MEMORY_CACHE_ADMISSION_TIMEOUT{
+        "memory_cache/admission_timeout"};
+
+    // (Optional string)
+    // Path of the file holding the memory cache's hot set, allowing a
+    // process to start with a warm cache; see warm_start.h.
+    inline static std::string const MEMORY_CACHE_WARM_START_FILE{
+        "memory_cache/warm_start_file"};
+
     // (Optional string)
     // Specifies the factory to use to create a secondary cache implementation.
     // The string should equal a key passed to
@@ -48,16 +105,47 @@ struct inner_config_keys
     inline static std::string const SECONDARY_CACHE_FACTORY{
         "secondary_cache/factory"};
 
+    // (Optional string)
+    // The algorithm calculating digests over requests and values, used as
+    // keys in the memory and secondary caches: "sha256" (the default), or
+    // "xxh3_128" (faster, but not cryptographic).
+    inline static std::string const DIGEST_ALGORITHM{"digest_algorithm"};
+
     // (Optional integer)
     // How many concurrent threads to use for HTTP requests
     inline static std::string const HTTP_CONCURRENCY{"http_concurrency"};
 
     // (Optional integer)
-    // How many concurrent threads to use for locally resolving asynchronous
-    // requests in parallel
+    // How many threads the async scheduler uses for locally resolving
+    // asynchronous requests in parallel, and other background work
     inline static std::string const ASYNC_CONCURRENCY{"async_concurrency"};
+
+    // (Optional string)
+    // Path of the file holding the durations of resolving requests, per
+    // request uuid, used to start subrequests on the critical path first;
+    // see resolve_durations.h.
+    inline static std::string const RESOLVE_DURATIONS_FILE{
+        "resolve_durations_file"};
+
+    // (Optional integer)
+    // How many concurrent threads to use for resolving the subrequests of a
+    // synchronously resolved request in parallel; 0 (the default) means that
+    // subrequests are resolved on the calling thread
+    inline static std::string const SYNC_CONCURRENCY{"sync_concurrency"};
+
+    // (Optional boolean)
+    // Whether a synchronously resolved request tree that needs no coroutines
+    // (no coroutine functions, caching, introspection or containment) is
+    // resolved without them; true by default. Mainly for measuring the
+    // effect.
+    inline static std::string const DIRECT_RESOLUTION{"direct_resolution"};
 };
 
+// Returns the digest algorithm specified by config; throws config_error if
+// the algorithm is unknown.
+digest_algorithm
+get_digest_algorithm(service_config const& config);
+
 /*
  * A bunch of resources helping to resolve requests.
  *
@@ -111,6 +199,11 @@ class inner_resources
     service_config const&
     config() const;
 
+    // The algorithm for the digests in the caches, and for the keys derived
+    // from requests; see inner_config_keys::DIGEST_ALGORITHM.
+    digest_algorithm
+    digest_algo() const;
+
     bool
     support_caching() const;
 
@@ -130,6 +223,36 @@ class inner_resources
     void
     clear_secondary_cache();
 
+    // Saves the keys of the memory cache's hot set to the file configured by
+    // inner_config_keys::MEMORY_CACHE_WARM_START_FILE (if any). Intended to
+    // be called at shutdown.
+    void
+    save_warm_start_keys();
+
+    // Starts prefetching (in the background) the values for the keys saved
+    // by a previous process, from the secondary cache. Should be called
+    // after the secondary cache has been set.
+    void
+    start_warm_start_prefetch();
+
+    // Returns the value prefetched for the given secondary cache key, if
+    // any; a value is returned once only.
+    std::optional<blob>
+    take_prefetched_value(std::string const& key);
+
+    // Writes a value to the secondary cache, in the background. make_value
+    // (typically serializing a value that is already in the memory cache)
+    // runs in the background as well. Errors are logged only.
+    void
+    write_secondary_cache_in_background(
+        std::string key, std::function<blob()> make_value);
+
+    // Waits until all background writes to the secondary cache have been
+    // passed to that cache; the cache itself may still be busy with them.
+    // Called by reset_memory_cache() and clear_secondary_cache().
+    void
+    wait_for_secondary_cache_writes();
+
     // Note that a secondary cache and a requests storage can have overlapping
     // keys (identifying requests) but their values will differ, so the two
     // should really be separate.
@@ -176,8 +299,44 @@ class inner_resources
     async_db*
     get_async_db();
 
-    cppcoro::static_thread_pool&
-    get_async_thread_pool();
+    // Returns the scheduler on which all asynchronous work runs, by priority
+    // and deadline: subrequests of asynchronous requests, map request
+    // batches, and the warm start prefetching.
+    async_scheduler&
+    the_async_scheduler();
+
+    // Returns the statistics on request resolution durations, which the
+    // async scheduler uses.
+    resolve_durations&
+    the_resolve_durations();
+
+    // Loads the resolution durations recorded by a previous process, from
+    // the file configured by inner_config_keys::RESOLVE_DURATIONS_FILE (if
+    // any). Intended to be called at startup.
+    void
+    load_resolve_durations();
+
+    // Saves the resolution durations to the file configured by
+    // inner_config_keys::RESOLVE_DURATIONS_FILE (if any). Intended to be
+    // called at shutdown.
+    void
+    save_resolve_durations();
+
+    // Returns the thread pool for resolving the subrequests of a
+    // synchronously resolved request in parallel, or nullptr if they should
+    // be resolved on the calling thread. The latter happens if the
+    // sync_concurrency config value is 0, or while introspection is
+    // capturing (a synchronous context tracks tasklets in a way that is not
+    // thread-safe).
+    cppcoro::static_thread_pool*
+    get_sync_thread_pool();
+
+    // Returns true if a synchronously resolved request tree that needs no
+    // coroutines may be resolved without them: if the direct_resolution
+    // config value is true, and get_sync_thread_pool() returns nullptr (as
+    // resolving subrequests in parallel needs coroutines).
+    bool
+    allows_direct_resolution();
 
     void
     register_domain(std::unique_ptr<domain> dom);
@@ -9,15 +9,19 @@
 #include <thread>
 #include <unordered_map>
 
+#include <BS_thread_pool.hpp>
 #include <cppcoro/io_service.hpp>
 #include <cppcoro/static_thread_pool.hpp>
 #include <spdlog/spdlog.h>
 
+#include <cradle/inner/core/unique_hash.h>
 #include <cradle/inner/dll/dll_collection.h>
 #include <cradle/inner/introspection/tasklet_impl.h>
 #include <cradle/inner/io/http_requests.h>
 #include <cradle/inner/remote/types.h>
 #include <cradle/inner/resolve/seri_registry.h>
+#include <cradle/inner/service/async_scheduler.h>
+#include <cradle/inner/service/resolve_durations.h>
 #include <cradle/inner/service/config.h>
 #include <cradle/rpclib/client/contained_proxy_pool.h>
 
@@ -31,6 +35,7 @@ class inner_resources;
 struct mock_http_session;
 class remote_proxy;
 class secondary_storage_intf;
+class warm_start_prefetcher;
 
 class inner_resources_impl
 {
@@ -66,6 +71,7 @@ class inner_resources_impl
 
     std::mutex mutex_;
     service_config config_;
+    digest_algorithm digest_algo_;
     std::shared_ptr<spdlog::logger> logger_;
     std::unique_ptr<immutable_cache> memory_cache_;
     std::unique_ptr<secondary_storage_intf> secondary_cache_;
@@ -94,7 +100,15 @@ class inner_resources_impl
     std::jthread io_svc_thread_;
 
     cppcoro::static_thread_pool http_pool_;
-    cppcoro::static_thread_pool async_pool_;
+    // The scheduler's threads use resolve_durations_, so it should be
+    // declared before the scheduler.
+    resolve_durations resolve_durations_;
+    async_scheduler async_scheduler_;
+    // Resolves subrequests of synchronously resolved requests in parallel;
+    // nullptr if this has not been enabled.
+    std::unique_ptr<cppcoro::static_thread_pool> sync_pool_;
+    // See inner_config_keys::DIRECT_RESOLUTION
+    bool direct_resolution_{true};
 
     std::unique_ptr<mock_http_session> mock_http_;
 
@@ -106,6 +120,15 @@ class inner_resources_impl
 
     contained_proxy_pool contained_proxy_pool_;
     std::atomic<int> num_contained_calls_{};
+
+    // Uses secondary_cache_ and async_scheduler_, so should be declared after
+    // them.
+    std::unique_ptr<warm_start_prefetcher> warm_start_prefetcher_;
+
+    // Runs write_secondary_cache_in_background() tasks. These tasks use
+    // secondary_cache_ and may pin memory_cache_ records, so the pool should
+    // be declared after them.
+    BS::thread_pool secondary_write_pool_;
 };
 
 } // namespace cradle
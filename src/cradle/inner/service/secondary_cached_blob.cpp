@@ -4,21 +4,30 @@
 
 namespace cradle {
 
+cppcoro::task<std::optional<blob>>
+read_secondary_cached_blob(inner_resources& resources, std::string key)
+{
+    if (auto prefetched = resources.take_prefetched_value(key))
+    {
+        co_return std::move(*prefetched);
+    }
+    co_return co_await resources.secondary_cache().read(std::move(key));
+}
+
 cppcoro::task<blob>
 secondary_cached_blob(
     inner_resources& resources,
     captured_id id_key,
     std::function<cppcoro::task<blob>()> create_task)
 {
-    std::string key{get_unique_string(*id_key)};
-    auto& cache = resources.secondary_cache();
-    auto opt_result = co_await cache.read(key);
+    std::string key{get_unique_string(*id_key, resources.digest_algo())};
+    auto opt_result = co_await read_secondary_cached_blob(resources, key);
     if (opt_result)
     {
         co_return *opt_result;
     }
     auto result = co_await create_task();
-    co_await cache.write(key, result);
+    co_await resources.secondary_cache().write(key, result);
     co_return result;
 }
 
@@ -2,6 +2,8 @@
 #define CRADLE_INNER_SERVICE_SECONDARY_CACHED_BLOB_H
 
 #include <functional>
+#include <optional>
+#include <string>
 
 #include <cppcoro/task.hpp>
 
@@ -11,6 +13,12 @@
 
 namespace cradle {
 
+// Reads the value for key from the secondary cache provided by the given
+// resources, or from the values prefetched from that cache; returns
+// std::nullopt if there is no such value.
+cppcoro::task<std::optional<blob>>
+read_secondary_cached_blob(inner_resources& resources, std::string key);
+
 // Resolves a blob request, using the secondary cache provided by the given
 // resources.
 cppcoro::task<blob>
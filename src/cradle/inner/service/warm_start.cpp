@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include <cppcoro/sync_wait.hpp>
+#include <cppcoro/when_all.hpp>
+
+#include <cradle/inner/caching/immutable/cache.h>
+#include <cradle/inner/fs/file_io.h>
+#include <cradle/inner/service/async_scheduler.h>
+#include <cradle/inner/service/secondary_storage_intf.h>
+#include <cradle/inner/service/warm_start.h>
+#include <cradle/inner/utilities/logging.h>
+
+namespace cradle {
+
+namespace {
+
+// The number of values read concurrently
+constexpr std::size_t prefetch_batch_size = 16;
+
+} // namespace
+
+void
+save_warm_start_keys(immutable_cache& cache, file_path const& path)
+{
+    auto snapshot{get_cache_snapshot(cache)};
+    std::ofstream file;
+    open_file(file, path, std::ios::out | std::ios::trunc);
+    auto write_entry = [&](immutable_cache_entry_snapshot const& entry) {
+        if (entry.state == immutable_cache_entry_state::READY)
+        {
+            file << entry.key << '\n';
+        }
+    };
+    std::for_each(snapshot.in_use.begin(), snapshot.in_use.end(), write_entry);
+    std::for_each(
+        snapshot.pending_eviction.rbegin(),
+        snapshot.pending_eviction.rend(),
+        write_entry);
+}
+
+std::vector<std::string>
+load_warm_start_keys(file_path const& path)
+{
+    std::vector<std::string> keys;
+    if (!std::filesystem::exists(path))
+    {
+        return keys;
+    }
+    std::ifstream file;
+    open_file(file, path, std::ios::in);
+    // Reaching the end of the file should not throw.
+    file.exceptions(std::ios::badbit);
+    std::string key;
+    while (std::getline(file, key))
+    {
+        if (!key.empty())
+        {
+            keys.push_back(std::move(key));
+        }
+    }
+    return keys;
+}
+
+warm_start_prefetcher::warm_start_prefetcher(
+    secondary_storage_intf& storage,
+    async_scheduler& scheduler,
+    std::vector<std::string> keys,
+    std::size_t size_limit)
+    : storage_{storage},
+      scheduler_{scheduler},
+      keys_{std::move(keys)},
+      size_limit_{size_limit},
+      logger_{ensure_logger("svc")},
+      thread_{[this](std::stop_token stop_token) { run(stop_token); }}
+{
+}
+
+warm_start_prefetcher::~warm_start_prefetcher() = default;
+
+std::optional<blob>
+warm_start_prefetcher::take(std::string const& key)
+{
+    std::scoped_lock lock{mutex_};
+    auto node = values_.extract(key);
+    if (node.empty())
+    {
+        return std::nullopt;
+    }
+    total_size_ -= node.mapped().size();
+    return std::move(node.mapped());
+}
+
+void
+warm_start_prefetcher::run(std::stop_token stop_token)
+{
+    logger_->info("prefetching {} values for warm start", keys_.size());
+    std::size_t i = 0;
+    while (i < keys_.size() && !stop_token.stop_requested())
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            if (total_size_ >= size_limit_)
+            {
+                break;
+            }
+        }
+        auto batch_end = std::min(i + prefetch_batch_size, keys_.size());
+        std::vector<cppcoro::task<void>> tasks;
+        for (; i < batch_end; ++i)
+        {
+            tasks.push_back(prefetch(keys_[i]));
+        }
+        cppcoro::sync_wait(cppcoro::when_all(std::move(tasks)));
+    }
+    logger_->info("prefetched {} values for warm start", num_prefetched());
+    done_.store(true, std::memory_order_release);
+}
+
+cppcoro::task<void>
+warm_start_prefetcher::prefetch(std::string const& key)
+{
+    co_await scheduler_.schedule(async_scheduling{async_priority::BATCH});
+    try
+    {
+        auto value = co_await storage_.read(key);
+        if (!value)
+        {
+            co_return;
+        }
+        std::scoped_lock lock{mutex_};
+        if (total_size_ + value->size() <= size_limit_)
+        {
+            total_size_ += value->size();
+            values_.emplace(key, std::move(*value));
+            num_prefetched_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    catch (std::exception const& e)
+    {
+        // The value will be read again when it is needed.
+        logger_->warn("prefetching {} failed: {}", key, e.what());
+    }
+}
+
+} // namespace cradle
@@ -0,0 +1,116 @@
+#ifndef CRADLE_INNER_SERVICE_WARM_START_H
+#define CRADLE_INNER_SERVICE_WARM_START_H
+
+// Support for a process to start with a warm memory cache, based on the
+// memory cache contents of a previous process.
+//
+// The memory cache itself is type-erased: its values cannot be recreated
+// from their keys alone. Instead, the hot set's keys (which are also the
+// secondary cache keys) are saved at shutdown; at startup, the serialized
+// values for these keys are prefetched in bulk from the secondary cache.
+// A request that subsequently misses the memory cache takes its serialized
+// value from the prefetched ones, instead of reading it from the secondary
+// cache.
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <cppcoro/task.hpp>
+#include <spdlog/spdlog.h>
+
+#include <cradle/inner/core/type_definitions.h>
+#include <cradle/inner/fs/types.h>
+
+namespace cradle {
+
+class async_scheduler;
+struct immutable_cache;
+class secondary_storage_intf;
+
+// Writes the keys of the entries in the memory cache to path, one per line:
+// the entries in use first, then the unused ones, most recently used first.
+// Entries that are not ready are skipped.
+void
+save_warm_start_keys(immutable_cache& cache, file_path const& path);
+
+// Reads the keys written by save_warm_start_keys(); returns an empty list if
+// the file does not exist.
+std::vector<std::string>
+load_warm_start_keys(file_path const& path);
+
+/*
+ * Prefetches the values for a list of keys from a secondary storage, in the
+ * background, and holds them until they are taken.
+ *
+ * The values are read in batches, each batch concurrently on the async
+ * scheduler, as background work (async_priority::BATCH). Prefetching stops
+ * when the total size of the values held would exceed size_limit.
+ */
+class warm_start_prefetcher
+{
+ public:
+    // The storage and the scheduler must outlive this object.
+    warm_start_prefetcher(
+        secondary_storage_intf& storage,
+        async_scheduler& scheduler,
+        std::vector<std::string> keys,
+        std::size_t size_limit);
+
+    // Stops prefetching, waiting for the current batch to finish.
+    ~warm_start_prefetcher();
+
+    // Returns the value prefetched for key, if any. A value is handed out
+    // once only: the caller will store it in the memory cache.
+    std::optional<blob>
+    take(std::string const& key);
+
+    // Returns true when prefetching has finished.
+    bool
+    done() const
+    {
+        return done_.load(std::memory_order_acquire);
+    }
+
+    // Returns the number of values that were prefetched.
+    int
+    num_prefetched() const
+    {
+        return num_prefetched_.load(std::memory_order_relaxed);
+    }
+
+ private:
+    secondary_storage_intf& storage_;
+    async_scheduler& scheduler_;
+    std::vector<std::string> const keys_;
+    std::size_t const size_limit_;
+    std::shared_ptr<spdlog::logger> logger_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, blob> values_;
+    std::size_t total_size_{0};
+
+    std::atomic<int> num_prefetched_{0};
+    std::atomic<bool> done_{false};
+
+    // Declared last, so that the thread stops before the other members are
+    // destroyed.
+    std::jthread thread_;
+
+    void
+    run(std::stop_token stop_token);
+
+    cppcoro::task<void>
+    prefetch(std::string const& key);
+};
+
+} // namespace cradle
+
+#endif
@@ -267,7 +267,8 @@ atst_context::prepare_for_local_resolution()
             "invalid atst_context::prepare_for_local_resolution() call"});
     }
     local_root_ = std::make_shared<root_local_atst_context>(
-        std::make_unique<local_tree_context_base>(resources_),
+        std::make_unique<local_tree_context_base>(
+            resources_, get_scheduling()),
         create_optional_root_tasklet(
             resources_.the_tasklet_admin(), opt_tasklet_spec_));
     copy_test_params(*local_root_);
@@ -299,6 +300,17 @@ atst_context::prepare_for_remote_resolution()
     return *remote_root_;
 }
 
+std::unique_ptr<atst_context>
+atst_context::spawn() const
+{
+    auto other{std::make_unique<atst_context>(
+        resources_, proxy_name_, opt_tasklet_spec_)};
+    copy_test_params(*other);
+    other->set_scheduling(get_scheduling());
+    other->introspective_ = introspective_;
+    return other;
+}
+
 void
 atst_context::on_preparation_finished()
 {
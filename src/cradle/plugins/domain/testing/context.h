@@ -224,7 +224,8 @@ class atst_context final : public root_local_async_context_intf,
                            public remote_async_context_intf,
                            public local_async_ctx_owner_intf,
                            public remote_async_ctx_owner_intf,
-                           public test_params_context_mixin
+                           public test_params_context_mixin,
+                           public async_scheduling_context_mixin
 {
  public:
     atst_context(
@@ -352,6 +353,18 @@ class atst_context final : public root_local_async_context_intf,
         get_local_root().update_status_error(errmsg);
     }
 
+    float
+    get_progress() override
+    {
+        return get_local_root().get_progress();
+    }
+
+    void
+    update_progress(float progress) override
+    {
+        get_local_root().update_progress(progress);
+    }
+
     // root_local_async_context_intf
     std::unique_ptr<req_visitor_intf>
     make_ctx_tree_builder() override
@@ -490,6 +503,11 @@ class atst_context final : public root_local_async_context_intf,
     remote_async_context_intf&
     prepare_for_remote_resolution() override;
 
+    // Creates a new context with the same settings as this one, for a
+    // resolution running alongside this one's.
+    std::unique_ptr<atst_context>
+    spawn() const;
+
     // Returns the root context object for the current resolution, whether
     // local or remote. Blocks until the object is available; it becomes so
     // in resolve_request() or co_await resolve_request() on this context.
@@ -543,6 +561,7 @@ class atst_context final : public root_local_async_context_intf,
     get_local_root() const;
 };
 static_assert(ValidFinalContext<atst_context>);
+static_assert(SpawnableContext<atst_context>);
 
 } // namespace cradle
 
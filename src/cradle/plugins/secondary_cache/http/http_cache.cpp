@@ -31,7 +31,13 @@ namespace cradle {
  * values. Thus, if two different requests result in the same value, the
  * corresponding AC records will reference the same CAS record.
  * A CAS key is the lowercase SHA256 hash of the stored value. This is
- * identical between CRADLE and Bazel.
+ * identical between CRADLE and Bazel, so a CAS key is always calculated with
+ * SHA256, whatever the configured digest algorithm.
+ *
+ * bazel-remote also expects an AC key to look like a SHA256 hash. If the
+ * configured digest algorithm is not SHA256, the AC key is a SHA256 hash over
+ * the algorithm name and the original key. This also prevents processes
+ * using different algorithms from seeing each other's entries.
  * A CAS value is a blob that serializes the actual value. Serialization
  * details are up to the HTTP cache client.
  */
@@ -98,16 +104,28 @@ http_cache_impl::http_cache_impl(inner_resources& resources)
     : resources_{resources},
       port_{static_cast<int>(resources.config().get_mandatory_number(
           http_cache_config_keys::PORT))},
+      algo_{get_digest_algorithm(resources.config())},
       logger_{ensure_logger("http_cache")}
 {
 }
 
+std::string
+http_cache_impl::make_ac_key(std::string const& key) const
+{
+    if (algo_ == digest_algorithm::SHA256)
+    {
+        return key;
+    }
+    return get_unique_string_tmpl(
+        fmt::format("{}:{}", to_string(algo_), key), digest_algorithm::SHA256);
+}
+
 cppcoro::task<std::optional<blob>>
 http_cache_impl::read(std::string key)
 {
     logger_->info("read {}", key);
-    auto opt_digest
-        = co_await get_string_via_http(make_ac_get_request(port_, key));
+    auto opt_digest = co_await get_string_via_http(
+        make_ac_get_request(port_, make_ac_key(key)));
     if (!opt_digest)
     {
         co_return std::nullopt;
@@ -159,14 +177,15 @@ cppcoro::task<void>
 http_cache_impl::write(std::string key, blob value)
 {
     logger_->info("write {}", key);
-    auto digest{get_unique_string_tmpl(value)};
+    auto digest{get_unique_string_tmpl(value, digest_algorithm::SHA256)};
 
     // Put the value in the CAS
     co_await put_via_http(
         make_cas_put_request(port_, digest, std::move(value)));
 
     // Put the digest in the AC
-    co_await put_via_http(make_ac_put_request(port_, key, std::move(digest)));
+    co_await put_via_http(
+        make_ac_put_request(port_, make_ac_key(key), std::move(digest)));
 
     co_return;
 }
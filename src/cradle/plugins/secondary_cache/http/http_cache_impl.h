@@ -9,6 +9,7 @@
 #include <spdlog/spdlog.h>
 
 #include <cradle/inner/core/type_definitions.h>
+#include <cradle/inner/core/unique_hash.h>
 #include <cradle/inner/io/http_requests.h>
 
 namespace cradle {
@@ -31,8 +32,12 @@ class http_cache_impl
  private:
     inner_resources& resources_;
     int port_;
+    digest_algorithm algo_;
     std::shared_ptr<spdlog::logger> logger_;
 
+    std::string
+    make_ac_key(std::string const& key) const;
+
     cppcoro::task<std::optional<std::string>>
     get_string_via_http(http_request query);
 
@@ -0,0 +1,61 @@
+#ifndef CRADLE_PLUGINS_SECONDARY_CACHE_LOCAL_DISK_CACHE_FILE_MAPPING_H
+#define CRADLE_PLUGINS_SECONDARY_CACHE_LOCAL_DISK_CACHE_FILE_MAPPING_H
+
+// Memory mapping of disk cache files is POSIX-only: on Windows, a file
+// cannot be removed or replaced while it is mapped, which eviction and
+// local_disk_cache::write() may do.
+#ifndef _WIN32
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cradle/inner/core/type_definitions.h>
+#include <cradle/inner/fs/types.h>
+
+namespace cradle {
+
+// Read-only memory mapping of a disk cache file holding an uncompressed value.
+// Unlike a blob_file_reader, it does not claim to map a (blob) file: the file
+// belongs to the cache, which may evict or replace it while the mapping
+// exists, so its path must not be passed on.
+class disk_cache_file_mapping : public data_owner
+{
+ public:
+    disk_cache_file_mapping(file_path const& path)
+    {
+        namespace bi = boost::interprocess;
+        bi::file_mapping mapping{path.c_str(), bi::read_only};
+        bi::mapped_region region{mapping, bi::read_only};
+        region_.swap(region);
+    }
+
+    std::uint8_t*
+    data() override
+    {
+        return static_cast<std::uint8_t*>(region_.get_address());
+    }
+
+    std::byte const*
+    bytes() const
+    {
+        return static_cast<std::byte const*>(region_.get_address());
+    }
+
+    std::size_t
+    size() const
+    {
+        return region_.get_size();
+    }
+
+ private:
+    boost::interprocess::mapped_region region_;
+};
+
+} // namespace cradle
+
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+#include <exception>
+#include <utility>
+
+#include <cradle/plugins/secondary_cache/local/disk_cache_write_queue.h>
+
+namespace cradle {
+
+disk_cache_write_queue::disk_cache_write_queue(
+    ll_disk_cache& cache, std::size_t max_batch_size, int max_delay)
+    : cache_{cache},
+      max_batch_size_{max_batch_size > 0 ? max_batch_size : 1},
+      max_delay_{max_delay},
+      logger_{spdlog::get("cradle")},
+      thread_{[this](std::stop_token stoken) { run(stoken); }}
+{
+}
+
+void
+disk_cache_write_queue::push(ll_disk_cache_insert insert)
+{
+    std::scoped_lock lock{mutex_};
+    if (pending_.empty())
+    {
+        oldest_ = std::chrono::steady_clock::now();
+    }
+    pending_.push_back(std::move(insert));
+    if (pending_.size() == 1 || pending_.size() >= max_batch_size_)
+    {
+        pending_cv_.notify_one();
+    }
+}
+
+void
+disk_cache_write_queue::flush()
+{
+    std::unique_lock lock{mutex_};
+    if (pending_.empty() && !writing_)
+    {
+        return;
+    }
+    flush_requested_ = true;
+    pending_cv_.notify_one();
+    written_cv_.wait(lock, [&] { return pending_.empty() && !writing_; });
+}
+
+bool
+disk_cache_write_queue::empty() const
+{
+    std::scoped_lock lock{mutex_};
+    return pending_.empty() && !writing_;
+}
+
+void
+disk_cache_write_queue::run(std::stop_token stoken)
+{
+    // Note: the waits return early if stop is requested; any pending inserts
+    // are then written without further delay.
+    std::unique_lock lock{mutex_};
+    for (;;)
+    {
+        if (!pending_cv_.wait(
+                lock, stoken, [&] { return !pending_.empty(); }))
+        {
+            break;
+        }
+        pending_cv_.wait_until(lock, stoken, oldest_ + max_delay_, [&] {
+            return flush_requested_ || pending_.size() >= max_batch_size_;
+        });
+
+        std::vector<ll_disk_cache_insert> batch;
+        batch.swap(pending_);
+        writing_ = true;
+        lock.unlock();
+        write_batch(batch);
+        lock.lock();
+        writing_ = false;
+        if (pending_.empty())
+        {
+            flush_requested_ = false;
+        }
+        written_cv_.notify_all();
+    }
+}
+
+void
+disk_cache_write_queue::write_batch(
+    std::vector<ll_disk_cache_insert> const& batch)
+{
+    try
+    {
+        cache_.insert_batch(batch);
+    }
+    catch (std::exception& e)
+    {
+        // Something went wrong trying to write the cached values, so issue
+        // a warning and move on. Files already written for these entries
+        // are orphaned, and will be overwritten if the values are written
+        // again.
+        logger_->warn("error writing {} disk cache entries", batch.size());
+        logger_->warn(e.what());
+    }
+}
+
+} // namespace cradle
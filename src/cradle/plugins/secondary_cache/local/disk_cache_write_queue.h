@@ -0,0 +1,75 @@
+#ifndef CRADLE_PLUGINS_SECONDARY_CACHE_LOCAL_DISK_CACHE_WRITE_QUEUE_H
+#define CRADLE_PLUGINS_SECONDARY_CACHE_LOCAL_DISK_CACHE_WRITE_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <cradle/plugins/secondary_cache/local/ll_disk_cache.h>
+
+namespace cradle {
+
+// Write-behind queue for disk cache inserts.
+//
+// Pending inserts are written to the database on a background thread, in a
+// single transaction per batch. A batch is written when it reaches
+// max_batch_size entries, or max_delay milliseconds after its first entry was
+// queued, whichever comes first. Entries still pending on destruction are
+// written out before the thread exits.
+class disk_cache_write_queue
+{
+ public:
+    disk_cache_write_queue(
+        ll_disk_cache& cache, std::size_t max_batch_size, int max_delay);
+
+    // Queues an insert.
+    void
+    push(ll_disk_cache_insert insert);
+
+    // Writes out all pending inserts; returns when they are in the database.
+    void
+    flush();
+
+    // Returns true if there are no pending inserts, and no batch is being
+    // written.
+    bool
+    empty() const;
+
+ private:
+    ll_disk_cache& cache_;
+    std::size_t const max_batch_size_;
+    std::chrono::milliseconds const max_delay_;
+    std::shared_ptr<spdlog::logger> logger_;
+
+    mutable std::mutex mutex_;
+    // Notified when an insert is queued, or a flush is requested
+    std::condition_variable_any pending_cv_;
+    // Notified when a batch has been written
+    std::condition_variable_any written_cv_;
+    std::vector<ll_disk_cache_insert> pending_;
+    // When the first of the pending inserts was queued
+    std::chrono::steady_clock::time_point oldest_;
+    bool flush_requested_{false};
+    bool writing_{false};
+
+    // Must come last: ~jthread calls request_stop() then join(), while the
+    // other members are still alive.
+    std::jthread thread_;
+
+    void
+    run(std::stop_token stoken);
+
+    void
+    write_batch(std::vector<ll_disk_cache_insert> const& batch);
+};
+
+} // namespace cradle
+
+#endif
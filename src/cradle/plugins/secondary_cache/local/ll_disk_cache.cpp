@@ -1,14 +1,20 @@
 #include <cradle/plugins/secondary_cache/local/ll_disk_cache.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <mutex>
 #include <stdexcept>
+#include <system_error>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <boost/numeric/conversion/cast.hpp>
 
+#include <cppcoro/static_thread_pool.hpp>
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 #include <sqlite3.h>
@@ -24,14 +30,47 @@
 
 namespace cradle {
 
+// A read-only connection to the database, with its own prepared statement.
+// Used by find() in WAL mode, by one thread at a time.
+struct ll_disk_cache_read_connection
+{
+    sqlite3* db = nullptr;
+
+    // Combined AC and CAS look-up
+    sqlite3_stmt* find_query = nullptr;
+
+    ll_disk_cache_read_connection() = default;
+
+    ll_disk_cache_read_connection(ll_disk_cache_read_connection const&)
+        = delete;
+    ll_disk_cache_read_connection&
+    operator=(ll_disk_cache_read_connection const&)
+        = delete;
+
+    ~ll_disk_cache_read_connection()
+    {
+        sqlite3_finalize(find_query);
+        sqlite3_close(db);
+    }
+};
+
+struct ll_disk_cache_memory_index;
+
 struct ll_disk_cache_impl
 {
+    explicit ll_disk_cache_impl(uint32_t num_index_threads)
+        : index_pool{num_index_threads}
+    {
+    }
+
     file_path dir;
 
+    // The connection used for all writes, and for reads outside WAL mode
     sqlite3* db = nullptr;
 
     // prepared statements
     sqlite3_stmt* database_version_query = nullptr;
+    sqlite3_stmt* digest_algorithm_query = nullptr;
 
     sqlite3_stmt* insert_ac_entry_statement = nullptr;
     sqlite3_stmt* ac_lookup_query = nullptr;
@@ -42,6 +81,7 @@ struct ll_disk_cache_impl
     sqlite3_stmt* remove_ac_entry_statement = nullptr;
 
     sqlite3_stmt* cas_insert_statement = nullptr;
+    sqlite3_stmt* insert_file_cas_entry_statement = nullptr;
     sqlite3_stmt* initiate_cas_insert_statement = nullptr;
     sqlite3_stmt* finish_cas_insert_statement = nullptr;
     sqlite3_stmt* cas_lookup_by_digest_query = nullptr;
@@ -65,16 +105,42 @@ struct ll_disk_cache_impl
     // look-up measurably slower.
     std::vector<int64_t> ac_ids_to_flush;
 
-    // Protects all access to the cache. The ll_disk_cache member functions
-    // lock this mutex; other functions may assume it's locked.
+    // Protects all access to the cache, except for the members protected by
+    // usage_mutex or read_connections_mutex. The ll_disk_cache member
+    // functions lock this mutex (find() does not in WAL mode); other
+    // functions may assume it's locked.
     std::mutex mutex;
 
+    // Protects latest_activity and ac_ids_to_flush. Can be locked while
+    // holding mutex, but not the other way round.
+    std::mutex usage_mutex;
+
+    // WAL mode only: the read-only connections, and those not currently in
+    // use; both protected by read_connections_mutex.
+    std::vector<std::unique_ptr<ll_disk_cache_read_connection>>
+        read_connections;
+    std::vector<ll_disk_cache_read_connection*> idle_read_connections;
+    std::mutex read_connections_mutex;
+    // Notified when a read connection becomes idle
+    std::condition_variable read_connections_cv;
+
     std::shared_ptr<spdlog::logger> logger;
 
-    int hit_count{0};
-    int miss_count{0};
+    // The thread(s) running find_async() look-ups
+    cppcoro::static_thread_pool index_pool;
+
+    // In-memory copy of the index information in the database; nullptr if
+    // the cache has no memory index. Protected by mutex.
+    std::unique_ptr<ll_disk_cache_memory_index> index;
+
+    std::atomic<int> hit_count{0};
+    std::atomic<int> miss_count{0};
 };
 
+// In WAL mode, the database waits up to this time (in ms) for a lock held
+// by another connection, before failing with SQLITE_BUSY.
+constexpr int busy_timeout = 1000;
+
 // SQLITE UTILITIES
 
 static void
@@ -95,10 +161,13 @@ open_db(sqlite3** db, file_path const& file)
 
 static void
 throw_for_code(
-    ll_disk_cache_impl const& cache, int code, std::string const& prefix)
+    ll_disk_cache_impl const& cache,
+    sqlite3* db,
+    int code,
+    std::string const& prefix)
 {
     std::string code_text{sqlite3_errstr(code)};
-    std::string msg_text{sqlite3_errmsg(cache.db)};
+    std::string msg_text{sqlite3_errmsg(db)};
     std::string all_text{
         fmt::format("{} ({}): {}", prefix, code_text, msg_text)};
     CRADLE_THROW(
@@ -106,6 +175,13 @@ throw_for_code(
                                 << internal_error_message_info(all_text));
 }
 
+static void
+throw_for_code(
+    ll_disk_cache_impl const& cache, int code, std::string const& prefix)
+{
+    throw_for_code(cache, cache.db, code, prefix);
+}
+
 static void
 throw_for_code(int code, std::string const& prefix)
 {
@@ -169,15 +245,16 @@ check_sqlite_code(int code)
     }
 }
 
-// Create a prepared statement.
+// Create a prepared statement on the given connection.
 // This checks to make sure that the creation was successful, so the returned
 // pointer is always valid.
 static sqlite3_stmt*
-prepare_statement(ll_disk_cache_impl const& cache, std::string const& sql)
+prepare_statement(
+    ll_disk_cache_impl const& cache, sqlite3* db, std::string const& sql)
 {
     sqlite3_stmt* statement;
     auto code = sqlite3_prepare_v2(
-        cache.db,
+        db,
         sql.c_str(),
         boost::numeric_cast<int>(sql.length()),
         &statement,
@@ -185,11 +262,18 @@ prepare_statement(ll_disk_cache_impl const& cache, std::string const& sql)
     if (code != SQLITE_OK)
     {
         throw_for_code(
-            cache, code, fmt::format("error preparing SQL query {}", sql));
+            cache, db, code, fmt::format("error preparing SQL query {}", sql));
     }
     return statement;
 }
 
+// Create a prepared statement on the cache's own connection.
+static sqlite3_stmt*
+prepare_statement(ll_disk_cache_impl const& cache, std::string const& sql)
+{
+    return prepare_statement(cache, cache.db, sql);
+}
+
 // Bind a 64-bit integer to a parameter of a prepared statement.
 static void
 bind_int64(sqlite3_stmt* statement, int parameter_index, int64_t value)
@@ -398,7 +482,8 @@ execute_prepared_statement(
     }
     if (code != SQLITE_DONE)
     {
-        throw_for_code(cache, code, "SQL query failed");
+        throw_for_code(
+            cache, sqlite3_db_handle(statement), code, "SQL query failed");
     }
     if (single_row.value && row_count != 1)
     {
@@ -411,6 +496,88 @@ execute_prepared_statement(
     check_sqlite_code(sqlite3_reset(statement));
 }
 
+// Runs a one-off query, passing all rows from the result set into the
+// supplied callback.
+template<class RowHandler>
+static void
+execute_query(
+    ll_disk_cache_impl const& cache,
+    std::string const& sql,
+    expected_column_count expected_columns,
+    RowHandler const& row_handler)
+{
+    auto* statement = prepare_statement(cache, sql);
+    try
+    {
+        execute_prepared_statement(
+            cache,
+            statement,
+            expected_columns,
+            single_row_result{false},
+            row_handler);
+    }
+    catch (...)
+    {
+        sqlite3_finalize(statement);
+        throw;
+    }
+    sqlite3_finalize(statement);
+}
+
+// MEMORY INDEX
+
+// The memory index holds the AC, and the CAS minus the values, in hash maps.
+// It is loaded from the database on initialization, then updated together
+// with the database. Look-ups consult it instead of the database, except for
+// reading a value stored in the database.
+
+struct ac_index_entry
+{
+    int64_t ac_id;
+    int64_t cas_id;
+};
+
+struct cas_index_entry
+{
+    std::string digest;
+    storage_t storage;
+    int64_t size;
+    int64_t original_size;
+    // The blob file's path, for storage_t::blob_file only
+    std::string blob_file_path;
+};
+
+struct ll_disk_cache_memory_index
+{
+    // By AC key
+    std::unordered_map<std::string, ac_index_entry> ac_entries;
+    // The AC keys by ac_id, pointing into ac_entries
+    std::unordered_map<int64_t, std::string const*> ac_keys;
+    // By cas_id
+    std::unordered_map<int64_t, cas_index_entry> cas_entries;
+};
+
+static void
+index_ac_entry(
+    ll_disk_cache_memory_index& index,
+    std::string const& ac_key,
+    ac_index_entry const& entry)
+{
+    auto [it, inserted] = index.ac_entries.emplace(ac_key, entry);
+    index.ac_keys.emplace(entry.ac_id, &it->first);
+}
+
+static void
+unindex_ac_entry(ll_disk_cache_memory_index& index, int64_t ac_id)
+{
+    auto it = index.ac_keys.find(ac_id);
+    if (it != index.ac_keys.end())
+    {
+        index.ac_entries.erase(*it->second);
+        index.ac_keys.erase(it);
+    }
+}
+
 // OPERATIONS ON THE AC
 
 static void
@@ -424,21 +591,25 @@ record_ac_usage(ll_disk_cache_impl& cache, int64_t ac_id)
 static void
 flush_ac_usage(ll_disk_cache_impl& cache)
 {
-    cache.logger->info(
-        "flush_ac_usage ({} items)", cache.ac_ids_to_flush.size());
+    std::vector<int64_t> ac_ids;
+    {
+        std::scoped_lock<std::mutex> lock(cache.usage_mutex);
+        ac_ids.swap(cache.ac_ids_to_flush);
+    }
+    cache.logger->info("flush_ac_usage ({} items)", ac_ids.size());
     // An alternative would be a single
     //   UPDATE actions SET ... WHERE ac_id in (...)
     // but this happens to be slower than performing a query for each ac_id.
-    for (auto ac_id : cache.ac_ids_to_flush)
+    for (auto ac_id : ac_ids)
     {
         record_ac_usage(cache, ac_id);
     }
-    cache.ac_ids_to_flush.clear();
 }
 
 static bool
-should_flush_ac_usage(ll_disk_cache_impl const& cache)
+should_flush_ac_usage(ll_disk_cache_impl& cache)
 {
+    std::scoped_lock<std::mutex> lock(cache.usage_mutex);
     if (cache.ac_ids_to_flush.empty())
     {
         // Nothing to do
@@ -468,6 +639,32 @@ insert_ac_entry(
     bind_string(stmt, 1, ac_key);
     bind_int64(stmt, 2, cas_id);
     execute_prepared_statement(cache, stmt);
+    if (cache.index)
+    {
+        index_ac_entry(
+            *cache.index,
+            ac_key,
+            ac_index_entry{
+                .ac_id = sqlite3_last_insert_rowid(cache.db),
+                .cas_id = cas_id});
+    }
+}
+
+// Adds ac_id to ac_ids_to_flush, ensuring no duplicates appear. In a
+// production environment, the memory cache will (or should) already ensure
+// this, but benchmark tests that measure just disk cache performance do not.
+// A compromise is to first check on ac_id's presence. This has no measurable
+// performance impact, and prevents negative impact on benchmark output.
+static void
+note_ac_usage(ll_disk_cache_impl& cache, int64_t ac_id)
+{
+    std::scoped_lock<std::mutex> lock(cache.usage_mutex);
+    if (std::find(
+            cache.ac_ids_to_flush.begin(), cache.ac_ids_to_flush.end(), ac_id)
+        == cache.ac_ids_to_flush.end())
+    {
+        cache.ac_ids_to_flush.push_back(ac_id);
+    }
 }
 
 // Returns (ac_id, cas_id) pair for the specified AC entry, or nullopt if no
@@ -475,6 +672,16 @@ insert_ac_entry(
 static std::optional<std::pair<int64_t, int64_t>>
 look_up_ac_and_cas_ids(ll_disk_cache_impl& cache, std::string const& ac_key)
 {
+    if (cache.index)
+    {
+        auto it = cache.index->ac_entries.find(ac_key);
+        if (it == cache.index->ac_entries.end())
+        {
+            return std::nullopt;
+        }
+        note_ac_usage(cache, it->second.ac_id);
+        return std::make_pair(it->second.ac_id, it->second.cas_id);
+    }
     auto* stmt = cache.ac_lookup_query;
     bind_string(stmt, 1, ac_key);
     bool exists = false;
@@ -494,21 +701,7 @@ look_up_ac_and_cas_ids(ll_disk_cache_impl& cache, std::string const& ac_key)
     {
         return std::nullopt;
     }
-
-    // Add ac_id to ac_ids_to_flush, ensuring no duplicates appear. In a
-    // production environment, the memory cache will (or should) already ensure
-    // this, but benchmark tests that measure just disk cache performance
-    // do not.
-    // A compromise is to first check on ac_id's presence. This has no
-    // measurable performance impact, and prevents negative impact on benchmark
-    // output.
-    if (std::find(
-            cache.ac_ids_to_flush.begin(), cache.ac_ids_to_flush.end(), ac_id)
-        == cache.ac_ids_to_flush.end())
-    {
-        cache.ac_ids_to_flush.push_back(ac_id);
-    }
-
+    note_ac_usage(cache, ac_id);
     return std::make_pair(ac_id, cas_id);
 }
 
@@ -596,6 +789,10 @@ remove_ac_entry(ll_disk_cache_impl& cache, int64_t ac_id)
     auto* stmt = cache.remove_ac_entry_statement;
     bind_int64(stmt, 1, ac_id);
     execute_prepared_statement(cache, stmt);
+    if (cache.index)
+    {
+        unindex_ac_entry(*cache.index, ac_id);
+    }
 }
 
 // OPERATIONS ON THE CAS (DB ONLY)
@@ -609,19 +806,21 @@ insert_cas_entry(
     std::size_t original_size)
 {
     auto* stmt = cache.cas_insert_statement;
-    auto storage{from_storage_t(storage_t::in_db)};
+    auto storage{storage_t::in_db};
     auto const* bound_blob{&value};
     blob blob_file_path;
     if (auto const* owner = value.mapped_file_data_owner())
     {
         cache.logger->debug(
             " insert_cas_entry: blob file {}", owner->mapped_file());
-        storage = from_storage_t(storage_t::blob_file);
+        storage = storage_t::blob_file;
         blob_file_path = make_blob(owner->mapped_file());
         bound_blob = &blob_file_path;
     }
+    // Must outlive the statement's execution
+    auto storage_string{from_storage_t(storage)};
     bind_string(stmt, 1, digest);
-    bind_string(stmt, 2, storage);
+    bind_string(stmt, 2, storage_string);
     bind_blob(stmt, 3, *bound_blob);
     bind_int64(stmt, 4, value.size());
     bind_int64(stmt, 5, original_size);
@@ -643,6 +842,19 @@ insert_cas_entry(
             << internal_error_message_info(
                    "failed to create entry in index.db"));
     }
+    if (cache.index)
+    {
+        cache.index->cas_entries.emplace(
+            cas_id,
+            cas_index_entry{
+                .digest = digest,
+                .storage = storage,
+                .size = static_cast<int64_t>(value.size()),
+                .original_size = static_cast<int64_t>(original_size),
+                .blob_file_path = storage == storage_t::blob_file
+                                      ? to_string(blob_file_path)
+                                      : std::string{}});
+    }
     return cas_id;
 }
 
@@ -665,6 +877,54 @@ initiate_cas_insert(ll_disk_cache_impl const& cache, std::string const& digest)
             << internal_error_message_info(
                    "failed to create entry in index.db"));
     }
+    if (cache.index)
+    {
+        cache.index->cas_entries.emplace(
+            cas_id,
+            cas_index_entry{
+                .digest = digest,
+                .storage = storage_t::invalid,
+                .size = 0,
+                .original_size = 0});
+    }
+    return cas_id;
+}
+
+// Inserts a complete entry in the CAS, for a value that has already been
+// written to its external file; returns its cas_id.
+static int64_t
+insert_file_cas_entry(
+    ll_disk_cache_impl const& cache,
+    std::string const& digest,
+    std::size_t size,
+    std::size_t original_size)
+{
+    auto* stmt = cache.insert_file_cas_entry_statement;
+    bind_string(stmt, 1, digest);
+    bind_int64(stmt, 2, size);
+    bind_int64(stmt, 3, original_size);
+    execute_prepared_statement(cache, stmt);
+    auto cas_id = sqlite3_last_insert_rowid(cache.db);
+    if (cas_id == 0)
+    {
+        // Since we checked that the insert succeeded, we really shouldn't
+        // get here.
+        CRADLE_THROW(
+            ll_disk_cache_failure()
+            << ll_disk_cache_path_info(cache.dir)
+            << internal_error_message_info(
+                   "failed to create entry in index.db"));
+    }
+    if (cache.index)
+    {
+        cache.index->cas_entries.emplace(
+            cas_id,
+            cas_index_entry{
+                .digest = digest,
+                .storage = storage_t::in_file,
+                .size = static_cast<int64_t>(size),
+                .original_size = static_cast<int64_t>(original_size)});
+    }
     return cas_id;
 }
 
@@ -681,6 +941,13 @@ finish_cas_insert(
     bind_int64(stmt, 2, original_size);
     bind_int64(stmt, 3, cas_id);
     execute_prepared_statement(cache, stmt);
+    if (cache.index)
+    {
+        auto& entry = cache.index->cas_entries.at(cas_id);
+        entry.storage = storage_t::in_file;
+        entry.size = static_cast<int64_t>(size);
+        entry.original_size = static_cast<int64_t>(original_size);
+    }
 }
 
 static std::optional<int64_t>
@@ -719,6 +986,20 @@ struct internal_cas_entry_t
     int64_t original_size;
 };
 
+// Reads the digest, storage, value, size and original_size columns of a CAS
+// entry, starting at column c.
+static void
+read_cas_columns(sqlite_row& row, int c, internal_cas_entry_t& entry)
+{
+    entry.digest = read_string(row, c);
+    entry.storage = to_storage_t(read_string(row, c + 1));
+    entry.value = has_value(row, c + 2)
+                      ? std::make_optional(read_blob(row, c + 2))
+                      : std::nullopt;
+    entry.size = has_value(row, c + 3) ? read_int64(row, c + 3) : 0;
+    entry.original_size = has_value(row, c + 4) ? read_int64(row, c + 4) : 0;
+}
+
 static internal_cas_entry_t
 look_up_internal_cas_entry(ll_disk_cache_impl const& cache, int64_t cas_id)
 {
@@ -732,21 +1013,17 @@ look_up_internal_cas_entry(ll_disk_cache_impl const& cache, int64_t cas_id)
         single_row_result{true},
         [&](sqlite_row& row) {
             entry.cas_id = cas_id;
-            entry.digest = read_string(row, 0);
-            entry.storage = to_storage_t(read_string(row, 1));
-            entry.value = has_value(row, 2)
-                              ? std::make_optional(read_blob(row, 2))
-                              : std::nullopt;
-            entry.size = has_value(row, 3) ? read_int64(row, 3) : 0;
-            entry.original_size = has_value(row, 4) ? read_int64(row, 4) : 0;
+            read_cas_columns(row, 0, entry);
         });
     return entry;
 }
 
+// Converts an internal CAS entry to the form returned by the API, or to
+// nullopt if the entry is invalid.
 static std::optional<ll_disk_cache_cas_entry>
-look_up_cas_entry(ll_disk_cache_impl const& cache, int64_t cas_id)
+to_cas_entry(
+    ll_disk_cache_impl const& cache, internal_cas_entry_t internal_entry)
 {
-    auto internal_entry = look_up_internal_cas_entry(cache, cas_id);
     if (internal_entry.storage == storage_t::invalid)
     {
         return std::nullopt;
@@ -767,6 +1044,49 @@ look_up_cas_entry(ll_disk_cache_impl const& cache, int64_t cas_id)
         .original_size = internal_entry.original_size};
 }
 
+// Gets a CAS entry from the memory index. Only a value stored in the
+// database still needs a query.
+static internal_cas_entry_t
+look_up_indexed_cas_entry(ll_disk_cache_impl const& cache, int64_t cas_id)
+{
+    auto it = cache.index->cas_entries.find(cas_id);
+    if (it == cache.index->cas_entries.end())
+    {
+        CRADLE_THROW(
+            ll_disk_cache_failure()
+            << ll_disk_cache_path_info(cache.dir)
+            << internal_error_message_info(
+                   fmt::format("CAS entry {} not in memory index", cas_id)));
+    }
+    auto const& indexed = it->second;
+    if (indexed.storage == storage_t::in_db)
+    {
+        return look_up_internal_cas_entry(cache, cas_id);
+    }
+    internal_cas_entry_t entry{
+        .cas_id = cas_id,
+        .digest = indexed.digest,
+        .storage = indexed.storage,
+        .value = std::nullopt,
+        .size = indexed.size,
+        .original_size = indexed.original_size};
+    if (indexed.storage == storage_t::blob_file)
+    {
+        entry.value = make_blob(indexed.blob_file_path);
+    }
+    return entry;
+}
+
+static std::optional<ll_disk_cache_cas_entry>
+look_up_cas_entry(ll_disk_cache_impl const& cache, int64_t cas_id)
+{
+    if (cache.index)
+    {
+        return to_cas_entry(cache, look_up_indexed_cas_entry(cache, cas_id));
+    }
+    return to_cas_entry(cache, look_up_internal_cas_entry(cache, cas_id));
+}
+
 // Get the number of entries in the CAS.
 static int64_t
 get_cas_entry_count(ll_disk_cache_impl& cache)
@@ -818,6 +1138,10 @@ remove_cas_entry_db_only(ll_disk_cache_impl& cache, int64_t cas_id)
     auto* stmt = cache.remove_cas_entry_statement;
     bind_int64(stmt, 1, cas_id);
     execute_prepared_statement(cache, stmt);
+    if (cache.index)
+    {
+        cache.index->cas_entries.erase(cas_id);
+    }
 }
 
 // OPERATIONS ON THE CAS (FILE ONLY)
@@ -874,6 +1198,94 @@ look_up(ll_disk_cache_impl& cache, std::string const& ac_key)
     return look_up_cas_entry(cache, *opt_cas_id);
 }
 
+// Like look_up(), but on a read connection, in a single query (and thus on
+// a consistent snapshot of the database). Does not need the cache mutex.
+static std::optional<ll_disk_cache_cas_entry>
+look_up(
+    ll_disk_cache_impl& cache,
+    ll_disk_cache_read_connection& connection,
+    std::string const& ac_key)
+{
+    auto* stmt = connection.find_query;
+    bind_string(stmt, 1, ac_key);
+    std::optional<int64_t> ac_id;
+    internal_cas_entry_t entry{};
+    execute_prepared_statement(
+        cache,
+        stmt,
+        expected_column_count{7},
+        single_row_result{false},
+        [&](sqlite_row& row) {
+            ac_id = read_int64(row, 0);
+            entry.cas_id = read_int64(row, 1);
+            read_cas_columns(row, 2, entry);
+        });
+    if (!ac_id)
+    {
+        return std::nullopt;
+    }
+    note_ac_usage(cache, *ac_id);
+    return to_cas_entry(cache, std::move(entry));
+}
+
+// Inserts an AC entry, and a CAS entry if there is none yet for the digest.
+// The AC entry already existing must be due to a race condition; if so,
+// nothing happens. Neither does anything happen if the value should be in an
+// external file that is missing, or has the wrong size: the file is written
+// before the insert is queued, and an eviction in between may have removed
+// it (if it belonged to an older CAS entry for the same digest).
+// Returns the number of bytes by which the CAS grew.
+static uint64_t
+insert_entry(ll_disk_cache_impl& cache, ll_disk_cache_insert const& insert)
+{
+    auto opt_cas_id_for_ac = look_up_cas_id(cache, insert.ac_key);
+    if (opt_cas_id_for_ac)
+    {
+        cache.logger->info(
+            " insert: ac_key {} already there, cas_id {}",
+            insert.ac_key,
+            *opt_cas_id_for_ac);
+        return 0;
+    }
+    auto opt_cas_id_for_cas = look_up_cas_id_by_digest(cache, insert.digest);
+    int64_t cas_id{};
+    uint64_t growth{};
+    if (opt_cas_id_for_cas)
+    {
+        cas_id = *opt_cas_id_for_cas;
+        cache.logger->debug(
+            " insert: cas_id {} already there for digest {}",
+            cas_id,
+            insert.digest);
+    }
+    else
+    {
+        if (insert.value)
+        {
+            cas_id = insert_cas_entry(
+                cache, insert.digest, *insert.value, insert.original_size);
+        }
+        else
+        {
+            auto path{get_path_for_digest(cache, insert.digest)};
+            std::error_code ec;
+            auto file_size{std::filesystem::file_size(path, ec)};
+            if (ec || file_size != insert.size)
+            {
+                cache.logger->warn(
+                    " insert: file for digest {} missing or incomplete",
+                    insert.digest);
+                return 0;
+            }
+            cas_id = insert_file_cas_entry(
+                cache, insert.digest, insert.size, insert.original_size);
+        }
+        growth = insert.size;
+    }
+    insert_ac_entry(cache, insert.ac_key, cas_id);
+    return growth;
+}
+
 // Removes the specified AC entry, and the CAS entry it refers to if this is
 // the last reference. Returns the size of the removed CAS entry, or 0 if none
 // was removed.
@@ -943,6 +1355,168 @@ remove_invalid_entries(ll_disk_cache_impl& cache)
     execute_sql(cache, "delete from cas where storage == 'X';");
 }
 
+// LOADING THE MEMORY INDEX
+
+static void
+load_memory_index(ll_disk_cache_impl& cache)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto index = std::make_unique<ll_disk_cache_memory_index>();
+    // Avoid rehashing while loading.
+    auto ac_entry_count = static_cast<std::size_t>(get_ac_entry_count(cache));
+    index->ac_entries.reserve(ac_entry_count);
+    index->ac_keys.reserve(ac_entry_count);
+    index->cas_entries.reserve(
+        static_cast<std::size_t>(get_cas_entry_count(cache)));
+    execute_query(
+        cache,
+        "select cas_id, digest, storage, size, original_size,"
+        " case when storage = 'B' then value end"
+        " from cas;",
+        expected_column_count{6},
+        [&](sqlite_row& row) {
+            auto storage = to_storage_t(read_string(row, 2));
+            index->cas_entries.emplace(
+                read_int64(row, 0),
+                cas_index_entry{
+                    .digest = read_string(row, 1),
+                    .storage = storage,
+                    .size = has_value(row, 3) ? read_int64(row, 3) : 0,
+                    .original_size
+                    = has_value(row, 4) ? read_int64(row, 4) : 0,
+                    .blob_file_path = storage == storage_t::blob_file
+                                          ? to_string(read_blob(row, 5))
+                                          : std::string{}});
+        });
+    execute_query(
+        cache,
+        "select ac_id, key, cas_id from actions;",
+        expected_column_count{3},
+        [&](sqlite_row& row) {
+            index_ac_entry(
+                *index,
+                read_string(row, 1),
+                ac_index_entry{
+                    .ac_id = read_int64(row, 0),
+                    .cas_id = read_int64(row, 2)});
+        });
+    cache.index = std::move(index);
+    cache.logger->info(
+        "loaded memory index ({} AC entries, {} CAS entries) in {} ms",
+        cache.index->ac_entries.size(),
+        cache.index->cas_entries.size(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+}
+
+// READ CONNECTIONS (WAL MODE)
+
+// Opens the read connections. The database must already be in WAL mode.
+static void
+open_read_connections(ll_disk_cache_impl& cache, std::size_t count)
+{
+    auto path{cache.dir / "index.db"};
+    std::vector<std::unique_ptr<ll_disk_cache_read_connection>> connections;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto& connection = *connections.emplace_back(
+            std::make_unique<ll_disk_cache_read_connection>());
+        // Each connection is used by one thread at a time, so needs no
+        // mutex of its own.
+        if (sqlite3_open_v2(
+                path.string().c_str(),
+                &connection.db,
+                SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX,
+                nullptr)
+            != SQLITE_OK)
+        {
+            CRADLE_THROW(
+                ll_disk_cache_failure()
+                << ll_disk_cache_path_info(cache.dir)
+                << internal_error_message_info(
+                       "failed to open read connection to index.db"));
+        }
+        sqlite3_busy_timeout(connection.db, busy_timeout);
+        connection.find_query = prepare_statement(
+            cache,
+            connection.db,
+            "select a.ac_id, c.cas_id, c.digest, c.storage, c.value, c.size,"
+            " c.original_size"
+            " from actions a join cas c on c.cas_id = a.cas_id"
+            " where a.key=?1;");
+    }
+
+    std::scoped_lock<std::mutex> lock(cache.read_connections_mutex);
+    for (auto& connection : connections)
+    {
+        cache.idle_read_connections.push_back(connection.get());
+    }
+    cache.read_connections = std::move(connections);
+}
+
+// Closes the read connections, once none of them is in use.
+static void
+close_read_connections(ll_disk_cache_impl& cache)
+{
+    std::unique_lock<std::mutex> lock(cache.read_connections_mutex);
+    cache.read_connections_cv.wait(lock, [&] {
+        return cache.idle_read_connections.size()
+               == cache.read_connections.size();
+    });
+    cache.idle_read_connections.clear();
+    cache.read_connections.clear();
+}
+
+// Takes an idle read connection for the lifetime of the object, waiting for
+// one if all are in use. Holds no connection if the cache has none (i.e.,
+// is not in WAL mode).
+class read_connection_lease
+{
+ public:
+    read_connection_lease(ll_disk_cache_impl& cache) : cache_{cache}
+    {
+        std::unique_lock<std::mutex> lock(cache_.read_connections_mutex);
+        if (cache_.read_connections.empty())
+        {
+            return;
+        }
+        cache_.read_connections_cv.wait(
+            lock, [&] { return !cache_.idle_read_connections.empty(); });
+        connection_ = cache_.idle_read_connections.back();
+        cache_.idle_read_connections.pop_back();
+    }
+
+    read_connection_lease(read_connection_lease const&) = delete;
+    read_connection_lease&
+    operator=(read_connection_lease const&)
+        = delete;
+
+    ~read_connection_lease()
+    {
+        if (connection_)
+        {
+            {
+                std::scoped_lock<std::mutex> lock(
+                    cache_.read_connections_mutex);
+                cache_.idle_read_connections.push_back(connection_);
+            }
+            // Wakes up close_read_connections() as well.
+            cache_.read_connections_cv.notify_all();
+        }
+    }
+
+    ll_disk_cache_read_connection*
+    connection() const
+    {
+        return connection_;
+    }
+
+ private:
+    ll_disk_cache_impl& cache_;
+    ll_disk_cache_read_connection* connection_{nullptr};
+};
+
 // OTHER UTILITIES
 
 static void
@@ -987,6 +1561,7 @@ enforce_cache_size_limit(ll_disk_cache_impl& cache)
 static void
 record_activity(ll_disk_cache_impl& cache)
 {
+    std::scoped_lock<std::mutex> lock(cache.usage_mutex);
     cache.latest_activity = std::chrono::system_clock::now();
 }
 
@@ -1005,42 +1580,57 @@ record_cache_growth(ll_disk_cache_impl& cache, uint64_t size)
     }
 }
 
+// Finalizes a prepared statement, if any. A failed initialize() can call
+// shut_down() again, so statements must not be finalized twice.
+static void
+finalize_statement(sqlite3_stmt*& statement)
+{
+    sqlite3_finalize(statement);
+    statement = nullptr;
+}
+
 static void
 shut_down(ll_disk_cache_impl& cache)
 {
+    // The read connections must be closed first, so that the last connection
+    // to close (possibly checkpointing the WAL) is the writer.
+    close_read_connections(cache);
+    cache.index.reset();
     if (cache.db)
     {
-        sqlite3_finalize(cache.database_version_query);
-
-        sqlite3_finalize(cache.insert_ac_entry_statement);
-        sqlite3_finalize(cache.ac_lookup_query);
-        sqlite3_finalize(cache.get_cas_id_from_ac_query);
-        sqlite3_finalize(cache.ac_entry_count_query);
-        sqlite3_finalize(cache.ac_lru_entry_list_query);
-        sqlite3_finalize(cache.record_ac_usage_statement);
-        sqlite3_finalize(cache.remove_ac_entry_statement);
-
-        sqlite3_finalize(cache.cas_insert_statement);
-        sqlite3_finalize(cache.initiate_cas_insert_statement);
-        sqlite3_finalize(cache.finish_cas_insert_statement);
-        sqlite3_finalize(cache.cas_lookup_by_digest_query);
-        sqlite3_finalize(cache.cas_lookup_query);
-        sqlite3_finalize(cache.cas_entry_count_query);
-        sqlite3_finalize(cache.total_cas_size_query);
-        sqlite3_finalize(cache.count_cas_entry_refs_query);
-        sqlite3_finalize(cache.remove_cas_entry_statement);
+        finalize_statement(cache.database_version_query);
+        finalize_statement(cache.digest_algorithm_query);
+
+        finalize_statement(cache.insert_ac_entry_statement);
+        finalize_statement(cache.ac_lookup_query);
+        finalize_statement(cache.get_cas_id_from_ac_query);
+        finalize_statement(cache.ac_entry_count_query);
+        finalize_statement(cache.ac_lru_entry_list_query);
+        finalize_statement(cache.record_ac_usage_statement);
+        finalize_statement(cache.remove_ac_entry_statement);
+
+        finalize_statement(cache.cas_insert_statement);
+        finalize_statement(cache.insert_file_cas_entry_statement);
+        finalize_statement(cache.initiate_cas_insert_statement);
+        finalize_statement(cache.finish_cas_insert_statement);
+        finalize_statement(cache.cas_lookup_by_digest_query);
+        finalize_statement(cache.cas_lookup_query);
+        finalize_statement(cache.cas_entry_count_query);
+        finalize_statement(cache.total_cas_size_query);
+        finalize_statement(cache.count_cas_entry_refs_query);
+        finalize_statement(cache.remove_cas_entry_statement);
 
         sqlite3_close(cache.db);
         cache.db = nullptr;
     }
 }
 
-// Open (or create) the database file and verify that the version number is
-// what we expect.
+// Open (or create) the database file and verify that the version number and
+// digest algorithm are what we expect.
 static void
-open_and_check_db(ll_disk_cache_impl& cache)
+open_and_check_db(ll_disk_cache_impl& cache, digest_algorithm algo)
 {
-    int const expected_database_version = 5;
+    int const expected_database_version = 6;
 
     open_db(&cache.db, cache.dir / "index.db");
 
@@ -1077,6 +1667,18 @@ open_and_check_db(ll_disk_cache_impl& cache)
             " key text unique not null,"
             " cas_id integer not null,"
             " last_accessed datetime);");
+        // Properties of the cache as a whole
+        execute_sql(
+            cache,
+            "create table properties("
+            " name text primary key,"
+            " value text not null);");
+        execute_sql(
+            cache,
+            fmt::format(
+                "insert into properties(name, value)"
+                " values('digest_algorithm', '{}');",
+                to_string(algo)));
         execute_sql(
             cache,
             fmt::format(
@@ -1101,6 +1703,27 @@ open_and_check_db(ll_disk_cache_impl& cache)
             << ll_disk_cache_path_info(cache.dir)
             << internal_error_message_info("incompatible database"));
     }
+
+    // Digests calculated with different algorithms cannot be mixed.
+    cache.digest_algorithm_query = prepare_statement(
+        cache, "select value from properties where name='digest_algorithm';");
+    std::string db_algo;
+    execute_prepared_statement(
+        cache,
+        cache.digest_algorithm_query,
+        expected_column_count{1},
+        single_row_result{true},
+        [&](sqlite_row& row) { db_algo = read_string(row, 0); });
+    if (db_algo != to_string(algo))
+    {
+        CRADLE_THROW(
+            ll_disk_cache_failure()
+            << ll_disk_cache_path_info(cache.dir)
+            << internal_error_message_info(fmt::format(
+                   "digest algorithm mismatch: {} in database, {} configured",
+                   db_algo,
+                   to_string(algo))));
+    }
 }
 
 static void
@@ -1126,7 +1749,7 @@ initialize(ll_disk_cache_impl& cache, ll_disk_cache_config const& config)
     // Open the database file.
     try
     {
-        open_and_check_db(cache);
+        open_and_check_db(cache, config.algorithm);
     }
     catch (std::exception const& e)
     {
@@ -1137,23 +1760,38 @@ initialize(ll_disk_cache_impl& cache, ll_disk_cache_config const& config)
         // again.
         shut_down(cache);
         reset_directory(cache.dir);
-        open_and_check_db(cache);
+        open_and_check_db(cache, config.algorithm);
     }
 
     // Set various performance tuning flags.
+    if (config.wal_mode)
+    {
+        // Readers (on their own connections) and the writer do not block
+        // each other. Exclusive locking would prevent the readers from
+        // opening the database.
+        execute_sql(cache, "pragma journal_mode = wal;");
 
-    // Somewhat dangerous in case of an OS crash or power loss.
-    // Much much faster than FULL or NORMAL unless combined with WAL.
-    execute_sql(cache, "pragma synchronous = off;");
-
-    // Much faster than NORMAL
-    execute_sql(cache, "pragma locking_mode = exclusive;");
+        // Safe against application crashes; with WAL, this is not much
+        // slower than OFF.
+        execute_sql(cache, "pragma synchronous = normal;");
 
-    // Dangerous: if the application crashes in the middle of a transaction,
-    // then the database file will very likely go corrupt.
-    // WAL is safer but slower, and removes the need for the flush_ac_usage
-    // mechanism.
-    execute_sql(cache, "pragma journal_mode = memory;");
+        sqlite3_busy_timeout(cache.db, busy_timeout);
+    }
+    else
+    {
+        // Somewhat dangerous in case of an OS crash or power loss.
+        // Much much faster than FULL or NORMAL unless combined with WAL.
+        execute_sql(cache, "pragma synchronous = off;");
+
+        // Much faster than NORMAL
+        execute_sql(cache, "pragma locking_mode = exclusive;");
+
+        // Dangerous: if the application crashes in the middle of a
+        // transaction, then the database file will very likely go corrupt.
+        // WAL is safer but slower, and removes the need for the
+        // flush_ac_usage mechanism.
+        execute_sql(cache, "pragma journal_mode = memory;");
+    }
 
     // Initialize our prepared statements.
     cache.insert_ac_entry_statement = prepare_statement(
@@ -1182,6 +1820,10 @@ initialize(ll_disk_cache_impl& cache, ll_disk_cache_config const& config)
         cache,
         "insert into cas(digest, storage, value, size, original_size) "
         "values (?1, ?2, ?3, ?4, ?5);");
+    cache.insert_file_cas_entry_statement = prepare_statement(
+        cache,
+        "insert into cas(digest, storage, size, original_size)"
+        " values (?1, 'F', ?2, ?3);");
     cache.initiate_cas_insert_statement = prepare_statement(
         cache, "insert into cas(digest, storage) values (?1, 'X');");
     cache.finish_cas_insert_statement = prepare_statement(
@@ -1211,12 +1853,34 @@ initialize(ll_disk_cache_impl& cache, ll_disk_cache_config const& config)
     remove_invalid_entries(cache);
     record_activity(cache);
     enforce_cache_size_limit(cache);
+
+    if (config.memory_index)
+    {
+        load_memory_index(cache);
+    }
+    else if (config.wal_mode)
+    {
+        // Look-ups on the memory index don't need the read connections.
+        open_read_connections(cache, config.num_read_connections);
+    }
+}
+
+// In WAL mode, look-ups can run concurrently, on one index thread per read
+// connection.
+static uint32_t
+get_num_index_threads(ll_disk_cache_config const& config)
+{
+    if (!config.wal_mode || config.memory_index)
+    {
+        return 1;
+    }
+    return std::max(static_cast<uint32_t>(config.num_read_connections), 1U);
 }
 
 // API
 
 ll_disk_cache::ll_disk_cache(ll_disk_cache_config const& config)
-    : impl_(new ll_disk_cache_impl)
+    : impl_(new ll_disk_cache_impl(get_num_index_threads(config)))
 {
     this->reset(config);
 }
@@ -1284,11 +1948,20 @@ std::optional<ll_disk_cache_cas_entry>
 ll_disk_cache::find(std::string const& ac_key)
 {
     auto& cache = *this->impl_;
-    std::scoped_lock<std::mutex> lock(cache.mutex);
-
-    record_activity(cache);
+    std::optional<ll_disk_cache_cas_entry> result;
+    read_connection_lease lease{cache};
+    if (auto* connection = lease.connection())
+    {
+        record_activity(cache);
+        result = look_up(cache, *connection, ac_key);
+    }
+    else
+    {
+        std::scoped_lock<std::mutex> lock(cache.mutex);
+        record_activity(cache);
+        result = look_up(cache, ac_key);
+    }
 
-    auto result = look_up(cache, ac_key);
     if (result)
     {
         cache.hit_count += 1;
@@ -1301,6 +1974,14 @@ ll_disk_cache::find(std::string const& ac_key)
     return result;
 }
 
+// This is a coroutine so takes ac_key by value.
+cppcoro::task<std::optional<ll_disk_cache_cas_entry>>
+ll_disk_cache::find_async(std::string ac_key)
+{
+    co_await impl_->index_pool.schedule();
+    co_return find(ac_key);
+}
+
 std::optional<int64_t>
 ll_disk_cache::look_up_ac_id(std::string const& ac_key)
 {
@@ -1313,6 +1994,17 @@ ll_disk_cache::look_up_ac_id(std::string const& ac_key)
     return cradle::look_up_ac_id(cache, ac_key);
 }
 
+bool
+ll_disk_cache::has_cas_entry(std::string const& digest)
+{
+    auto& cache = *this->impl_;
+    std::scoped_lock<std::mutex> lock(cache.mutex);
+
+    record_activity(cache);
+
+    return look_up_cas_id_by_digest(cache, digest).has_value();
+}
+
 void
 ll_disk_cache::insert(
     std::string const& ac_key,
@@ -1326,33 +2018,44 @@ ll_disk_cache::insert(
 
     record_activity(cache);
 
-    auto opt_cas_id_for_ac = look_up_cas_id(cache, ac_key);
-    if (opt_cas_id_for_ac)
-    {
-        // The entries already exist; must be a race condition
-        cache.logger->info(
-            " insert: ac_key {} already there, cas_id {}",
-            ac_key,
-            *opt_cas_id_for_ac);
-        return;
-    }
-    auto opt_cas_id_for_cas = look_up_cas_id_by_digest(cache, digest);
-    int64_t cas_id{};
+    auto stored_original_size = original_size ? *original_size : value.size();
+    auto growth = insert_entry(
+        cache,
+        ll_disk_cache_insert{
+            ac_key, digest, value, value.size(), stored_original_size});
+    record_cache_growth(cache, growth);
+}
+
+void
+ll_disk_cache::insert_batch(std::vector<ll_disk_cache_insert> const& inserts)
+{
+    auto& cache = *this->impl_;
+    cache.logger->info("insert_batch: {} entries", inserts.size());
+    std::scoped_lock<std::mutex> lock(cache.mutex);
+
+    record_activity(cache);
+
     uint64_t growth{};
-    if (opt_cas_id_for_cas)
+    execute_sql(cache, "begin transaction;");
+    try
     {
-        cas_id = *opt_cas_id_for_cas;
-        cache.logger->debug(
-            " insert: cas_id {} already there for digest {}", cas_id, digest);
+        for (auto const& insert : inserts)
+        {
+            growth += insert_entry(cache, insert);
+        }
+        execute_sql(cache, "commit;");
     }
-    else
+    catch (...)
     {
-        auto stored_original_size
-            = original_size ? *original_size : value.size();
-        cas_id = insert_cas_entry(cache, digest, value, stored_original_size);
-        growth = value.size();
+        execute_sql(cache, "rollback;");
+        if (cache.index)
+        {
+            // The index has the changes that were rolled back.
+            load_memory_index(cache);
+        }
+        throw;
     }
-    insert_ac_entry(cache, ac_key, cas_id);
+    // Possible evictions happen outside the transaction.
     record_cache_growth(cache, growth);
 }
 
@@ -7,8 +7,11 @@
 #include <string>
 #include <vector>
 
+#include <cppcoro/task.hpp>
+
 #include <cradle/inner/core/exception.h>
 #include <cradle/inner/core/type_definitions.h>
+#include <cradle/inner/core/unique_hash.h>
 #include <cradle/inner/fs/types.h>
 #include <cradle/inner/service/config.h>
 #include <cradle/plugins/secondary_cache/local/disk_cache_info.h>
@@ -29,6 +32,20 @@ namespace cradle {
 // A cache is internally protected by a mutex, so it can be used concurrently
 // from multiple threads.
 
+// In WAL mode, the SQLite database has one connection for writing, plus a
+// pool of read-only connections that find() uses without locking the mutex;
+// so that look-ups run concurrently with each other and with writes.
+
+// With a memory index, the AC and CAS index information (everything but the
+// values stored in the database) is also kept in hash maps, loaded from the
+// database on initialization. Look-ups then only query the database for values
+// stored in it; changes are written to both. The memory index takes the place
+// of the read connections in WAL mode.
+
+// A cache owns a dedicated index thread (one per read connection in WAL
+// mode), on which find_async() runs its SQLite queries; so that a coroutine
+// awaiting a look-up does not block the thread it was running on.
+
 // ll_disk_cache stands for "low level disk cache": it is a helper in the
 // implementation of the local disk cache.
 
@@ -37,6 +54,20 @@ struct ll_disk_cache_config
     std::optional<std::string> directory;
     std::optional<std::size_t> size_limit;
     bool start_empty{};
+    // The algorithm calculating the digests (and keys) stored in the cache.
+    // It is recorded in the database; a cache created with a different
+    // algorithm is cleared.
+    digest_algorithm algorithm{digest_algorithm::SHA256};
+    // If true, the database is opened in WAL mode, with num_read_connections
+    // read-only connections for find().
+    // Note that reset() does not change the number of index threads, set
+    // from the configuration passed to the constructor.
+    bool wal_mode{};
+    std::size_t num_read_connections{4};
+    // If true, look-ups are answered from an in-memory copy of the index.
+    // Costs memory proportional to the number of entries, and initialization
+    // time to load it.
+    bool memory_index{};
 };
 
 // An entry in the CAS.
@@ -61,6 +92,24 @@ struct ll_disk_cache_cas_entry
     int64_t original_size;
 };
 
+// An insert that is part of a batch (see ll_disk_cache::insert_batch()).
+struct ll_disk_cache_insert
+{
+    std::string ac_key;
+
+    std::string digest;
+
+    // The value to store in the database. If nullopt, the value has already
+    // been written (possibly compressed) to the external file for digest.
+    std::optional<blob> value;
+
+    // the size of the value, as stored in the cache (in bytes)
+    std::size_t size;
+
+    // the original (decompressed) size of the value
+    std::size_t original_size;
+};
+
 // This exception indicates a failure in the operation of the disk cache.
 CRADLE_DEFINE_EXCEPTION(ll_disk_cache_failure)
 // This provides the path to the disk cache directory.
@@ -105,11 +154,23 @@ class ll_disk_cache
     std::optional<ll_disk_cache_cas_entry>
     find(std::string const& ac_key);
 
+    // Like find(), but performed on the index thread. The awaiting coroutine
+    // resumes on that thread, and should move to another one (e.g. a thread
+    // pool) before doing any real work, so that the index thread is available
+    // for the next look-up.
+    cppcoro::task<std::optional<ll_disk_cache_cas_entry>>
+    find_async(std::string ac_key);
+
     // Returns the ac_id for the specified AC entry if existing, or nullopt
     // otherwise. No impact on hit_count / miss_count.
     std::optional<int64_t>
     look_up_ac_id(std::string const& ac_key);
 
+    // Returns true if the CAS has an entry for digest. No impact on
+    // hit_count / miss_count.
+    bool
+    has_cas_entry(std::string const& digest);
+
     // Add a small entry to the cache.
     //
     // This should only be used on entries that are known to be smaller than
@@ -126,6 +187,15 @@ class ll_disk_cache
         blob const& value,
         std::optional<std::size_t> original_size = std::nullopt);
 
+    // Add a batch of entries to the cache, in a single database transaction.
+    //
+    // An entry whose value is stored in an external file must have that
+    // file written before the call; if the file is missing (e.g., removed by
+    // an eviction in the meantime), the entry is skipped. If anything fails,
+    // none of the entries are added.
+    void
+    insert_batch(std::vector<ll_disk_cache_insert> const& inserts);
+
     // Add an arbitrarily large entry to the cache.
     //
     // This is a two-part process.
@@ -1,5 +1,7 @@
 // A reference key-value store based on a local disk cache.
 
+#include <atomic>
+#include <filesystem>
 #include <stdexcept>
 
 #include <boost/numeric/conversion/cast.hpp>
@@ -15,6 +17,7 @@
 #include <cradle/inner/fs/types.h>
 #include <cradle/inner/service/resources.h>
 #include <cradle/inner/service/secondary_storage_intf.h>
+#include <cradle/plugins/secondary_cache/local/disk_cache_file_mapping.h>
 #include <cradle/plugins/secondary_cache/local/local_disk_cache.h>
 
 namespace cradle {
@@ -24,14 +27,6 @@ class disk_cache_error : public std::runtime_error
     using runtime_error::runtime_error;
 };
 
-static cppcoro::task<std::string>
-read_file_contents(
-    cppcoro::static_thread_pool& read_pool, file_path const& path)
-{
-    co_await read_pool.schedule();
-    co_return read_file_contents(path);
-}
-
 static bool
 get_check_file_data(service_config const& config)
 {
@@ -46,7 +41,26 @@ make_ll_disk_cache_config(service_config const& config)
         config.get_optional_string(local_disk_cache_config_keys::DIRECTORY),
         config.get_optional_number(local_disk_cache_config_keys::SIZE_LIMIT),
         config.get_bool_or_default(
-            local_disk_cache_config_keys::START_EMPTY, false)};
+            local_disk_cache_config_keys::START_EMPTY, false),
+        get_digest_algorithm(config),
+        config.get_bool_or_default(
+            local_disk_cache_config_keys::WAL_MODE, false),
+        static_cast<std::size_t>(config.get_number_or_default(
+            local_disk_cache_config_keys::NUM_READ_CONNECTIONS, 4)),
+        config.get_bool_or_default(
+            local_disk_cache_config_keys::MEMORY_INDEX, false)};
+}
+
+static std::size_t
+get_mmap_threshold(service_config const& config)
+{
+#ifdef _WIN32
+    // Files are not mapped on Windows; see disk_cache_file_mapping.h.
+    return 0;
+#else
+    return static_cast<std::size_t>(config.get_number_or_default(
+        local_disk_cache_config_keys::MMAP_THRESHOLD, 0));
+#endif
 }
 
 static uint32_t
@@ -70,10 +84,30 @@ get_poll_interval(service_config const& config)
         local_disk_cache_config_keys::POLL_INTERVAL, 200));
 }
 
+static std::size_t
+get_write_batch_size(service_config const& config)
+{
+    return static_cast<std::size_t>(config.get_number_or_default(
+        local_disk_cache_config_keys::WRITE_BATCH_SIZE, 256));
+}
+
+static int
+get_write_batch_delay(service_config const& config)
+{
+    return static_cast<int>(config.get_number_or_default(
+        local_disk_cache_config_keys::WRITE_BATCH_DELAY, 50));
+}
+
 local_disk_cache::local_disk_cache(service_config const& config)
     : check_file_data_{get_check_file_data(config)},
+      algo_{get_digest_algorithm(config)},
+      mmap_threshold_{get_mmap_threshold(config)},
       ll_cache_{make_ll_disk_cache_config(config)},
       poller_{ll_cache_, get_poll_interval(config)},
+      write_queue_{
+          ll_cache_,
+          get_write_batch_size(config),
+          get_write_batch_delay(config)},
       read_pool_{get_num_threads_read_pool(config)},
       write_pool_{get_num_threads_write_pool(config)},
       logger_{spdlog::get("cradle")}
@@ -92,7 +126,12 @@ local_disk_cache::read(std::string key)
 {
     try
     {
-        auto entry = ll_cache_.find(key);
+        // The index look-up happens on the ll_disk_cache's index thread;
+        // reading a file and decompressing its data, on the read pool. The
+        // caller resumes on the read pool too, leaving the index thread
+        // free for the next look-up.
+        auto entry = co_await ll_cache_.find_async(key);
+        co_await read_pool_.schedule();
         if (!entry)
         {
             logger_->info("disk cache miss on {}", key);
@@ -107,8 +146,16 @@ local_disk_cache::read(std::string key)
         else
         {
             auto path{ll_cache_.get_path_for_digest(entry->digest)};
+            // The file holds the value uncompressed if and only if its size
+            // equals the original size; see write().
+            if (entry->size == entry->original_size)
+            {
+                logger_->debug(
+                    "loading file for key {}: {}", key, path.string());
+                co_return load_uncompressed_file_data(key, *entry, path);
+            }
             logger_->debug("reading file for key {}: {}", key, path.string());
-            auto data = co_await read_file_contents(read_pool_, path);
+            auto data = read_file_contents(path);
             auto result = decompress_file_data(key, *entry, data);
             logger_->debug("returning for {}", key);
             co_return result;
@@ -153,7 +200,7 @@ local_disk_cache::decompress_file_data(
     if (check_file_data_)
     {
         logger_->debug("checking digest over decompressed data");
-        auto digest = get_unique_string_tmpl(decompressed);
+        auto digest = get_unique_string_tmpl(decompressed, algo_);
         if (digest != entry.digest)
         {
             throw disk_cache_error("digest mismatch on decompressed data");
@@ -163,54 +210,140 @@ local_disk_cache::decompress_file_data(
     return make_blob(std::move(decompressed));
 }
 
+blob
+local_disk_cache::load_uncompressed_file_data(
+    std::string const& key,
+    ll_disk_cache_cas_entry const& entry,
+    file_path const& path)
+{
+#ifndef _WIN32
+    auto owner{std::make_shared<disk_cache_file_mapping>(path)};
+    blob result{owner, owner->bytes(), owner->size()};
+#else
+    auto result{make_blob(read_file_contents(path))};
+#endif
+    auto original_size = boost::numeric_cast<std::size_t>(entry.original_size);
+    if (result.size() != original_size)
+    {
+        throw disk_cache_error(fmt::format(
+            "file has {} bytes, expected {}", result.size(), original_size));
+    }
+
+    if (check_file_data_)
+    {
+        logger_->debug("checking digest over uncompressed data for {}", key);
+        auto digest = get_unique_string_tmpl(result, algo_);
+        if (digest != entry.digest)
+        {
+            throw disk_cache_error("digest mismatch on uncompressed data");
+        }
+    }
+
+    return result;
+}
+
+// Writes data to path via a temporary file, so that a concurrent reader
+// never sees a partially written file.
+static void
+write_file_atomically(
+    file_path const& path, void const* data, std::size_t size)
+{
+    static std::atomic<unsigned> tmp_counter{0};
+    file_path tmp_path{path};
+    tmp_path += fmt::format(".tmp{}", tmp_counter++);
+    {
+        std::ofstream output;
+        open_file(
+            output,
+            tmp_path,
+            std::ios::out | std::ios::trunc | std::ios::binary);
+        output.write(static_cast<char const*>(data), size);
+    }
+    std::filesystem::rename(tmp_path, path);
+}
+
 cppcoro::task<void>
 local_disk_cache::write(std::string key, blob value)
 {
+    // The value is digested, compressed and written to a file (if needed) on
+    // the write pool; the database insert is queued on write_queue_, to be
+    // batched with other inserts.
     write_pool_.detach_task([&ll_cache = ll_cache_,
+                             &write_queue = write_queue_,
                              &logger = *logger_,
+                             algo = algo_,
+                             mmap_threshold = mmap_threshold_,
                              key,
                              value] {
         try
         {
-            auto digest{get_unique_string_tmpl(value)};
+            auto digest{get_unique_string_tmpl(value, algo)};
             // A value is stored in an external file only if:
             // - It's big enough; and
             // - It's not already stored in a blob file.
-            if (value.size() > 1024 && !value.mapped_file_data_owner())
+            bool const in_file{
+                value.size() > 1024 && !value.mapped_file_data_owner()};
+            if (in_file && ll_cache.has_cas_entry(digest))
+            {
+                // The existing file is kept: replacing it could change the
+                // value's encoding (e.g., after a change of mmap_threshold)
+                // from the one its CAS entry records. If the entry gets
+                // evicted in the meantime, insert_batch() finds no file of
+                // this size, and skips the insert.
+                write_queue.push(ll_disk_cache_insert{
+                    key,
+                    std::move(digest),
+                    std::nullopt,
+                    value.size(),
+                    value.size()});
+            }
+            else if (in_file)
             {
-                auto optional_cas_id = ll_cache.initiate_insert(key, digest);
-                if (optional_cas_id)
+                // A value at or above the mmap threshold is stored
+                // uncompressed, so that read() can map it. So is a value that
+                // does not compress, as the reader tells an uncompressed file
+                // by its size equaling the value's.
+                byte_vector compressed;
+                void const* file_data = value.data();
+                std::size_t file_size = value.size();
+                if (mmap_threshold == 0 || value.size() < mmap_threshold)
                 {
-                    auto cas_id = *optional_cas_id;
                     auto max_compressed_size
                         = lz4::max_compressed_size(value.size());
-                    byte_vector compressed(max_compressed_size);
+                    compressed.resize(max_compressed_size);
                     auto actual_compressed_size = lz4::compress(
                         compressed.data(),
                         max_compressed_size,
                         value.data(),
                         value.size());
-
+                    if (actual_compressed_size < value.size())
                     {
-                        auto path = ll_cache.get_path_for_digest(digest);
-                        logger.debug("writing {}", path.string());
-                        std::ofstream output;
-                        open_file(
-                            output,
-                            path,
-                            std::ios::out | std::ios::trunc
-                                | std::ios::binary);
-                        output.write(
-                            reinterpret_cast<char const*>(compressed.data()),
-                            actual_compressed_size);
+                        file_data = compressed.data();
+                        file_size = actual_compressed_size;
                     }
-                    ll_cache.finish_insert(
-                        cas_id, actual_compressed_size, value.size());
                 }
+
+                // The file is written before its entry is queued, so the
+                // entry refers to a complete file once it is in the
+                // database.
+                auto path = ll_cache.get_path_for_digest(digest);
+                logger.debug("writing {}", path.string());
+                write_file_atomically(path, file_data, file_size);
+                write_queue.push(ll_disk_cache_insert{
+                    key,
+                    std::move(digest),
+                    std::nullopt,
+                    file_size,
+                    value.size()});
             }
             else
             {
-                ll_cache.insert(key, digest, value);
+                write_queue.push(ll_disk_cache_insert{
+                    key,
+                    std::move(digest),
+                    value,
+                    value.size(),
+                    value.size()});
             }
         }
         catch (std::exception& e)
@@ -241,13 +374,20 @@ local_disk_cache::read_raw_value(std::string const& key)
 void
 local_disk_cache::write_raw_value(std::string const& key, blob const& value)
 {
-    ll_cache_.insert(key, get_unique_string_tmpl(value), value);
+    ll_cache_.insert(key, get_unique_string_tmpl(value, algo_), value);
 }
 
 bool
 local_disk_cache::busy_writing_to_file() const
 {
-    return write_pool_.get_tasks_total() > 0;
+    return write_pool_.get_tasks_total() > 0 || !write_queue_.empty();
+}
+
+void
+local_disk_cache::flush()
+{
+    write_pool_.wait();
+    write_queue_.flush();
 }
 
 } // namespace cradle
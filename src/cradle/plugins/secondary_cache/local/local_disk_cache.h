@@ -13,6 +13,7 @@
 #include <cradle/inner/service/secondary_storage_intf.h>
 #include <cradle/plugins/secondary_cache/local/disk_cache_info.h>
 #include <cradle/plugins/secondary_cache/local/disk_cache_poller.h>
+#include <cradle/plugins/secondary_cache/local/disk_cache_write_queue.h>
 #include <cradle/plugins/secondary_cache/local/ll_disk_cache.h>
 
 /*
@@ -57,10 +58,44 @@ struct local_disk_cache_config_keys
     // (Optional integer)
     inline static std::string const POLL_INTERVAL{"disk_cache/poll_interval"};
 
+    // Maximum number of entries written to the database in one transaction
+    // (Optional integer)
+    inline static std::string const WRITE_BATCH_SIZE{
+        "disk_cache/write_batch_size"};
+
+    // Maximum time, in ms, that an entry waits before being written to the
+    // database
+    // (Optional integer)
+    inline static std::string const WRITE_BATCH_DELAY{
+        "disk_cache/write_batch_delay"};
+
     // (Optional boolean)
     // If true, the cache is cleared on initialization.
     inline static std::string const START_EMPTY{"disk_cache/start_empty"};
 
+    // (Optional boolean)
+    // If true, the database is opened in WAL mode, and look-ups use a pool of
+    // read-only connections, so that they can run concurrently.
+    inline static std::string const WAL_MODE{"disk_cache/wal_mode"};
+
+    // Number of read-only database connections in WAL mode
+    // (Optional integer)
+    inline static std::string const NUM_READ_CONNECTIONS{
+        "disk_cache/num_read_connections"};
+
+    // (Optional boolean)
+    // If true, look-ups are answered from an in-memory copy of the database
+    // index, loaded on initialization.
+    inline static std::string const MEMORY_INDEX{"disk_cache/memory_index"};
+
+    // Values of at least this size (in bytes) are stored uncompressed, and
+    // read by memory-mapping their file instead of copying it; 0 (the
+    // default) means that file values are always compressed.
+    // Ignored on Windows, where files are not mapped.
+    // (Optional integer)
+    inline static std::string const MMAP_THRESHOLD{
+        "disk_cache/mmap_threshold"};
+
     // (Optional boolean)
     // If true, data read from a disk cache file is verified using a digest.
     inline static std::string const CHECK_FILE_DATA{
@@ -120,12 +155,22 @@ class local_disk_cache : public secondary_storage_intf
     bool
     busy_writing_to_file() const;
 
+    // Waits until all values passed to write() are in the cache.
+    void
+    flush();
+
  private:
     std::string const name_{"disk_cache"};
     bool check_file_data_;
+    digest_algorithm algo_;
+    std::size_t mmap_threshold_;
     ll_disk_cache ll_cache_;
     disk_cache_poller poller_;
+    // Batches the database inserts coming from write_pool_ tasks
+    disk_cache_write_queue write_queue_;
     cppcoro::static_thread_pool read_pool_;
+    // Declared after write_queue_, so that its tasks finish first on
+    // destruction
     BS::thread_pool write_pool_;
     std::shared_ptr<spdlog::logger> logger_;
 
@@ -134,6 +179,13 @@ class local_disk_cache : public secondary_storage_intf
         std::string const& key,
         ll_disk_cache_cas_entry const& entry,
         std::string const& data);
+
+    // Maps the file (copies it on Windows) holding an uncompressed value.
+    blob
+    load_uncompressed_file_data(
+        std::string const& key,
+        ll_disk_cache_cas_entry const& entry,
+        file_path const& path);
 };
 
 } // namespace cradle
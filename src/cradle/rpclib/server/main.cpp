@@ -155,6 +155,10 @@ create_config_map(cli_options const& options)
         config_map[inner_config_keys::SECONDARY_CACHE_FACTORY]
             = options.secondary_cache;
         config_map[local_disk_cache_config_keys::DIRECTORY] = cache_dir;
+        config_map[inner_config_keys::MEMORY_CACHE_WARM_START_FILE]
+            = cache_dir + "/warm_start.txt";
+        config_map[inner_config_keys::RESOLVE_DURATIONS_FILE]
+            = cache_dir + "/resolve_durations.txt";
     }
     config_map[blob_cache_config_keys::DIRECTORY] = cache_dir;
     config_map[http_cache_config_keys::PORT] = 9090U;
@@ -180,6 +184,8 @@ run_server(cli_options const& options)
     if (!options.contained)
     {
         service.set_secondary_cache(create_secondary_storage(service));
+        service.start_warm_start_prefetch();
+        service.load_resolve_durations();
     }
     service.set_requests_storage(
         std::make_unique<simple_blob_storage>("simple"));
@@ -292,6 +298,8 @@ run_server(cli_options const& options)
     srv.run();
 
     rpc::this_server().stop();
+    service.save_warm_start_keys();
+    service.save_resolve_durations();
 }
 
 int
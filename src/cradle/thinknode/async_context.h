@@ -207,7 +207,8 @@ class async_thinknode_context final : public root_local_async_context_intf,
                                       public remote_async_context_intf,
                                       public local_async_ctx_owner_intf,
                                       public remote_async_ctx_owner_intf,
-                                      public test_params_context_mixin
+                                      public test_params_context_mixin,
+                                      public async_scheduling_context_mixin
 {
  public:
     async_thinknode_context(
@@ -336,6 +337,18 @@ class async_thinknode_context final : public root_local_async_context_intf,
         get_local_root().update_status_error(errmsg);
     }
 
+    float
+    get_progress() override
+    {
+        return get_local_root().get_progress();
+    }
+
+    void
+    update_progress(float progress) override
+    {
+        get_local_root().update_progress(progress);
+    }
+
     // root_local_async_context_intf
     std::unique_ptr<req_visitor_intf>
     make_ctx_tree_builder() override
@@ -474,6 +487,11 @@ class async_thinknode_context final : public root_local_async_context_intf,
     remote_async_context_intf&
     prepare_for_remote_resolution() override;
 
+    // Creates a new context with the same settings as this one, for a
+    // resolution running alongside this one's.
+    std::unique_ptr<async_thinknode_context>
+    spawn() const;
+
     // Returns the root context object for the current resolution, whether
     // local or remote. Blocks until the object is available; it becomes so
     // in resolve_request() or co_await resolve_request() on this context.
@@ -528,6 +546,7 @@ class async_thinknode_context final : public root_local_async_context_intf,
     get_local_root() const;
 };
 static_assert(ValidFinalContext<async_thinknode_context>);
+static_assert(SpawnableContext<async_thinknode_context>);
 
 } // namespace cradle
 
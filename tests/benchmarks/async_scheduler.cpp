@@ -0,0 +1,103 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+#include <cppcoro/sync_wait.hpp>
+
+#include <cradle/inner/requests/function.h>
+#include <cradle/inner/resolve/resolve_request.h>
+#include <cradle/inner/service/config.h>
+#include <cradle/inner/service/resources.h>
+#include <cradle/plugins/domain/testing/context.h>
+
+#include "../support/inner_service.h"
+
+using namespace cradle;
+
+namespace {
+
+std::unique_ptr<inner_resources>
+make_resources(int num_threads)
+{
+    auto config_map{make_inner_tests_config().get_config_map()};
+    config_map[inner_config_keys::ASYNC_CONCURRENCY]
+        = static_cast<std::size_t>(num_threads);
+    return std::make_unique<inner_resources>(service_config{config_map});
+}
+
+auto work = [](int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{ms});
+    return ms;
+};
+
+auto sum8 = [](int a, int b, int c, int d, int e, int f, int g, int h) {
+    return a + b + c + d + e + f + g + h;
+};
+
+// A wide request tree, resolved asynchronously on two threads: seven short
+// subrequests (5ms), and one long one (40ms, the critical path) that is
+// queued on the scheduler after the short ones. (The last subrequest runs on
+// the root's thread.) Without predictions, the long subrequest starts only
+// after the short ones queued before it; with predictions, it starts first.
+auto
+make_skewed_tree()
+{
+    request_props<caching_level_type::none> root_props{
+        request_uuid{"benchmark-skewed-tree"}};
+    request_props<caching_level_type::none> short_props{
+        request_uuid{"benchmark-skewed-tree-short"}};
+    request_props<caching_level_type::none> long_props{
+        request_uuid{"benchmark-skewed-tree-long"}};
+    auto short_req = [&] { return rq_function(short_props, work, 5); };
+    return rq_function(
+        root_props,
+        sum8,
+        short_req(),
+        short_req(),
+        short_req(),
+        short_req(),
+        short_req(),
+        short_req(),
+        rq_function(long_props, work, 40),
+        short_req());
+}
+
+} // namespace
+
+// Makespan of resolving the skewed request tree. For the unpredicted case,
+// each iteration uses new resources, so that no durations were recorded yet;
+// for the predicted case, a first resolution records the durations.
+template<bool Predict>
+void
+BM_async_scheduler_request_tree(benchmark::State& state)
+{
+    constexpr int num_threads{2};
+    auto req{make_skewed_tree()};
+    auto resources{make_resources(num_threads)};
+    if constexpr (Predict)
+    {
+        atst_context ctx{*resources};
+        cppcoro::sync_wait(resolve_request(ctx, req));
+    }
+    for (auto _ : state)
+    {
+        if constexpr (!Predict)
+        {
+            state.PauseTiming();
+            resources = make_resources(num_threads);
+            state.ResumeTiming();
+        }
+        atst_context ctx{*resources};
+        benchmark::DoNotOptimize(
+            cppcoro::sync_wait(resolve_request(ctx, req)));
+    }
+}
+BENCHMARK(BM_async_scheduler_request_tree<false>)
+    ->Name("BM_async_scheduler_request_tree_unpredicted")
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK(BM_async_scheduler_request_tree<true>)
+    ->Name("BM_async_scheduler_request_tree_predicted")
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -1,4 +1,6 @@
+#include <cstdlib>
 #include <iostream>
+#include <new>
 
 #include <benchmark/benchmark.h>
 
@@ -29,4 +31,37 @@ check_benchmarks_skipped_with_error()
     return exit_code;
 }
 
+static thread_local std::size_t num_heap_allocations{0};
+
+std::size_t
+get_num_heap_allocations()
+{
+    return num_heap_allocations;
+}
+
 } // namespace cradle
+
+// Counting replacements for the global (non-aligned) operator new and delete;
+// the other forms forward to these.
+void*
+operator new(std::size_t size)
+{
+    cradle::num_heap_allocations += 1;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
@@ -26,6 +26,13 @@ handle_benchmark_exception(benchmark::State& state, std::string const& what);
 int
 check_benchmarks_skipped_with_error();
 
+/*
+ * Returns the number of global operator new calls made on the current thread.
+ * The benchmark runner replaces operator new to count these.
+ */
+std::size_t
+get_num_heap_allocations();
+
 template<Request Req>
 void
 call_resolve_by_ref_loop(Req const& req, inner_resources& resources)
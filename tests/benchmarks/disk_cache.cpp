@@ -1,4 +1,9 @@
+#include <optional>
+#include <set>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 #include <fmt/format.h>
@@ -43,4 +48,217 @@ BM_disk_cache_read(benchmark::State& state)
 
 BENCHMARK(BM_disk_cache_read);
 
+// Looks up num_items entries from each of num_threads threads, per
+// iteration. In WAL mode (wal_mode == 1), the look-ups use num_threads read
+// connections; otherwise, they serialize on the cache's only connection.
+void
+BM_disk_cache_read_concurrent(benchmark::State& state)
+{
+    bool wal_mode = state.range(0) != 0;
+    auto num_threads = static_cast<int>(state.range(1));
+    std::string directory{"disk_cache"};
+    reset_directory(directory);
+    ll_disk_cache_config config;
+    config.directory = directory;
+    config.wal_mode = wal_mode;
+    config.num_read_connections = static_cast<std::size_t>(num_threads);
+    ll_disk_cache cache{config};
+    constexpr int num_items = 200;
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < num_items; ++i)
+    {
+        auto key{get_unique_string_tmpl(fmt::format("key{}", i))};
+        auto value{make_blob(fmt::format("value{}", i))};
+        auto digest{get_unique_string_tmpl(value)};
+        cache.insert(key, digest, value);
+        keys.push_back(key);
+    }
+
+    for (auto _ : state)
+    {
+        {
+            std::vector<std::jthread> threads;
+            for (int t = 0; t < num_threads; ++t)
+            {
+                threads.emplace_back([&] {
+                    for (auto const& key : keys)
+                    {
+                        // One combined AC / CAS look-up in WAL mode; two
+                        // queries otherwise
+                        benchmark::DoNotOptimize(cache.find(key));
+                    }
+                });
+            }
+        }
+        cache.flush_ac_usage(true);
+    }
+    state.SetItemsProcessed(state.iterations() * num_threads * num_items);
+}
+
+BENCHMARK(BM_disk_cache_read_concurrent)
+    ->ArgsProduct({{0, 1}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// Inserts num_items small values per iteration, either one transaction per
+// insert (batched == 0), or in a single batch (batched == 1).
+void
+BM_disk_cache_write(benchmark::State& state)
+{
+    bool batched = state.range(0) != 0;
+    std::string directory{"disk_cache"};
+    reset_directory(directory);
+    ll_disk_cache_config config;
+    config.directory = directory;
+    ll_disk_cache cache{config};
+    constexpr int num_items = 100;
+
+    int round = 0;
+    std::vector<ll_disk_cache_insert> inserts;
+    for (auto _ : state)
+    {
+        // Each round inserts new entries.
+        state.PauseTiming();
+        inserts.clear();
+        for (int i = 0; i < num_items; ++i)
+        {
+            auto key{
+                get_unique_string_tmpl(fmt::format("key{}_{}", round, i))};
+            auto value{make_blob(fmt::format("value{}_{}", round, i))};
+            auto digest{get_unique_string_tmpl(value)};
+            auto size = value.size();
+            inserts.push_back(ll_disk_cache_insert{
+                std::move(key),
+                std::move(digest),
+                std::move(value),
+                size,
+                size});
+        }
+        ++round;
+        state.ResumeTiming();
+
+        if (batched)
+        {
+            cache.insert_batch(inserts);
+        }
+        else
+        {
+            for (auto const& insert : inserts)
+            {
+                cache.insert(insert.ac_key, insert.digest, *insert.value);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_items);
+}
+
+BENCHMARK(BM_disk_cache_write)->Arg(0)->Arg(1);
+
+// Returns the key for entry i in a cache populated by
+// populate_large_disk_cache().
+static std::string
+make_large_cache_key(int i)
+{
+    return get_unique_string_tmpl(fmt::format("key{}", i));
+}
+
+// Fills a disk cache directory with num_items entries, unless already done
+// during this run. The entries claim to have their values in files, which are
+// not created; they are only looked up.
+static std::string
+populate_large_disk_cache(int num_items)
+{
+    static std::set<int> populated;
+    std::string directory{fmt::format("disk_cache_{}", num_items)};
+    if (populated.contains(num_items))
+    {
+        return directory;
+    }
+    reset_directory(directory);
+    ll_disk_cache_config config;
+    config.directory = directory;
+    config.size_limit = std::size_t{1} << 40;
+    ll_disk_cache cache{config};
+    constexpr int batch_size = 10000;
+    std::vector<ll_disk_cache_insert> inserts;
+    for (int i = 0; i < num_items; ++i)
+    {
+        inserts.push_back(ll_disk_cache_insert{
+            make_large_cache_key(i),
+            get_unique_string_tmpl(fmt::format("value{}", i)),
+            std::nullopt,
+            100,
+            100});
+        if (inserts.size() == batch_size)
+        {
+            cache.insert_batch(inserts);
+            inserts.clear();
+        }
+    }
+    cache.insert_batch(inserts);
+    populated.insert(num_items);
+    return directory;
+}
+
+// Opens a disk cache holding num_items entries; with a memory index
+// (memory_index == 1), this includes loading the index.
+void
+BM_disk_cache_open(benchmark::State& state)
+{
+    bool memory_index = state.range(0) != 0;
+    auto num_items = static_cast<int>(state.range(1));
+    ll_disk_cache_config config;
+    config.directory = populate_large_disk_cache(num_items);
+    config.size_limit = std::size_t{1} << 40;
+    config.memory_index = memory_index;
+
+    for (auto _ : state)
+    {
+        ll_disk_cache cache{config};
+        benchmark::DoNotOptimize(cache);
+    }
+}
+
+BENCHMARK(BM_disk_cache_open)
+    ->ArgsProduct({{0, 1}, {1 << 16, 1 << 20}})
+    ->Unit(benchmark::kMillisecond);
+
+// Looks up num_lookups entries, spread over a disk cache holding num_items
+// entries, per iteration; either querying the database, or on the memory
+// index (memory_index == 1).
+void
+BM_disk_cache_find_large(benchmark::State& state)
+{
+    bool memory_index = state.range(0) != 0;
+    auto num_items = static_cast<int>(state.range(1));
+    ll_disk_cache_config config;
+    config.directory = populate_large_disk_cache(num_items);
+    config.size_limit = std::size_t{1} << 40;
+    config.memory_index = memory_index;
+    ll_disk_cache cache{config};
+    constexpr int num_lookups = 1000;
+
+    std::vector<std::string> keys;
+    int const stride = num_items / num_lookups;
+    for (int i = 0; i < num_lookups; ++i)
+    {
+        keys.push_back(make_large_cache_key(i * stride));
+    }
+
+    for (auto _ : state)
+    {
+        for (auto const& key : keys)
+        {
+            benchmark::DoNotOptimize(cache.find(key));
+        }
+        state.PauseTiming();
+        cache.flush_ac_usage(true);
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_lookups);
+}
+
+BENCHMARK(BM_disk_cache_find_large)
+    ->ArgsProduct({{0, 1}, {1 << 16, 1 << 20}});
+
 } // namespace cradle
@@ -3,7 +3,10 @@
 #include <spdlog/spdlog.h>
 
 #include <cradle/inner/requests/function.h>
+#include <cradle/inner/requests/interning.h>
+#include <cradle/inner/requests/map.h>
 #include <cradle/inner/requests/value.h>
+#include <cradle/inner/resolve/frame_pool.h>
 #include <cradle/inner/service/resources.h>
 
 #include "../support/inner_service.h"
@@ -182,6 +185,56 @@ BENCHMARK(BM_create_tri_tree_erased_intrsp<caching_level_type::memory, 4>)
 BENCHMARK(BM_create_tri_tree_erased_intrsp<caching_level_type::memory, 6>)
     ->Name("BM_create_function_request_cached_intrsp_tri_tree H=6");
 
+// Triangular tree where the two subtrees of each node are identical, so that
+// the tree has only H unique nodes.
+template<int H>
+auto
+create_shared_triangular_tree()
+{
+    request_props<caching_level_type::memory> props{
+        request_uuid{fmt::format("benchmark-shared-tri-{}", H)}};
+    if constexpr (H == 1)
+    {
+        return rq_function(props, add, 2, 1);
+    }
+    else
+    {
+        return rq_function(
+            props,
+            add,
+            create_shared_triangular_tree<H - 1>(),
+            create_shared_triangular_tree<H - 1>());
+    }
+}
+
+template<int H, bool interned>
+void
+BM_create_shared_tri_tree(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        if constexpr (interned)
+        {
+            request_interning_table table;
+            request_interning_scope scope{table};
+            benchmark::DoNotOptimize(create_shared_triangular_tree<H>());
+        }
+        else
+        {
+            benchmark::DoNotOptimize(create_shared_triangular_tree<H>());
+        }
+    }
+}
+
+BENCHMARK(BM_create_shared_tri_tree<6, false>)
+    ->Name("BM_create_function_request_cached_shared_tri_tree H=6");
+BENCHMARK(BM_create_shared_tri_tree<6, true>)
+    ->Name("BM_create_function_request_cached_shared_tri_tree_interned H=6");
+BENCHMARK(BM_create_shared_tri_tree<10, false>)
+    ->Name("BM_create_function_request_cached_shared_tri_tree H=10");
+BENCHMARK(BM_create_shared_tri_tree<10, true>)
+    ->Name("BM_create_function_request_cached_shared_tri_tree_interned H=10");
+
 template<caching_level_type level, int H>
 void
 BM_resolve_thin_tree_erased(benchmark::State& state)
@@ -204,14 +257,74 @@ BENCHMARK(BM_resolve_thin_tree_erased<caching_level_type::none, 64>)
     ->Name("BM_resolve_function_request_uncached_thin_tree H=64")
     ->Apply(thousand_loops);
 
-template<caching_level_type level, int H, bool recursive_vbc = false>
+// The uncached plain-function trees are resolved without coroutines; these
+// benchmarks resolve the same trees with direct resolution disabled, via
+// coroutines (as before direct resolution existed).
+template<int H>
+void
+BM_resolve_thin_tree_erased_via_coroutines(benchmark::State& state)
+{
+    auto config_map{make_inner_tests_config().get_config_map()};
+    config_map[inner_config_keys::DIRECT_RESOLUTION] = false;
+    inner_resources resources{service_config{config_map}};
+    non_caching_request_resolution_context ctx{resources};
+    BM_resolve_request(
+        state, ctx, create_thin_tree_erased<caching_level_type::none, H>());
+}
+
+BENCHMARK(BM_resolve_thin_tree_erased_via_coroutines<2>)
+    ->Name("BM_resolve_function_request_uncached_thin_tree_via_coro H=2")
+    ->Apply(thousand_loops);
+BENCHMARK(BM_resolve_thin_tree_erased_via_coroutines<4>)
+    ->Name("BM_resolve_function_request_uncached_thin_tree_via_coro H=4")
+    ->Apply(thousand_loops);
+BENCHMARK(BM_resolve_thin_tree_erased_via_coroutines<16>)
+    ->Name("BM_resolve_function_request_uncached_thin_tree_via_coro H=16")
+    ->Apply(thousand_loops);
+BENCHMARK(BM_resolve_thin_tree_erased_via_coroutines<64>)
+    ->Name("BM_resolve_function_request_uncached_thin_tree_via_coro H=64")
+    ->Apply(thousand_loops);
+
+// Reports the pooled coroutine frame allocations per resolved request node,
+// how many of these missed the pool and went to the heap (see
+// frame_pool.h), and all heap allocations per node (num_heap_allocations
+// being the number made during the benchmark). Comparing the latter between
+// the benchmarks with and without frame pool shows the pool's effect.
+static void
+report_frame_allocations(
+    benchmark::State& state, int num_nodes, std::size_t num_heap_allocations)
+{
+    auto stats{get_coroutine_frame_pool_stats()};
+    double num_resolved
+        = static_cast<double>(state.iterations()) * 1000 * num_nodes;
+    state.counters["pooled_frames/node"]
+        = static_cast<double>(stats.num_allocations) / num_resolved;
+    state.counters["pool_misses/node"]
+        = static_cast<double>(stats.num_heap_allocations) / num_resolved;
+    state.counters["heap_allocs/node"]
+        = static_cast<double>(num_heap_allocations) / num_resolved;
+}
+
+template<
+    caching_level_type level,
+    int H,
+    bool recursive_vbc = false,
+    bool frame_pool = true>
 void
 BM_resolve_tri_tree_erased(benchmark::State& state)
 {
     auto resources{make_inner_test_resources()};
     request_resolution_context<level> ctx{*resources};
+    set_coroutine_frame_pool_enabled(frame_pool);
+    reset_coroutine_frame_pool_stats();
+    auto num_heap_allocations_before{get_num_heap_allocations()};
     BM_resolve_request(
         state, ctx, create_triangular_tree_erased<level, H, recursive_vbc>());
+    report_frame_allocations(
+        state,
+        (1 << H) - 1,
+        get_num_heap_allocations() - num_heap_allocations_before);
+    set_coroutine_frame_pool_enabled(true);
 }
 
 BENCHMARK(BM_resolve_tri_tree_erased<caching_level_type::none, 2>)
@@ -262,6 +375,10 @@ BENCHMARK(BM_resolve_tri_tree_erased<caching_level_type::memory_vb, 4, true>)
 BENCHMARK(BM_resolve_tri_tree_erased<caching_level_type::memory, 6>)
     ->Name("BM_resolve_function_request_mem_cached_tri_tree H=6 CBC")
     ->Apply(thousand_loops);
+BENCHMARK(
+    BM_resolve_tri_tree_erased<caching_level_type::memory, 6, false, false>)
+    ->Name("BM_resolve_function_request_mem_cached_tri_tree H=6 CBC no pool")
+    ->Apply(thousand_loops);
 BENCHMARK(BM_resolve_tri_tree_erased<caching_level_type::memory_vb, 6, false>)
     ->Name("BM_resolve_function_request_mem_cached_tri_tree H=6 VBC-top")
     ->Apply(thousand_loops);
@@ -308,3 +425,87 @@ BENCHMARK(BM_resolve_triangular_tree_erased_full<4>)
 BENCHMARK(BM_resolve_triangular_tree_erased_full<6>)
     ->Name("BM_resolve_function_request_disk_cached_tri_tree H=6")
     ->Apply(thousand_loops);
+
+// Resolves a batch of memory-cached requests, half of which are duplicates,
+// with a cold memory cache; either via resolve_requests(), or by calling
+// resolve_request() for each request.
+template<bool batch>
+void
+BM_resolve_request_batch(benchmark::State& state)
+{
+    auto resources{make_inner_test_resources()};
+    caching_request_resolution_context ctx{*resources};
+    request_props<caching_level_type::memory> props{
+        request_uuid{"benchmark-batch"}};
+    auto const num_reqs{static_cast<int>(state.range(0))};
+    std::vector<decltype(rq_function(props, add, 0, 0))> reqs;
+    for (int i = 0; i < num_reqs; ++i)
+    {
+        reqs.push_back(rq_function(props, add, i / 2, 1));
+    }
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        resources->reset_memory_cache();
+        state.ResumeTiming();
+        if constexpr (batch)
+        {
+            benchmark::DoNotOptimize(
+                cppcoro::sync_wait(resolve_requests(ctx, reqs)));
+        }
+        else
+        {
+            for (auto const& req : reqs)
+            {
+                benchmark::DoNotOptimize(
+                    cppcoro::sync_wait(resolve_request(ctx, req)));
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_resolve_request_batch<false>)
+    ->Name("BM_resolve_function_request_loop")
+    ->Arg(1000)
+    ->Arg(10000);
+BENCHMARK(BM_resolve_request_batch<true>)
+    ->Name("BM_resolve_function_request_batch")
+    ->Arg(1000)
+    ->Arg(10000);
+
+// Resolves a map request over state.range(0) elements; compare the time per
+// element against BM_resolve_function_request_loop/batch, which need one
+// function request per element.
+template<caching_level_type level>
+void
+BM_resolve_map_request(benchmark::State& state)
+{
+    auto resources{make_inner_test_resources()};
+    request_resolution_context<level> ctx{*resources};
+    request_props<level, request_function_t::coro> props{make_uuid()};
+    auto const num_elems{static_cast<int>(state.range(0))};
+    std::vector<int> elems;
+    for (int i = 0; i < num_elems; ++i)
+    {
+        elems.push_back(i / 2);
+    }
+    auto req{rq_map(props, [](int x) { return x + 1; }, elems)};
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        resources->reset_memory_cache();
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(
+            cppcoro::sync_wait(resolve_request(ctx, req)));
+    }
+    state.SetItemsProcessed(state.iterations() * num_elems);
+}
+
+BENCHMARK(BM_resolve_map_request<caching_level_type::none>)
+    ->Name("BM_resolve_map_request_uncached")
+    ->Arg(1000)
+    ->Arg(10000);
+BENCHMARK(BM_resolve_map_request<caching_level_type::memory>)
+    ->Name("BM_resolve_map_request_mem_cached")
+    ->Arg(1000)
+    ->Arg(10000);
@@ -16,6 +16,7 @@
 
 #include <cradle/inner/core/get_unique_string.h>
 #include <cradle/inner/core/hash.h>
+#include <cradle/inner/core/type_interfaces.h>
 #include <cradle/inner/encodings/lz4.h>
 #include <cradle/plugins/domain/testing/requests.h>
 
@@ -84,6 +85,25 @@ BM_UniqueHashGetResult(benchmark::State& state)
     }
 }
 
+// Tree hash over a large blob; arguments are the blob size, and the maximum
+// number of threads hashing leaves
+void
+BM_UniqueHashGetResultLarge(benchmark::State& state)
+{
+    auto const size{static_cast<std::size_t>(state.range(0))};
+    auto const max_concurrency{static_cast<unsigned>(state.range(1))};
+    auto the_blob{make_blob(byte_vector(size, 0x5a))};
+    for (auto _ : state)
+    {
+        unique_hasher hasher;
+        update_unique_hash_tree(
+            hasher, the_blob.data(), the_blob.size(), max_concurrency);
+        benchmark::DoNotOptimize(hasher.get_result());
+    }
+    state.SetBytesProcessed(
+        static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
 // Unique hash string e.g. used for disk cache digest
 void
 BM_UniqueHashGetString(benchmark::State& state)
@@ -95,6 +115,18 @@ BM_UniqueHashGetString(benchmark::State& state)
     }
 }
 
+// Same, using the XXH3 algorithm
+void
+BM_UniqueHashGetStringXxh3(benchmark::State& state)
+{
+    auto the_blob = make_my_blob();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(
+            get_unique_string_tmpl(the_blob, digest_algorithm::XXH3_128));
+    }
+}
+
 void
 BM_BoostCrc32(benchmark::State& state)
 {
@@ -140,7 +172,11 @@ BM_Lz4Decompress(benchmark::State& state)
 BENCHMARK(BM_BoostHash);
 BENCHMARK(BM_CompareEqualBlobs);
 BENCHMARK(BM_UniqueHashGetResult);
+BENCHMARK(BM_UniqueHashGetResultLarge)
+    ->ArgsProduct({{16 << 20, 256 << 20}, {1, 2, 4, 8, 16}})
+    ->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_UniqueHashGetString);
+BENCHMARK(BM_UniqueHashGetStringXxh3);
 // Boost's CRC32 does not use hardware acceleration and is thus pretty slow;
 // even slower than hardware-accelerated SHA256.
 BENCHMARK(BM_BoostCrc32);
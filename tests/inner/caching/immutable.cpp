@@ -1,9 +1,16 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include <catch2/catch.hpp>
 #include <cppcoro/sync_wait.hpp>
 
+#include "../../support/concurrency_testing.h"
 #include <cradle/inner/caching/immutable.h>
 #include <cradle/inner/caching/immutable/local_locked_record.h>
 #include <cradle/inner/core/get_unique_string.h>
@@ -643,3 +650,437 @@ TEST_CASE("immutable caching - retry failure", tag)
     auto info1{get_summary_info(cache)};
     CHECK(info1.cas_total_size == sizeof(int));
 }
+
+TEST_CASE("sharded immutable cache", tag)
+{
+    constexpr int num_entries = 8;
+    constexpr std::size_t num_shards = 4;
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 4 * sizeof(int), .num_shards = num_shards}};
+
+    std::vector<std::unique_ptr<immutable_cache_ptr<int>>> ptrs;
+    for (int i = 0; i < num_entries; ++i)
+    {
+        auto key = make_captured_id(i);
+        ptrs.push_back(std::make_unique<immutable_cache_ptr<int>>(
+            cache, key, [i](untyped_immutable_cache_ptr& ptr) {
+                return test_task(ptr, i * 10);
+            }));
+        REQUIRE(await_cache_value(*ptrs.back()) == i * 10);
+    }
+
+    auto info0{get_summary_info(cache)};
+    CHECK(info0.ac_num_records == num_entries);
+    CHECK(info0.ac_num_records_in_use == num_entries);
+    CHECK(info0.cas_num_records == num_entries);
+    CHECK(info0.cas_total_size == num_entries * sizeof(int));
+    CHECK(info0.miss_count == num_entries);
+    REQUIRE(info0.shards.size() == num_shards);
+    int ac_total{};
+    std::size_t cas_size_total{};
+    for (auto const& shard_info : info0.shards)
+    {
+        ac_total += shard_info.ac_num_records;
+        cas_size_total += shard_info.cas_total_size;
+        CHECK(shard_info.lock_acquisitions > 0);
+        CHECK(shard_info.lock_contentions == 0);
+    }
+    CHECK(ac_total == num_entries);
+    CHECK(cas_size_total == info0.cas_total_size);
+
+    // Releasing all pointers makes all entries unused; the size limit applies
+    // to the cache as a whole, so only four of them can remain.
+    ptrs.clear();
+    auto info1{get_summary_info(cache)};
+    CHECK(info1.ac_num_records_in_use == 0);
+    CHECK(info1.ac_num_records_pending_eviction == 4);
+    CHECK(info1.cas_num_records == 4);
+    CHECK(info1.cas_total_size == 4 * sizeof(int));
+
+    clear_unused_entries(cache);
+    auto info2{get_summary_info(cache)};
+    CHECK(info2.ac_num_records == 0);
+    CHECK(info2.cas_num_records == 0);
+    CHECK(info2.cas_total_size == 0);
+}
+
+namespace {
+
+cppcoro::shared_task<void>
+timed_task(
+    untyped_immutable_cache_ptr& untyped_ptr,
+    int value,
+    std::chrono::nanoseconds resolve_time)
+{
+    using ptr_type = immutable_cache_ptr<int>;
+    auto& ptr = static_cast<ptr_type&>(untyped_ptr);
+    ptr.record_value(std::move(value), resolve_time);
+    co_return;
+}
+
+// Creates three entries, where entry 0 was expensive to resolve; the cache
+// has room for only two of them. Returns whether the entries remain in the
+// cache.
+std::vector<bool>
+run_eviction_scenario(immutable_cache_eviction_policy policy)
+{
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 2 * sizeof(int), .eviction_policy = policy}};
+    auto make_ptr = [&](int i, std::chrono::nanoseconds resolve_time) {
+        auto ptr = std::make_unique<immutable_cache_ptr<int>>(
+            cache,
+            make_captured_id(i),
+            [=](untyped_immutable_cache_ptr& ptr) {
+                return timed_task(ptr, i, resolve_time);
+            });
+        REQUIRE(await_cache_value(*ptr) == i);
+        return ptr;
+    };
+    // Entries 0 and 1 fit in the cache, so releasing them evicts nothing.
+    make_ptr(0, std::chrono::seconds{1});
+    make_ptr(1, std::chrono::nanoseconds{});
+    REQUIRE(get_summary_info(cache).ac_num_records_pending_eviction == 2);
+    // Releasing entry 2 causes one entry to be evicted.
+    make_ptr(2, std::chrono::nanoseconds{});
+    REQUIRE(get_summary_info(cache).ac_num_records_pending_eviction == 2);
+
+    std::vector<bool> present;
+    for (int i = 0; i < 3; ++i)
+    {
+        bool needed_creation = false;
+        immutable_cache_ptr<int> ptr(
+            cache, make_captured_id(i), [&](untyped_immutable_cache_ptr& ptr) {
+                needed_creation = true;
+                return test_task(ptr, i);
+            });
+        present.push_back(!needed_creation);
+    }
+    return present;
+}
+
+} // namespace
+
+TEST_CASE("immutable cache LRU eviction policy", tag)
+{
+    // The least recently used entry is evicted, even if it was expensive.
+    auto present{run_eviction_scenario(immutable_cache_eviction_policy::LRU)};
+    CHECK(present == std::vector<bool>{false, true, true});
+}
+
+TEST_CASE("immutable cache GDSF eviction policy", tag)
+{
+    // The expensive entry is retained; of the two cheap entries, the least
+    // recently used one is evicted.
+    auto present{run_eviction_scenario(immutable_cache_eviction_policy::GDSF)};
+    CHECK(present == std::vector<bool>{true, false, true});
+}
+
+TEST_CASE("immutable cache background eviction", tag)
+{
+    constexpr int num_entries = 8;
+    constexpr std::size_t size_limit = 4 * sizeof(int);
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = size_limit,
+        .background_eviction = true,
+        .low_watermark_percentage = 50}};
+
+    std::vector<std::unique_ptr<immutable_cache_ptr<int>>> ptrs;
+    for (int i = 0; i < num_entries; ++i)
+    {
+        ptrs.push_back(std::make_unique<immutable_cache_ptr<int>>(
+            cache, make_captured_id(i), [i](untyped_immutable_cache_ptr& ptr) {
+                return test_task(ptr, i);
+            }));
+        REQUIRE(await_cache_value(*ptrs.back()) == i);
+    }
+
+    // Releasing the pointers exceeds the size limit, waking up the background
+    // thread; it evicts entries until the unused size drops below the low
+    // watermark.
+    ptrs.clear();
+    REQUIRE(occurs_soon([&] {
+        return get_summary_info(cache).cas_total_size <= size_limit;
+    }));
+    auto info0{get_summary_info(cache)};
+    CHECK(info0.ac_num_records_in_use == 0);
+    CHECK(info0.ac_num_records == info0.cas_num_records);
+
+    // Explicitly clearing the cache still happens synchronously.
+    clear_unused_entries(cache);
+    auto info1{get_summary_info(cache)};
+    CHECK(info1.ac_num_records == 0);
+    CHECK(info1.cas_total_size == 0);
+}
+
+namespace {
+
+class test_string_codec : public cradle::detail::cas_value_codec
+{
+ public:
+    blob
+    serialize(cradle::detail::cas_record_base const& record) const override
+    {
+        using typed_cas_record = cradle::detail::cas_record<std::string>;
+        return make_blob(static_cast<typed_cas_record const&>(record).value());
+    }
+
+    std::unique_ptr<cradle::detail::cas_record_base>
+    deserialize(
+        digest_type const& digest, blob const& serialized) const override
+    {
+        return std::make_unique<cradle::detail::cas_record<std::string>>(
+            digest, to_string(serialized));
+    }
+};
+
+test_string_codec const the_test_string_codec;
+
+std::string
+make_cold_tier_value(int i)
+{
+    return std::string(1000, 'x') + std::to_string(i);
+}
+
+// Gets the value for entry i, returning whether it had to be created.
+bool
+get_string_entry(immutable_cache& cache, int i, bool with_codec)
+{
+    bool needed_creation = false;
+    immutable_cache_ptr<std::string> ptr(
+        cache, make_captured_id(i), [&](untyped_immutable_cache_ptr& ptr) {
+            needed_creation = true;
+            return [](untyped_immutable_cache_ptr& untyped_ptr,
+                      int i,
+                      bool with_codec) -> cppcoro::shared_task<void> {
+                auto& ptr = static_cast<immutable_cache_ptr<std::string>&>(
+                    untyped_ptr);
+                ptr.record_value(
+                    make_cold_tier_value(i),
+                    {},
+                    with_codec ? &the_test_string_codec : nullptr);
+                co_return;
+            }(ptr, i, with_codec);
+        });
+    REQUIRE(await_cache_value(ptr) == make_cold_tier_value(i));
+    return needed_creation;
+}
+
+} // namespace
+
+TEST_CASE("immutable cache cold tier", tag)
+{
+    // All unused entries are evicted from the hot tier.
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 0, .cold_tier_size_limit = 0x10000}};
+
+    CHECK(get_string_entry(cache, 0, true));
+    auto info0{get_summary_info(cache)};
+    CHECK(info0.ac_num_records == 1);
+    CHECK(info0.ac_num_records_pending_eviction == 1);
+    CHECK(info0.cas_num_records == 0);
+    CHECK(info0.cold_num_records == 1);
+    // The value compresses well.
+    CHECK(info0.cold_total_size > 0);
+    CHECK(info0.cold_total_size < 1000);
+
+    // A hit in the cold tier restores the value.
+    CHECK(!get_string_entry(cache, 0, true));
+    auto info1{get_summary_info(cache)};
+    CHECK(info1.hit_count == 0);
+    CHECK(info1.cold_hit_count == 1);
+    CHECK(info1.miss_count == 1);
+    CHECK(info1.cold_num_records == 1);
+
+    // A value without a codec cannot go to the cold tier.
+    CHECK(get_string_entry(cache, 1, false));
+    auto info2{get_summary_info(cache)};
+    CHECK(info2.ac_num_records == 1);
+    CHECK(info2.cold_num_records == 1);
+    CHECK(get_string_entry(cache, 1, false));
+
+    clear_unused_entries(cache);
+    auto info3{get_summary_info(cache)};
+    CHECK(info3.ac_num_records == 0);
+    CHECK(info3.cold_num_records == 0);
+    CHECK(info3.cold_total_size == 0);
+}
+
+TEST_CASE("immutable cache cold tier concurrent promotion", tag)
+{
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 0, .cold_tier_size_limit = 0x10000}};
+    CHECK(get_string_entry(cache, 0, true));
+
+    // Threads hitting the same cold record concurrently each get the
+    // restored value; none has to recreate it.
+    constexpr int num_threads{8};
+    std::atomic<int> num_created{0};
+    std::atomic<int> num_wrong{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 20; ++j)
+            {
+                immutable_cache_ptr<std::string> ptr(
+                    cache,
+                    make_captured_id(0),
+                    [&](untyped_immutable_cache_ptr&) {
+                        ++num_created;
+                        return cppcoro::shared_task<void>{};
+                    });
+                if (num_created > 0)
+                {
+                    return;
+                }
+                cppcoro::sync_wait(ptr.ensure_value_task());
+                if (ptr.get_value() != make_cold_tier_value(0))
+                {
+                    ++num_wrong;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(num_created == 0);
+    CHECK(num_wrong == 0);
+    auto info{get_summary_info(cache)};
+    CHECK(info.ac_num_records == 1);
+    CHECK(info.cold_hit_count > 0);
+    CHECK(info.cold_hit_count + info.hit_count == num_threads * 20);
+}
+
+TEST_CASE("immutable cache cold tier size limit", tag)
+{
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 0, .cold_tier_size_limit = 0x10000}};
+    CHECK(get_string_entry(cache, 0, true));
+    auto const cold_size = get_summary_info(cache).cold_total_size;
+
+    // Room for two entries in the cold tier: the least recently used one is
+    // evicted.
+    cache.reset(immutable_cache_config{
+        .unused_size_limit = 0, .cold_tier_size_limit = 2 * cold_size + 1});
+    for (int i = 0; i < 3; ++i)
+    {
+        CHECK(get_string_entry(cache, i, true));
+    }
+    auto info{get_summary_info(cache)};
+    CHECK(info.cold_num_records == 2);
+    CHECK(info.cold_total_size <= 2 * cold_size + 1);
+    CHECK(get_string_entry(cache, 0, true));
+    CHECK(!get_string_entry(cache, 2, true));
+}
+
+TEST_CASE("immutable cache total size limit", tag)
+{
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 1024, .total_size_limit = 3 * sizeof(int)}};
+    auto make_ptr = [&](int i) {
+        auto ptr = std::make_unique<immutable_cache_ptr<int>>(
+            cache, make_captured_id(i), [i](untyped_immutable_cache_ptr& ptr) {
+                return test_task(ptr, i);
+            });
+        REQUIRE(await_cache_value(*ptr) == i);
+        return ptr;
+    };
+
+    // Unused entries count towards the limit.
+    make_ptr(0);
+    auto ptr1{make_ptr(1)};
+    auto ptr2{make_ptr(2)};
+    CHECK(!exceeds_total_size_limit(cache));
+    CHECK(get_summary_info(cache).cas_total_size == 3 * sizeof(int));
+
+    // Exceeding the limit evicts the unused entry, even though the unused
+    // size limit has not been reached.
+    auto ptr3{make_ptr(3)};
+    CHECK(!exceeds_total_size_limit(cache));
+    auto info0{get_summary_info(cache)};
+    CHECK(info0.ac_num_records == 3);
+    CHECK(info0.ac_num_records_in_use == 3);
+
+    // Entries in use cannot be evicted, so the limit is exceeded until one
+    // of them is released.
+    auto ptr4{make_ptr(4)};
+    CHECK(exceeds_total_size_limit(cache));
+    ptr1.reset();
+    CHECK(!exceeds_total_size_limit(cache));
+    auto info1{get_summary_info(cache)};
+    CHECK(info1.ac_num_records == 3);
+    CHECK(info1.cas_total_size == 3 * sizeof(int));
+}
+
+TEST_CASE("immutable cache - waiting for the total size limit", tag)
+{
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 1024, .total_size_limit = sizeof(int)}};
+    auto make_ptr = [&](int i) {
+        auto ptr = std::make_unique<immutable_cache_ptr<int>>(
+            cache, make_captured_id(i), [i](untyped_immutable_cache_ptr& ptr) {
+                return test_task(ptr, i);
+            });
+        REQUIRE(await_cache_value(*ptr) == i);
+        return ptr;
+    };
+    auto ptr0{make_ptr(0)};
+    auto ptr1{make_ptr(1)};
+    REQUIRE(exceeds_total_size_limit(cache));
+    auto never = [] { return false; };
+
+    // Without an eviction, the wait times out.
+    CHECK(!wait_for_total_size_limit(
+        cache, std::chrono::milliseconds(10), never));
+
+    // Releasing an entry wakes up the waiting thread well before the
+    // timeout.
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ptr1.reset();
+    });
+    auto start = std::chrono::steady_clock::now();
+    CHECK(wait_for_total_size_limit(cache, std::chrono::seconds(10), never));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    releaser.join();
+
+    // The wait also ends when it should stop.
+    auto ptr2{make_ptr(2)};
+    REQUIRE(exceeds_total_size_limit(cache));
+    CHECK(!wait_for_total_size_limit(
+        cache, std::chrono::seconds(10), [] { return true; }));
+}
+
+TEST_CASE("immutable cache - eviction waiters", tag)
+{
+    immutable_cache cache{immutable_cache_config{
+        .unused_size_limit = 1024, .total_size_limit = sizeof(int)}};
+    auto make_ptr = [&](int i) {
+        auto ptr = std::make_unique<immutable_cache_ptr<int>>(
+            cache, make_captured_id(i), [i](untyped_immutable_cache_ptr& ptr) {
+                return test_task(ptr, i);
+            });
+        REQUIRE(await_cache_value(*ptr) == i);
+        return ptr;
+    };
+    auto ptr0{make_ptr(0)};
+    auto ptr1{make_ptr(1)};
+    auto ptr2{make_ptr(2)};
+    REQUIRE(exceeds_total_size_limit(cache));
+
+    int num_called0{0};
+    int num_called1{0};
+    add_eviction_waiter(cache, [&] { ++num_called0; });
+    auto id1 = add_eviction_waiter(cache, [&] { ++num_called1; });
+    remove_eviction_waiter(cache, id1);
+
+    // An eviction calls the remaining waiter, once.
+    ptr2.reset();
+    CHECK(num_called0 == 1);
+    CHECK(num_called1 == 0);
+    ptr1.reset();
+    CHECK(num_called0 == 1);
+    CHECK(num_called1 == 0);
+}
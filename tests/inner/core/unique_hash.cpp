@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <filesystem>
 #include <vector>
@@ -6,6 +7,7 @@
 
 #include <cradle/inner/blob_file/blob_file.h>
 #include <cradle/inner/core/get_unique_string.h>
+#include <cradle/inner/core/id.h>
 #include <cradle/inner/core/type_definitions.h>
 #include <cradle/inner/core/type_interfaces.h>
 #include <cradle/inner/core/unique_hash.h>
@@ -140,6 +142,66 @@ TEST_CASE("unique_hash: combine", tag)
     verify_non_ref_result(hasher);
 }
 
+TEST_CASE("unique_hash: xxh3_128 empty input", tag)
+{
+    unique_hasher hasher{digest_algorithm::XXH3_128};
+    REQUIRE(hasher.algorithm() == digest_algorithm::XXH3_128);
+
+    // Reference: xxhsum -H2 /dev/null
+    REQUIRE(hasher.get_string() == "99aa06d3014798d86001c324468d497f");
+    auto result{hasher.get_result()};
+    for (std::size_t i = get_digest_size(digest_algorithm::XXH3_128);
+         i < unique_hasher::result_size;
+         ++i)
+    {
+        REQUIRE(result[i] == 0);
+    }
+}
+
+TEST_CASE("unique_hash: xxh3_128 encode", tag)
+{
+    char const data[] = {0x01, 0x02, 0x03, 0x04};
+    unique_hasher hasher{digest_algorithm::XXH3_128};
+    hasher.encode_bytes(data, 4);
+    unique_hasher ref_hasher{digest_algorithm::XXH3_128};
+    ref_hasher.encode_bytes(data, data + 2);
+    ref_hasher.encode_bytes(data + 2, data + 4);
+    unique_hasher sha256_hasher{digest_algorithm::SHA256};
+    sha256_hasher.encode_bytes(data, 4);
+
+    auto actual_string{hasher.get_string()};
+    REQUIRE(actual_string.size() == 32);
+    REQUIRE(actual_string == ref_hasher.get_string());
+    REQUIRE(actual_string != sha256_hasher.get_string().substr(0, 32));
+}
+
+TEST_CASE("unique_hash: default digest algorithm", tag)
+{
+    unique_hasher hasher;
+    REQUIRE(hasher.algorithm() == digest_algorithm::SHA256);
+
+    REQUIRE(
+        get_unique_string_tmpl(std::string{"abc"})
+        != get_unique_string_tmpl(
+            std::string{"abc"}, digest_algorithm::XXH3_128));
+    auto id{make_captured_id(std::string{"abc"})};
+    REQUIRE(
+        get_unique_string(*id, digest_algorithm::SHA256)
+        == get_unique_string(*id));
+    REQUIRE(
+        get_unique_string(*id, digest_algorithm::XXH3_128)
+        != get_unique_string(*id));
+}
+
+TEST_CASE("digest algorithm names", tag)
+{
+    for (auto algo : {digest_algorithm::SHA256, digest_algorithm::XXH3_128})
+    {
+        REQUIRE(parse_digest_algorithm(to_string(algo)) == algo);
+    }
+    REQUIRE(!parse_digest_algorithm("md5"));
+}
+
 TEST_CASE("update_unique_hash: char", tag)
 {
     unique_hasher hasher;
@@ -202,6 +264,101 @@ TEST_CASE("update_unique_hash: plain blob", tag)
     verify_ref_result(hasher, ref_hasher);
 }
 
+TEST_CASE("update_unique_hash: medium plain blob", tag)
+{
+    std::string data_string(blob_digest_threshold, 'x');
+
+    // Calculate a reference hash: a 0x03 tag, followed by the digest over the
+    // blob data.
+    unique_hasher data_hasher;
+    update_unique_hash(data_hasher, data_string);
+    unique_hasher ref_hasher;
+    update_unique_hash(ref_hasher, uint8_t{0x03});
+    ref_hasher.combine(data_hasher.get_result());
+
+    auto val{make_blob(data_string)};
+    unique_hasher hasher;
+    update_unique_hash(hasher, val);
+    verify_ref_result(hasher, ref_hasher);
+}
+
+TEST_CASE("update_unique_hash: large plain blob", tag)
+{
+    // Three full leaves plus a partial one
+    std::size_t const size{tree_hash_threshold + tree_hash_leaf_size / 2};
+    byte_vector data(size);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        data[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    // Calculate a reference hash: a 0x02 tag, followed by the tree hash,
+    // which is calculated over the size and the leaf digests (calculated
+    // sequentially).
+    unique_hasher tree_ref_hasher;
+    update_unique_hash(tree_ref_hasher, uint64_t{size});
+    for (std::size_t offset = 0; offset < size; offset += tree_hash_leaf_size)
+    {
+        unique_hasher leaf_hasher;
+        leaf_hasher.encode_bytes(
+            data.data() + offset,
+            std::min(tree_hash_leaf_size, size - offset));
+        tree_ref_hasher.combine(leaf_hasher.get_result());
+    }
+    auto tree_ref_result{tree_ref_hasher.get_result()};
+    unique_hasher ref_hasher;
+    update_unique_hash(ref_hasher, uint8_t{0x02});
+    ref_hasher.combine(tree_ref_result);
+
+    auto val{make_blob(std::move(data))};
+    unique_hasher hasher;
+    update_unique_hash(hasher, val);
+    verify_ref_result(hasher, ref_hasher);
+
+    // The tree hash doesn't depend on the concurrency.
+    for (unsigned max_concurrency : {1u, 2u, 16u})
+    {
+        unique_hasher tree_hasher;
+        update_unique_hash_tree(
+            tree_hasher, val.data(), val.size(), max_concurrency);
+        REQUIRE(tree_hasher.get_result() == tree_ref_result);
+    }
+}
+
+TEST_CASE("update_unique_hash: memoized blob digest", tag)
+{
+    std::string data_string(blob_digest_threshold * 2, 'x');
+    data_string[blob_digest_threshold] = 'y';
+    auto val{make_blob(data_string)};
+    auto reference{get_unique_string_tmpl(make_blob(data_string))};
+
+    // The first hash memoizes the digest; the second one uses it.
+    auto avoided0{get_avoided_hash_bytes()};
+    REQUIRE(get_unique_string_tmpl(val) == reference);
+    REQUIRE(val.owner()->get_memoized_digest() != nullptr);
+    REQUIRE(get_avoided_hash_bytes() == avoided0);
+    REQUIRE(get_unique_string_tmpl(val) == reference);
+    REQUIRE(get_avoided_hash_bytes() == avoided0 + val.size());
+
+    // A blob referring to part of the same data doesn't use the digest.
+    blob part{
+        val.shared_owner(),
+        val.data() + blob_digest_threshold,
+        blob_digest_threshold};
+    REQUIRE(
+        get_unique_string_tmpl(part)
+        == get_unique_string_tmpl(make_blob(
+            data_string.substr(blob_digest_threshold))));
+    REQUIRE(get_avoided_hash_bytes() == avoided0 + val.size());
+
+    // Neither does a hash calculated with another algorithm.
+    REQUIRE(
+        get_unique_string_tmpl(val, digest_algorithm::XXH3_128)
+        == get_unique_string_tmpl(
+            make_blob(data_string), digest_algorithm::XXH3_128));
+    REQUIRE(get_avoided_hash_bytes() == avoided0 + val.size());
+}
+
 TEST_CASE("update_unique_hash: blob file", tag)
 {
     namespace fs = std::filesystem;
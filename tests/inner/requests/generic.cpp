@@ -380,6 +380,7 @@ TEST_CASE("to_composition_based", tag)
 TEST_CASE("convert async_status to string", tag)
 {
     REQUIRE(to_string(async_status::CREATED) == "CREATED");
+    REQUIRE(to_string(async_status::THROTTLED) == "THROTTLED");
     REQUIRE(to_string(async_status::SUBS_RUNNING) == "SUBS_RUNNING");
     REQUIRE(to_string(async_status::SELF_RUNNING) == "SELF_RUNNING");
     REQUIRE(to_string(async_status::CANCELLED) == "CANCELLED");
@@ -0,0 +1,154 @@
+#include <catch2/catch.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <fmt/format.h>
+
+#include "../../support/inner_service.h"
+#include <cradle/inner/requests/containment_data.h>
+#include <cradle/inner/requests/function.h>
+#include <cradle/inner/requests/interning.h>
+#include <cradle/inner/resolve/resolve_request.h>
+
+using namespace cradle;
+
+namespace {
+
+static char const tag[] = "[inner][requests][interning]";
+
+static auto add2 = [](int a, int b) { return a + b; };
+
+request_uuid
+make_test_uuid(std::string const& ext)
+{
+    return request_uuid{fmt::format("{}-{}", tag, ext)};
+}
+
+using props_type = request_props<caching_level_type::memory>;
+
+auto
+make_leaf(int x)
+{
+    return rq_function(props_type{make_test_uuid("leaf")}, add2, x, 1);
+}
+
+auto
+make_tree(int x)
+{
+    return rq_function(
+        props_type{make_test_uuid("node")}, add2, make_leaf(x), make_leaf(x));
+}
+
+// Returns true if a and b share their implementation object.
+template<typename A, typename B>
+bool
+same_impl(A const& a, B const& b)
+{
+    return &*a.get_captured_id() == &*b.get_captured_id();
+}
+
+} // namespace
+
+TEST_CASE("function_request: no interning without scope", tag)
+{
+    auto req0{make_leaf(1)};
+    auto req1{make_leaf(1)};
+
+    REQUIRE(req0 == req1);
+    REQUIRE(!same_impl(req0, req1));
+    REQUIRE(get_current_request_interning_table() == nullptr);
+}
+
+TEST_CASE("function_request: interning identical subtrees", tag)
+{
+    request_interning_table table;
+    {
+        request_interning_scope scope{table};
+        REQUIRE(get_current_request_interning_table() == &table);
+
+        auto tree0{make_tree(1)};
+        auto tree1{make_tree(1)};
+        auto tree2{make_tree(2)};
+
+        REQUIRE(same_impl(tree0, tree1));
+        REQUIRE(!same_impl(tree0, tree2));
+        REQUIRE(tree0 != tree2);
+    }
+    REQUIRE(get_current_request_interning_table() == nullptr);
+
+    // Unique nodes: leaf(1), node(1), leaf(2), node(2)
+    REQUIRE(table.size() == 4);
+    // tree0: leaf(1) hit
+    // tree1: leaf(1) hit twice, node(1) hit
+    // tree2: leaf(2) hit
+    REQUIRE(table.num_hits() == 5);
+}
+
+TEST_CASE("function_request: nested interning scopes", tag)
+{
+    request_interning_table outer_table;
+    request_interning_table inner_table;
+    request_interning_scope outer_scope{outer_table};
+    {
+        request_interning_scope inner_scope{inner_table};
+        REQUIRE(get_current_request_interning_table() == &inner_table);
+        make_leaf(1);
+    }
+    REQUIRE(get_current_request_interning_table() == &outer_table);
+    REQUIRE(inner_table.size() == 1);
+    REQUIRE(outer_table.size() == 0);
+}
+
+TEST_CASE("function_request: resolve interned request", tag)
+{
+    auto resources{make_inner_test_resources()};
+    request_interning_table table;
+    request_interning_scope scope{table};
+    auto req{make_tree(3)};
+
+    caching_request_resolution_context ctx{*resources};
+    auto res = cppcoro::sync_wait(resolve_request(ctx, req));
+
+    REQUIRE(res == 8);
+}
+
+TEST_CASE("function_request: introspective requests are not interned", tag)
+{
+    using intrsp_props_type = request_props<
+        caching_level_type::memory,
+        request_function_t::plain,
+        true>;
+    request_interning_table table;
+    request_interning_scope scope{table};
+    auto req0{rq_function(
+        intrsp_props_type{make_test_uuid("intrsp"), "title0"}, add2, 1, 2)};
+    auto req1{rq_function(
+        intrsp_props_type{make_test_uuid("intrsp"), "title1"}, add2, 1, 2)};
+
+    REQUIRE(req0 == req1);
+    REQUIRE(!same_impl(req0, req1));
+    REQUIRE(req0.get_introspection_title() == "title0");
+    REQUIRE(req1.get_introspection_title() == "title1");
+    REQUIRE(table.size() == 0);
+}
+
+TEST_CASE("function_request: containment on an interned request", tag)
+{
+    using uncached_props_type = request_props<caching_level_type::none>;
+    request_interning_table table;
+    request_interning_scope scope{table};
+    auto make_req = [] {
+        return rq_function(
+            uncached_props_type{make_test_uuid("uncached")}, add2, 1, 2);
+    };
+    auto req0{make_req()};
+    auto req1{make_req()};
+    REQUIRE(same_impl(req0, req1));
+
+    // Only req0 gets contained; it no longer shares its implementation.
+    req0.set_containment(
+        containment_data{make_test_uuid("plain"), "dll_dir", "dll_name"});
+    REQUIRE(!same_impl(req0, req1));
+    REQUIRE(req0 == req1);
+    REQUIRE(!req0.is_direct_resolvable());
+    REQUIRE(req1.is_direct_resolvable());
+    REQUIRE(make_req().is_direct_resolvable());
+}
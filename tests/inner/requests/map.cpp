@@ -0,0 +1,147 @@
+#include <atomic>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <fmt/format.h>
+
+#include "../../support/inner_service.h"
+#include <cradle/inner/introspection/tasklet_impl.h>
+#include <cradle/inner/introspection/tasklet_info.h>
+#include <cradle/inner/requests/function.h>
+#include <cradle/inner/requests/map.h>
+#include <cradle/inner/resolve/resolve_request.h>
+#include <cradle/plugins/domain/testing/context.h>
+
+using namespace cradle;
+
+namespace {
+
+static char const tag[] = "[inner][requests][map]";
+
+request_uuid
+make_test_uuid(int ext)
+{
+    return request_uuid{fmt::format("{}-{:04d}", tag, ext)};
+}
+
+std::vector<int>
+make_elems(int size, int first = 0)
+{
+    std::vector<int> elems;
+    for (int i = 0; i < size; ++i)
+    {
+        elems.push_back(first + i);
+    }
+    return elems;
+}
+
+auto
+create_squarer(std::atomic<int>& num_calls)
+{
+    return [&num_calls](int x) {
+        num_calls += 1;
+        return x * x;
+    };
+}
+
+void
+check_squares(std::vector<int> const& res, int size, int first = 0)
+{
+    REQUIRE(res.size() == static_cast<std::size_t>(size));
+    for (int i = 0; i < size; ++i)
+    {
+        CHECK(res[i] == (first + i) * (first + i));
+    }
+}
+
+} // namespace
+
+TEST_CASE("map request - uncached", tag)
+{
+    auto resources{make_inner_test_resources()};
+    non_caching_request_resolution_context ctx{*resources};
+    request_props<caching_level_type::none, request_function_t::coro> props{
+        make_test_uuid(0)};
+    std::atomic<int> num_calls{};
+    auto req{rq_map(props, create_squarer(num_calls), make_elems(1000))};
+
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req)), 1000);
+    CHECK(num_calls == 1000);
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req)), 1000);
+    CHECK(num_calls == 2000);
+}
+
+TEST_CASE("map request - cached per element and as a whole", tag)
+{
+    auto resources{make_inner_test_resources()};
+    caching_request_resolution_context ctx{*resources};
+    request_props<caching_level_type::memory, request_function_t::coro> props{
+        make_test_uuid(1)};
+    std::atomic<int> num_calls{};
+    auto square{create_squarer(num_calls)};
+
+    auto req0{rq_map(props, square, make_elems(1000))};
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req0)), 1000);
+    CHECK(num_calls == 1000);
+
+    // The whole result comes from the memory cache.
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req0)), 1000);
+    CHECK(num_calls == 1000);
+
+    // A different vector: only the new elements are calculated.
+    auto req1{rq_map(props, square, make_elems(1000, 10))};
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req1)), 1000, 10);
+    CHECK(num_calls == 1010);
+}
+
+TEST_CASE("map request - elements from a subrequest", tag)
+{
+    auto resources{make_inner_test_resources()};
+    caching_request_resolution_context ctx{*resources};
+    request_props<caching_level_type::memory, request_function_t::coro> props{
+        make_test_uuid(2)};
+    request_props<caching_level_type::memory> elems_props{make_test_uuid(3)};
+    std::atomic<int> num_calls{};
+    auto req{rq_map(
+        props,
+        create_squarer(num_calls),
+        rq_function(elems_props, make_elems, 300, 0))};
+
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req)), 300);
+    CHECK(num_calls == 300);
+}
+
+TEST_CASE("map request - async", tag)
+{
+    auto resources{make_inner_test_resources()};
+    atst_context ctx{*resources};
+    request_props<caching_level_type::memory, request_function_t::coro> props{
+        make_test_uuid(4)};
+    std::atomic<int> num_calls{};
+    auto req{rq_map(props, create_squarer(num_calls), make_elems(1000))};
+
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req)), 1000);
+    CHECK(num_calls == 1000);
+    CHECK(ctx.get_progress() == 1.0f);
+}
+
+TEST_CASE("map request - a tasklet per batch", tag)
+{
+    auto resources{make_inner_test_resources()};
+    auto& admin{resources->the_tasklet_admin()};
+    admin.set_capturing_enabled(true);
+    testing_request_context ctx{*resources, ""};
+    request_props<caching_level_type::none, request_function_t::coro> props{
+        make_test_uuid(5)};
+    std::atomic<int> num_calls{};
+    auto req{rq_map(props, create_squarer(num_calls), make_elems(600))};
+
+    check_squares(cppcoro::sync_wait(resolve_request(ctx, req)), 600);
+    auto infos{get_tasklet_infos(admin, true)};
+    REQUIRE(infos.size() == 3);
+    CHECK(infos[0].pool_name() == "map");
+    CHECK(infos[0].title() == "map batch [0, 256)");
+    CHECK(infos[1].title() == "map batch [256, 512)");
+    CHECK(infos[2].title() == "map batch [512, 600)");
+}
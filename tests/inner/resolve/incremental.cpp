@@ -0,0 +1,188 @@
+#include <atomic>
+
+#include <catch2/catch.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <fmt/format.h>
+
+#include "../../inner-dll/v1/adder_v1.h"
+#include "../../support/inner_service.h"
+#include <cradle/inner/core/exception.h>
+#include <cradle/inner/requests/function.h>
+#include <cradle/inner/resolve/incremental.h>
+#include <cradle/plugins/domain/testing/context.h>
+#include <cradle/plugins/domain/testing/requests.h>
+#include <cradle/test_dlls_dir.h>
+
+using namespace cradle;
+
+namespace {
+
+static char const tag[] = "[inner][resolve][incremental]";
+
+request_uuid
+make_test_uuid(int ext)
+{
+    return request_uuid{fmt::format("{}-{:04d}", tag, ext)};
+}
+
+// (a * b) + (c * d)
+auto
+make_tree(
+    std::atomic<int>& num_add_calls,
+    std::atomic<int>& num_mul_calls,
+    int a,
+    int b,
+    int c,
+    int d)
+{
+    request_props<caching_level_type::memory> props_add{make_test_uuid(0)};
+    request_props<caching_level_type::memory> props_mul{make_test_uuid(1)};
+    auto add = [&num_add_calls](int x, int y) {
+        num_add_calls += 1;
+        return x + y;
+    };
+    auto mul = [&num_mul_calls](int x, int y) {
+        num_mul_calls += 1;
+        return x * y;
+    };
+    return rq_function(
+        props_add,
+        add,
+        rq_function(props_mul, mul, a, b),
+        rq_function(props_mul, mul, c, d));
+}
+
+void
+check_stats(
+    incremental_graph const& graph,
+    std::size_t num_unchanged,
+    std::size_t num_cut_off,
+    std::size_t num_recomputed)
+{
+    auto const& stats{graph.get_stats()};
+    CHECK(stats.num_unchanged == num_unchanged);
+    CHECK(stats.num_cut_off == num_cut_off);
+    CHECK(stats.num_recomputed == num_recomputed);
+}
+
+} // namespace
+
+TEST_CASE("incremental resolution", tag)
+{
+    auto resources{make_inner_test_resources()};
+    caching_request_resolution_context ctx{*resources};
+    incremental_graph graph;
+    std::atomic<int> num_add_calls{};
+    std::atomic<int> num_mul_calls{};
+
+    auto req0{make_tree(num_add_calls, num_mul_calls, 2, 3, 4, 5)};
+    CHECK(cppcoro::sync_wait(resolve_request_incrementally(ctx, req0, graph))
+          == 26);
+    check_stats(graph, 0, 0, 3);
+    CHECK(graph.size() == 3);
+    CHECK(num_add_calls == 1);
+    CHECK(num_mul_calls == 2);
+
+    SECTION("unchanged tree")
+    {
+        auto req1{make_tree(num_add_calls, num_mul_calls, 2, 3, 4, 5)};
+        CHECK(
+            cppcoro::sync_wait(resolve_request_incrementally(ctx, req1, graph))
+            == 26);
+        check_stats(graph, 1, 0, 0);
+        CHECK(num_add_calls == 1);
+        CHECK(num_mul_calls == 2);
+    }
+    SECTION("changed leaf")
+    {
+        auto req1{make_tree(num_add_calls, num_mul_calls, 2, 3, 4, 6)};
+        CHECK(
+            cppcoro::sync_wait(resolve_request_incrementally(ctx, req1, graph))
+            == 30);
+        // 2 * 3 is reused; 4 * 6 and the sum are recalculated.
+        check_stats(graph, 1, 0, 2);
+        CHECK(num_add_calls == 2);
+        CHECK(num_mul_calls == 3);
+        CHECK(graph.size() == 3);
+    }
+    SECTION("early cutoff")
+    {
+        auto req1{make_tree(num_add_calls, num_mul_calls, 2, 3, 5, 4)};
+        CHECK(
+            cppcoro::sync_wait(resolve_request_incrementally(ctx, req1, graph))
+            == 26);
+        // 5 * 4 is recalculated, but yields the same value as 4 * 5, so the
+        // sum is not.
+        check_stats(graph, 1, 1, 1);
+        CHECK(num_add_calls == 1);
+        CHECK(num_mul_calls == 3);
+    }
+    SECTION("cleared graph")
+    {
+        graph.clear();
+        CHECK(graph.size() == 0);
+        auto req1{make_tree(num_add_calls, num_mul_calls, 2, 3, 4, 5)};
+        CHECK(
+            cppcoro::sync_wait(resolve_request_incrementally(ctx, req1, graph))
+            == 26);
+        check_stats(graph, 0, 0, 3);
+    }
+    // Function requests bypass the memory cache.
+    CHECK(get_summary_info(resources->memory_cache()).ac_num_records == 0);
+}
+
+TEST_CASE("incremental resolution - coroutine function", tag)
+{
+    auto resources{make_inner_test_resources()};
+    non_caching_request_resolution_context ctx{*resources};
+    incremental_graph graph;
+    request_props<caching_level_type::none, request_function_t::coro>
+        props{make_test_uuid(2)};
+    std::atomic<int> num_calls{};
+    auto add = [&num_calls](auto& ctx, int x, int y) -> cppcoro::task<int> {
+        num_calls += 1;
+        co_return x + y;
+    };
+
+    auto req0{rq_function(props, add, rq_function(props, add, 1, 2), 3)};
+    CHECK(cppcoro::sync_wait(resolve_request_incrementally(ctx, req0, graph))
+          == 6);
+    auto req1{rq_function(props, add, rq_function(props, add, 1, 2), 4)};
+    CHECK(cppcoro::sync_wait(resolve_request_incrementally(ctx, req1, graph))
+          == 7);
+    check_stats(graph, 1, 0, 1);
+    CHECK(num_calls == 3);
+}
+
+TEST_CASE("incremental resolution - async context", tag)
+{
+    auto resources{make_inner_test_resources()};
+    atst_context ctx{*resources};
+    incremental_graph graph;
+    std::atomic<int> num_add_calls{};
+    std::atomic<int> num_mul_calls{};
+    auto req{make_tree(num_add_calls, num_mul_calls, 2, 3, 4, 5)};
+    REQUIRE_THROWS_AS(
+        cppcoro::sync_wait(resolve_request_incrementally(ctx, req, graph)),
+        not_implemented_error);
+}
+
+TEST_CASE("incremental resolution - proxy request", tag)
+{
+    std::string proxy_name{"rpclib"};
+    auto resources{
+        make_inner_test_resources(proxy_name, testing_domain_option())};
+    auto& proxy{resources->get_proxy(proxy_name)};
+    proxy.load_shared_library(get_test_dlls_dir(), "test_inner_dll_v1");
+    testing_request_context ctx{*resources, proxy_name};
+    incremental_graph graph;
+
+    auto req{rq_test_adder_v1p(7, 2)};
+    CHECK(
+        cppcoro::sync_wait(resolve_request_incrementally(
+            ctx, req, graph, ResolutionConstraintsRemoteSync{}))
+        == 9);
+    // A proxy request is not a node in the graph.
+    CHECK(graph.size() == 0);
+    check_stats(graph, 0, 0, 0);
+}
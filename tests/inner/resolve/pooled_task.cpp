@@ -0,0 +1,119 @@
+#include <stdexcept>
+#include <string>
+
+#include <catch2/catch.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <cppcoro/task.hpp>
+#include <fmt/format.h>
+
+#include "../../support/inner_service.h"
+#include <cradle/inner/requests/function.h>
+#include <cradle/inner/resolve/frame_pool.h>
+#include <cradle/inner/resolve/pooled_task.h>
+#include <cradle/inner/resolve/resolve_request.h>
+
+using namespace cradle;
+
+namespace {
+
+static char const tag[] = "[inner][resolve][pooled_task]";
+
+pooled_task<int>
+add_pooled(int a, int b)
+{
+    co_return a + b;
+}
+
+pooled_task<std::string>
+concat_pooled(std::string a, std::string b)
+{
+    auto ab = co_await add_pooled(1, 2);
+    co_return a + b + std::to_string(ab);
+}
+
+pooled_task<void>
+throw_pooled()
+{
+    co_await add_pooled(1, 2);
+    throw std::runtime_error("pooled_task failure");
+}
+
+} // namespace
+
+TEST_CASE("pooled_task returns a value", tag)
+{
+    REQUIRE(cppcoro::sync_wait(add_pooled(2, 3)) == 5);
+    REQUIRE(cppcoro::sync_wait(concat_pooled("a", "b")) == "ab3");
+}
+
+TEST_CASE("pooled_task propagates an exception", tag)
+{
+    REQUIRE_THROWS_WITH(
+        cppcoro::sync_wait(throw_pooled()), "pooled_task failure");
+}
+
+TEST_CASE("pooled_task can be awaited from a cppcoro::task", tag)
+{
+    auto outer = []() -> cppcoro::task<int> {
+        co_return co_await add_pooled(4, 5) + 1;
+    };
+    REQUIRE(cppcoro::sync_wait(outer()) == 10);
+}
+
+TEST_CASE("coroutine frame pool reuses frames", tag)
+{
+    // Warm up the pool so that it holds a free frame of the needed size.
+    cppcoro::sync_wait(add_pooled(0, 0));
+    reset_coroutine_frame_pool_stats();
+
+    constexpr int num_loops = 10;
+    for (int i = 0; i < num_loops; ++i)
+    {
+        REQUIRE(cppcoro::sync_wait(add_pooled(i, 1)) == i + 1);
+    }
+
+    auto stats{get_coroutine_frame_pool_stats()};
+    REQUIRE(stats.num_allocations == num_loops);
+    REQUIRE(stats.num_deallocations == num_loops);
+    REQUIRE(stats.num_reused == num_loops);
+    REQUIRE(stats.num_heap_allocations == 0);
+}
+
+TEST_CASE("coroutine frame pool can be disabled", tag)
+{
+    cppcoro::sync_wait(add_pooled(0, 0));
+    set_coroutine_frame_pool_enabled(false);
+    reset_coroutine_frame_pool_stats();
+
+    constexpr int num_loops = 10;
+    for (int i = 0; i < num_loops; ++i)
+    {
+        REQUIRE(cppcoro::sync_wait(add_pooled(i, 1)) == i + 1);
+    }
+    set_coroutine_frame_pool_enabled(true);
+
+    auto stats{get_coroutine_frame_pool_stats()};
+    REQUIRE(stats.num_allocations == num_loops);
+    REQUIRE(stats.num_reused == 0);
+    REQUIRE(stats.num_heap_allocations == num_loops);
+}
+
+TEST_CASE("memory cache hit uses pooled frames", tag)
+{
+    auto resources{make_inner_test_resources()};
+    caching_request_resolution_context ctx{*resources};
+    request_props<caching_level_type::memory> props{
+        request_uuid{fmt::format("{}-0000", tag)}};
+    auto req{rq_function(props, [](int a, int b) { return a + b; }, 6, 1)};
+
+    // The first resolution fills the cache and the pool.
+    REQUIRE(cppcoro::sync_wait(resolve_request(ctx, req)) == 7);
+    reset_coroutine_frame_pool_stats();
+
+    REQUIRE(cppcoro::sync_wait(resolve_request(ctx, req)) == 7);
+
+    auto stats{get_coroutine_frame_pool_stats()};
+    REQUIRE(stats.num_allocations > 0);
+    REQUIRE(stats.num_allocations == stats.num_deallocations);
+    REQUIRE(stats.num_heap_allocations == 0);
+}
@@ -353,6 +353,42 @@ TEST_CASE("cancel async request locally", tag)
     test_cancel_async(*resources, proxy_name, req);
 }
 
+TEST_CASE("cancel async request locally on deadline", tag)
+{
+    constexpr auto level{caching_level_type::none};
+    // Would take at least 1.4s without the deadline
+    auto req{rq_cancellable_coro<level>(
+        rq_cancellable_coro<level>(100, 14),
+        rq_cancellable_coro<level>(100, 15))};
+    auto resources{make_inner_test_resources()};
+    atst_context ctx{*resources};
+    ctx.set_scheduling(async_scheduling{
+        async_priority::INTERACTIVE,
+        async_clock::now() + std::chrono::milliseconds{50}});
+
+    REQUIRE_THROWS_AS(
+        cppcoro::sync_wait(resolve_request(ctx, req)), async_cancelled);
+    REQUIRE(
+        cppcoro::sync_wait(ctx.get_status_coro()) == async_status::CANCELLED);
+}
+
+TEST_CASE("resolve async request locally with priority and deadline", tag)
+{
+    constexpr auto level{caching_level_type::none};
+    auto req{rq_cancellable_coro<level>(
+        rq_cancellable_coro<level>(2, 3), rq_cancellable_coro<level>(2, 4))};
+    auto resources{make_inner_test_resources()};
+    atst_context ctx{*resources};
+    ctx.set_scheduling(async_scheduling{
+        async_priority::BATCH,
+        async_clock::now() + std::chrono::seconds{60}});
+
+    auto res = cppcoro::sync_wait(resolve_request(ctx, req));
+
+    // cancellable_coro(loops, delay) returns loops + delay
+    REQUIRE(res == (2 + 3) + (2 + 4));
+}
+
 namespace {
 
 void
@@ -1,3 +1,7 @@
+#include <chrono>
+#include <thread>
+
+#include <cradle/inner/requests/containment_data.h>
 #include <cradle/inner/requests/function.h>
 #include <cradle/inner/requests/value.h>
 
@@ -179,6 +183,8 @@ TEST_CASE("evaluate function request (V+V)*V - uncached", tag)
     auto mul = create_multiplier(num_mul_calls);
     auto req{
         rq_function(props_mul, mul, rq_function(props_add, add, 1, 2), 3)};
+    // Resolved directly (without coroutines)
+    REQUIRE(req.is_direct_resolvable());
     test_resolve_uncached(req, *resources, 9, num_add_calls, &num_mul_calls);
 }
 
@@ -196,6 +202,48 @@ TEST_CASE("evaluate function request (V+V)*V - memory cached", tag)
     test_resolve_cached(req, *resources, 9, num_add_calls, &num_mul_calls);
 }
 
+// The uncached main request has a memory cached subrequest, so the tree is
+// not resolved directly (without coroutines), and the subrequest goes
+// through the cache.
+TEST_CASE("evaluate function request (V+V)*V - uncached, cached sub", tag)
+{
+    auto resources{make_inner_test_resources()};
+    request_props<caching_level_type::memory> props_inner{make_test_uuid(50)};
+    request_props<caching_level_type::none> props_main{make_test_uuid(51)};
+    std::atomic<int> num_add_calls = 0;
+    auto add = create_adder(num_add_calls);
+    std::atomic<int> num_mul_calls = 0;
+    auto mul = create_multiplier(num_mul_calls);
+    auto inner{rq_function(props_inner, add, 1, 2)};
+    auto req{rq_function(props_main, mul, inner, 3)};
+    REQUIRE(!req.is_direct_resolvable());
+    caching_request_resolution_context ctx{*resources};
+
+    REQUIRE(cppcoro::sync_wait(resolve_request(ctx, req)) == 9);
+    REQUIRE(cppcoro::sync_wait(resolve_request(ctx, req)) == 9);
+
+    REQUIRE(num_add_calls == 1);
+    REQUIRE(num_mul_calls == 2);
+}
+
+// A contained subrequest keeps the whole tree from being resolved directly;
+// its containment is captured when the main request is created.
+TEST_CASE("function request with contained subrequest - uncached", tag)
+{
+    using Props = request_props<caching_level_type::none>;
+    std::atomic<int> num_add_calls = 0;
+    auto add = create_adder(num_add_calls);
+    auto inner{rq_function(Props{make_test_uuid(52)}, add, 1, 2)};
+    auto plain_req{rq_function(Props{make_test_uuid(53)}, add, inner, 3)};
+    inner.set_containment(
+        containment_data{make_test_uuid(54), "dll_dir", "dll_name"});
+    auto contained_req{
+        rq_function(Props{make_test_uuid(53)}, add, inner, 3)};
+
+    REQUIRE(plain_req.is_direct_resolvable());
+    REQUIRE(!contained_req.is_direct_resolvable());
+}
+
 TEST_CASE("evaluate function request V+V - fully cached", tag)
 {
     auto resources{make_inner_test_resources()};
@@ -230,6 +278,38 @@ TEST_CASE("evaluate function request V+V - fully cached", tag)
     REQUIRE(num_add_calls == 1);
 }
 
+TEST_CASE("fully cached result written to secondary cache in background", tag)
+{
+    inner_resources resources{make_inner_tests_config()};
+    auto owned_storage{std::make_unique<simple_blob_storage>()};
+    auto& storage{*owned_storage};
+    resources.set_secondary_cache(std::move(owned_storage));
+    auto& mem_cache{resources.memory_cache()};
+    request_props<caching_level_type::full> props{make_test_uuid(202)};
+    std::atomic<int> num_add_calls{};
+    auto add{create_adder(num_add_calls)};
+    auto req{rq_function(props, add, 6, 2)};
+    caching_request_resolution_context ctx{resources};
+
+    auto res0 = cppcoro::sync_wait(resolve_request(ctx, req));
+    REQUIRE(res0 == 8);
+    REQUIRE(num_add_calls == 1);
+
+    // Once the background write has finished, the value is in the secondary
+    // cache, and the memory cache record is no longer in use.
+    resources.wait_for_secondary_cache_writes();
+    CHECK(storage.size() == 1);
+    auto info{get_summary_info(mem_cache)};
+    CHECK(info.ac_num_records_in_use == 0);
+    CHECK(info.ac_num_records_pending_eviction == 1);
+
+    // The value now comes from the secondary cache.
+    resources.reset_memory_cache();
+    auto res1 = cppcoro::sync_wait(resolve_request(ctx, req));
+    REQUIRE(res1 == 8);
+    REQUIRE(num_add_calls == 1);
+}
+
 TEST_CASE("evaluate function requests in parallel - uncached function", tag)
 {
     auto resources{make_inner_test_resources()};
@@ -441,6 +521,265 @@ TEST_CASE("evaluate function request - memory cache behavior", tag)
     CHECK(info3.cas_num_records == 1);
 }
 
+TEST_CASE("resolve function request to shared value", tag)
+{
+    auto resources{make_inner_test_resources()};
+    auto& mem_cache{resources->memory_cache()};
+    request_props<caching_level_type::memory> props{make_test_uuid(610)};
+    std::atomic<int> num_add_calls{};
+    auto add{create_adder(num_add_calls)};
+    auto req{rq_function(props, add, 6, 3)};
+    caching_request_resolution_context ctx{*resources};
+
+    auto res0 = cppcoro::sync_wait(resolve_request_shared(ctx, req));
+    REQUIRE(res0);
+    CHECK(*res0 == 9);
+    CHECK(num_add_calls == 1);
+    // The shared pointer keeps the cache record in use.
+    auto info0{get_summary_info(mem_cache)};
+    CHECK(info0.ac_num_records_in_use == 1);
+    CHECK(info0.cas_num_records == 1);
+
+    // A second resolution refers to the same value in the cache.
+    auto res1 = cppcoro::sync_wait(resolve_request_shared(ctx, req));
+    CHECK(res1.get() == res0.get());
+    CHECK(num_add_calls == 1);
+
+    res0.reset();
+    res1.reset();
+    auto info1{get_summary_info(mem_cache)};
+    CHECK(info1.ac_num_records_in_use == 0);
+    CHECK(info1.ac_num_records_pending_eviction == 1);
+}
+
+TEST_CASE("resolve function request to shared value - async", tag)
+{
+    auto resources{make_inner_test_resources()};
+    auto& mem_cache{resources->memory_cache()};
+    request_props<caching_level_type::memory> props{make_test_uuid(612)};
+    std::atomic<int> num_add_calls{};
+    auto add{create_adder(num_add_calls)};
+    auto inner{rq_function(props, add, 2, 4)};
+    auto req{rq_function(props, add, inner, 3)};
+    atst_context ctx{*resources};
+
+    auto res0 = cppcoro::sync_wait(resolve_request_shared(ctx, req));
+    REQUIRE(res0);
+    CHECK(*res0 == 9);
+    CHECK(num_add_calls == 2);
+    auto info0{get_summary_info(mem_cache)};
+    CHECK(info0.ac_num_records_in_use == 1);
+
+    // The value comes from the cache, without a copy.
+    auto res1 = cppcoro::sync_wait(resolve_request_shared(ctx, req));
+    CHECK(res1.get() == res0.get());
+    CHECK(num_add_calls == 2);
+}
+
+TEST_CASE("shared value survives a memory cache reset", tag)
+{
+    auto resources{make_inner_test_resources()};
+    request_props<caching_level_type::memory> props{make_test_uuid(613)};
+    std::atomic<int> num_add_calls{};
+    auto add{create_adder(num_add_calls)};
+    auto req{rq_function(props, add, 6, 3)};
+    caching_request_resolution_context ctx{*resources};
+
+    auto res0 = cppcoro::sync_wait(resolve_request_shared(ctx, req));
+    REQUIRE(res0);
+    resources->reset_memory_cache();
+    CHECK(get_summary_info(resources->memory_cache()).ac_num_records == 0);
+    // The value lives on outside the new cache.
+    CHECK(*res0 == 9);
+
+    auto res1 = cppcoro::sync_wait(resolve_request_shared(ctx, req));
+    CHECK(*res1 == 9);
+    CHECK(res1.get() != res0.get());
+    CHECK(num_add_calls == 2);
+    res0.reset();
+    CHECK(get_summary_info(resources->memory_cache()).ac_num_records == 1);
+}
+
+TEST_CASE("resolve uncached function request to shared value", tag)
+{
+    auto resources{make_inner_test_resources()};
+    request_props<caching_level_type::none> props{make_test_uuid(611)};
+    std::atomic<int> num_add_calls{};
+    auto add{create_adder(num_add_calls)};
+    auto req{rq_function(props, add, 6, 3)};
+    caching_request_resolution_context ctx{*resources};
+
+    auto res = cppcoro::sync_wait(resolve_request_shared(ctx, req));
+    REQUIRE(res);
+    CHECK(*res == 9);
+    CHECK(get_summary_info(resources->memory_cache()).ac_num_records == 0);
+}
+
+TEST_CASE("resolve batch of function requests", tag)
+{
+    auto resources{make_inner_test_resources()};
+    auto& mem_cache{resources->memory_cache()};
+    request_props<caching_level_type::memory> props{make_test_uuid(620)};
+    std::atomic<int> num_add_calls{};
+    auto add{create_adder(num_add_calls)};
+    std::vector reqs{
+        rq_function(props, add, 1, 2),
+        rq_function(props, add, 3, 4),
+        rq_function(props, add, 1, 2),
+        rq_function(props, add, 5, 6),
+        rq_function(props, add, 3, 4)};
+    caching_request_resolution_context ctx{*resources};
+
+    auto res = cppcoro::sync_wait(resolve_requests(ctx, reqs));
+    REQUIRE(res.size() == 5);
+    CHECK(res[0].value() == 3);
+    CHECK(res[1].value() == 7);
+    CHECK(res[2].value() == 3);
+    CHECK(res[3].value() == 11);
+    CHECK(res[4].value() == 7);
+    // Duplicates are resolved once only, so each unique request is looked up
+    // once in the memory cache.
+    CHECK(num_add_calls == 3);
+    auto info{get_summary_info(mem_cache)};
+    CHECK(info.hit_count == 0);
+    CHECK(info.miss_count == 3);
+}
+
+TEST_CASE("resolve batch of function requests - per-item errors", tag)
+{
+    auto resources{make_inner_test_resources()};
+    request_props<caching_level_type::none> props{make_test_uuid(621)};
+    auto checked_add = [](int a, int b) {
+        if (a < 0)
+        {
+            throw std::invalid_argument("negative");
+        }
+        return a + b;
+    };
+    std::vector reqs{
+        rq_function(props, checked_add, 1, 2),
+        rq_function(props, checked_add, -1, 2),
+        rq_function(props, checked_add, 3, 4)};
+    caching_request_resolution_context ctx{*resources};
+
+    auto res = cppcoro::sync_wait(resolve_requests(ctx, reqs));
+    REQUIRE(res.size() == 3);
+    REQUIRE(res[0].has_value());
+    CHECK(res[0].value() == 3);
+    REQUIRE(!res[1].has_value());
+    CHECK(res[1].error() != nullptr);
+    CHECK_THROWS_AS(res[1].value(), std::invalid_argument);
+    REQUIRE(res[2].has_value());
+    CHECK(res[2].value() == 7);
+}
+
+TEST_CASE("resolve empty batch of function requests", tag)
+{
+    auto resources{make_inner_test_resources()};
+    request_props<caching_level_type::memory> props{make_test_uuid(622)};
+    std::vector<decltype(rq_function(props, add2, 1, 2))> reqs;
+    caching_request_resolution_context ctx{*resources};
+
+    auto res = cppcoro::sync_wait(resolve_requests(ctx, reqs));
+    CHECK(res.empty());
+}
+
+TEST_CASE("resolve batch of function requests - async", tag)
+{
+    auto resources{make_inner_test_resources()};
+    atst_context ctx{*resources};
+
+    // Each request waits until the other one has started too, so this
+    // succeeds only if they are resolved concurrently.
+    std::atomic<int> num_started{};
+    auto wait_for_other = [&](int x) {
+        num_started += 1;
+        auto deadline{
+            std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+        while (num_started < 2 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+        return num_started == 2 ? x : -1;
+    };
+    request_props<caching_level_type::none> props{make_test_uuid(623)};
+    std::vector reqs{
+        rq_function(props, wait_for_other, 1),
+        rq_function(props, wait_for_other, 2),
+        rq_function(props, wait_for_other, 1)};
+
+    auto res = cppcoro::sync_wait(resolve_requests(ctx, reqs));
+    REQUIRE(res.size() == 3);
+    CHECK(res[0].value() == 1);
+    CHECK(res[1].value() == 2);
+    CHECK(res[2].value() == 1);
+    CHECK(num_started == 2);
+}
+
+TEST_CASE("resolve sync request with parallel subrequests", tag)
+{
+    auto config_map{make_inner_tests_config().get_config_map()};
+    config_map[inner_config_keys::SYNC_CONCURRENCY] = 4U;
+    service_config config{config_map};
+    inner_resources resources{config};
+    resources.set_secondary_cache(std::make_unique<local_disk_cache>(config));
+    REQUIRE(resources.get_sync_thread_pool() != nullptr);
+    caching_request_resolution_context ctx{resources};
+
+    // Each subrequest waits until the other one has started too, so this
+    // succeeds only if they run in parallel.
+    std::atomic<int> num_started{};
+    auto wait_for_other = [&](int x) {
+        num_started += 1;
+        auto deadline{
+            std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+        while (num_started < 2 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+        return num_started == 2 ? x : -1;
+    };
+    request_props<caching_level_type::none> props0{make_test_uuid(630)};
+    request_props<caching_level_type::none> props1{make_test_uuid(631)};
+    auto req{rq_function(
+        props1,
+        add2,
+        rq_function(props0, wait_for_other, 1),
+        rq_function(props0, wait_for_other, 2))};
+
+    auto res = cppcoro::sync_wait(resolve_request(ctx, req));
+    CHECK(res == 3);
+}
+
+// Direct resolution (without coroutines) is not used when there is a sync
+// thread pool: a node running on a pool thread must not block that thread
+// while its subrequests are queued on the same pool.
+TEST_CASE("resolve sync request with parallel subrequests - nested", tag)
+{
+    auto config_map{make_inner_tests_config().get_config_map()};
+    config_map[inner_config_keys::SYNC_CONCURRENCY] = 2U;
+    inner_resources resources{service_config{config_map}};
+    REQUIRE(!resources.allows_direct_resolution());
+    non_caching_request_resolution_context ctx{resources};
+
+    request_props<caching_level_type::none> props{make_test_uuid(632)};
+    auto identity = [](int x) { return x; };
+    auto make_upper = [&](int a, int b) {
+        return rq_function(
+            props,
+            identity,
+            rq_function(
+                props,
+                add2,
+                rq_function(props, identity, a),
+                rq_function(props, identity, b)));
+    };
+    auto req{rq_function(props, add2, make_upper(1, 2), make_upper(3, 4))};
+
+    auto res = cppcoro::sync_wait(resolve_request(ctx, req));
+    CHECK(res == 10);
+}
+
 TEST_CASE("evaluate function request - lock cache record", tag)
 {
     auto resources{make_inner_test_resources()};
@@ -896,10 +1235,10 @@ test_resolve_inner_blob_file(bool allow_blob_files)
     CHECK(res0.get_x() == 3);
     CHECK(to_string(res0.get_y()) == "abc");
     auto y0_owner = res0.get_y().mapped_file_data_owner();
-    // The result has been calculated, serialized for secondary storage, and
-    // deserialized into res0. So if secondary storage disallows blob files,
-    // res0 won't have any.
-    CHECK((y0_owner != nullptr) == allow_blob_files);
+    // The result has been calculated and stored in the memory cache as-is;
+    // it is serialized for secondary storage in the background. So res0 has
+    // a blob file even if secondary storage disallows them.
+    CHECK(y0_owner != nullptr);
 
     resources.reset_memory_cache();
 
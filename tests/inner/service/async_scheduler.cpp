@@ -0,0 +1,212 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <cppcoro/cancellation_source.hpp>
+#include <cppcoro/sync_wait.hpp>
+#include <cppcoro/task.hpp>
+#include <cppcoro/when_all.hpp>
+
+#include <cradle/inner/introspection/tasklet_info.h>
+#include <cradle/inner/service/async_scheduler.h>
+
+using namespace cradle;
+
+namespace {
+
+static char const tag[] = "[inner][service][async_scheduler]";
+
+struct run_log
+{
+    std::mutex mutex;
+    std::vector<int> ids;
+};
+
+cppcoro::task<void>
+run_on_scheduler(
+    async_scheduler& scheduler,
+    async_scheduling scheduling,
+    run_log& log,
+    int id,
+    std::chrono::microseconds predicted_duration = {})
+{
+    co_await scheduler.schedule(scheduling, predicted_duration);
+    std::scoped_lock lock{log.mutex};
+    log.ids.push_back(id);
+}
+
+std::size_t
+total_depth(async_queue_depths const& depths)
+{
+    std::size_t total{0};
+    for (auto depth : depths)
+    {
+        total += depth;
+    }
+    return total;
+}
+
+void
+wait_until(std::function<bool()> const& pred)
+{
+    auto deadline{async_clock::now() + std::chrono::seconds{5}};
+    while (!pred() && async_clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace
+
+TEST_CASE("async_scheduler: priority and deadline order", tag)
+{
+    async_scheduler scheduler{1};
+
+    // Keep the scheduler's only thread busy until all work is queued.
+    std::atomic<bool> busy{false};
+    std::atomic<bool> release{false};
+    auto block = [&]() -> cppcoro::task<void> {
+        co_await scheduler.schedule(async_scheduling{});
+        busy = true;
+        while (!release)
+        {
+            std::this_thread::yield();
+        }
+    };
+    std::jthread blocker{[&] { cppcoro::sync_wait(block()); }};
+    wait_until([&] { return busy.load(); });
+    REQUIRE(busy);
+
+    auto soon{async_clock::now() + std::chrono::seconds{10}};
+    auto later{soon + std::chrono::seconds{10}};
+    run_log log;
+    std::jthread runner{[&] {
+        cppcoro::sync_wait(cppcoro::when_all(
+            run_on_scheduler(
+                scheduler, {async_priority::BATCH, std::nullopt}, log, 0),
+            run_on_scheduler(
+                scheduler, {async_priority::NORMAL, std::nullopt}, log, 1),
+            run_on_scheduler(
+                scheduler, {async_priority::NORMAL, later}, log, 2),
+            run_on_scheduler(
+                scheduler, {async_priority::INTERACTIVE, later}, log, 3),
+            run_on_scheduler(
+                scheduler, {async_priority::NORMAL, soon}, log, 4)));
+    }};
+    wait_until([&] { return total_depth(scheduler.get_queue_depths()) == 5; });
+
+    auto depths{introspection_get_async_queue_depths(scheduler)};
+    CHECK(depths[static_cast<std::size_t>(async_priority::BATCH)] == 1);
+    CHECK(depths[static_cast<std::size_t>(async_priority::NORMAL)] == 3);
+    CHECK(depths[static_cast<std::size_t>(async_priority::INTERACTIVE)] == 1);
+
+    release = true;
+    runner.join();
+    blocker.join();
+
+    CHECK(log.ids == std::vector<int>{3, 4, 2, 1, 0});
+    CHECK(total_depth(scheduler.get_queue_depths()) == 0);
+}
+
+TEST_CASE("async_scheduler: longest predicted duration first", tag)
+{
+    using std::chrono::microseconds;
+    async_scheduler scheduler{1};
+
+    std::atomic<bool> busy{false};
+    std::atomic<bool> release{false};
+    auto block = [&]() -> cppcoro::task<void> {
+        co_await scheduler.schedule(async_scheduling{});
+        busy = true;
+        while (!release)
+        {
+            std::this_thread::yield();
+        }
+    };
+    std::jthread blocker{[&] { cppcoro::sync_wait(block()); }};
+    wait_until([&] { return busy.load(); });
+    REQUIRE(busy);
+
+    auto soon{async_clock::now() + std::chrono::seconds{10}};
+    async_scheduling normal{};
+    run_log log;
+    std::jthread runner{[&] {
+        cppcoro::sync_wait(cppcoro::when_all(
+            run_on_scheduler(scheduler, normal, log, 0),
+            run_on_scheduler(scheduler, normal, log, 1, microseconds{10}),
+            run_on_scheduler(scheduler, normal, log, 2, microseconds{1000}),
+            run_on_scheduler(scheduler, normal, log, 3, microseconds{100}),
+            // The deadline still goes before the predicted duration.
+            run_on_scheduler(
+                scheduler, {async_priority::NORMAL, soon}, log, 4)));
+    }};
+    wait_until([&] { return total_depth(scheduler.get_queue_depths()) == 5; });
+
+    release = true;
+    runner.join();
+    blocker.join();
+
+    CHECK(log.ids == std::vector<int>{4, 2, 3, 1, 0});
+}
+
+TEST_CASE("async_scheduler: runs work on multiple threads", tag)
+{
+    async_scheduler scheduler{4};
+    run_log log;
+    cppcoro::sync_wait(cppcoro::when_all(
+        run_on_scheduler(scheduler, {}, log, 0),
+        run_on_scheduler(scheduler, {}, log, 1),
+        run_on_scheduler(scheduler, {}, log, 2)));
+
+    REQUIRE(log.ids.size() == 3);
+}
+
+TEST_CASE("async_scheduler: cancellation at the deadline", tag)
+{
+    async_scheduler scheduler{1};
+    cppcoro::cancellation_source early;
+    cppcoro::cancellation_source late;
+    auto now{async_clock::now()};
+    scheduler.request_cancellation_at(now + std::chrono::hours{1}, late);
+    scheduler.request_cancellation_at(
+        now + std::chrono::milliseconds{10}, early);
+
+    // No work is queued, so only the timer can cancel early.
+    wait_until([&] { return early.is_cancellation_requested(); });
+    CHECK(early.is_cancellation_requested());
+    CHECK(async_clock::now() >= now + std::chrono::milliseconds{10});
+    CHECK(!late.is_cancellation_requested());
+}
+
+TEST_CASE("async_scheduler: dropped deadline", tag)
+{
+    async_scheduler scheduler{1};
+    cppcoro::cancellation_source dropped;
+    cppcoro::cancellation_source kept;
+    auto now{async_clock::now()};
+    auto key = scheduler.request_cancellation_at(
+        now + std::chrono::milliseconds{10}, dropped);
+    scheduler.request_cancellation_at(
+        now + std::chrono::milliseconds{20}, kept);
+    scheduler.drop_deadline(key);
+
+    wait_until([&] { return kept.is_cancellation_requested(); });
+    CHECK(kept.is_cancellation_requested());
+    CHECK(!dropped.is_cancellation_requested());
+    // Dropping a deadline that has passed is harmless.
+    scheduler.drop_deadline(key);
+}
+
+TEST_CASE("async_priority: to_string", tag)
+{
+    CHECK(std::string{to_string(async_priority::BATCH)} == "BATCH");
+    CHECK(std::string{to_string(async_priority::NORMAL)} == "NORMAL");
+    CHECK(
+        std::string{to_string(async_priority::INTERACTIVE)} == "INTERACTIVE");
+}
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <fmt/format.h>
+
+#include <cradle/inner/service/resolve_durations.h>
+
+using namespace cradle;
+using std::chrono::microseconds;
+
+namespace {
+
+static char const tag[] = "[inner][service][resolve_durations]";
+
+} // namespace
+
+TEST_CASE("resolve_durations: record and predict", tag)
+{
+    resolve_durations durations;
+    CHECK(durations.predict("uuid0") == microseconds{0});
+
+    durations.record("uuid0", microseconds{1000});
+    CHECK(durations.predict("uuid0") == microseconds{1000});
+    // A moving average
+    durations.record("uuid0", microseconds{2000});
+    CHECK(durations.predict("uuid0") == microseconds{1250});
+
+    durations.record("uuid1", microseconds{10});
+    CHECK(durations.predict("uuid1") == microseconds{10});
+    CHECK(durations.size() == 2);
+}
+
+TEST_CASE("resolve_durations: concurrent recording", tag)
+{
+    resolve_durations durations;
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back([&] {
+            for (int j = 0; j < 1000; ++j)
+            {
+                durations.record(
+                    fmt::format("uuid{}", j % 10), microseconds{100});
+            }
+        });
+    }
+    threads.clear();
+    CHECK(durations.size() == 10);
+    CHECK(durations.predict("uuid3") == microseconds{100});
+}
+
+TEST_CASE("resolve_durations: save and load", tag)
+{
+    file_path path{"resolve_durations.txt"};
+    resolve_durations saved;
+    saved.record("uuid0", microseconds{1000});
+    saved.record("uuid1", microseconds{20});
+    saved.save(path);
+    {
+        std::ofstream file{path, std::ios::app};
+        file << "malformed\n";
+        file << "uuid2\tnot a number\n";
+    }
+
+    resolve_durations loaded;
+    loaded.load(path);
+    CHECK(loaded.size() == 2);
+    CHECK(loaded.predict("uuid0") == microseconds{1000});
+    CHECK(loaded.predict("uuid1") == microseconds{20});
+
+    std::filesystem::remove(path);
+    resolve_durations empty;
+    empty.load(path);
+    CHECK(empty.size() == 0);
+}
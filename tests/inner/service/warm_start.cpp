@@ -0,0 +1,106 @@
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <cppcoro/sync_wait.hpp>
+
+#include "../../support/concurrency_testing.h"
+#include <cradle/inner/caching/immutable.h>
+#include <cradle/inner/core/get_unique_string.h>
+#include <cradle/inner/core/type_interfaces.h>
+#include <cradle/inner/service/async_scheduler.h>
+#include <cradle/inner/service/warm_start.h>
+#include <cradle/plugins/secondary_cache/simple/simple_storage.h>
+
+using namespace cradle;
+
+namespace {
+
+static char const tag[] = "[inner][service][warm_start]";
+
+cppcoro::shared_task<void>
+test_task(untyped_immutable_cache_ptr& untyped_ptr, int value)
+{
+    auto& ptr = static_cast<immutable_cache_ptr<int>&>(untyped_ptr);
+    ptr.record_value(std::move(value));
+    co_return;
+}
+
+std::unique_ptr<immutable_cache_ptr<int>>
+make_ready_ptr(immutable_cache& cache, int i)
+{
+    auto ptr = std::make_unique<immutable_cache_ptr<int>>(
+        cache, make_captured_id(i), [i](untyped_immutable_cache_ptr& ptr) {
+            return test_task(ptr, i);
+        });
+    cppcoro::sync_wait(ptr->ensure_value_task());
+    return ptr;
+}
+
+std::string
+get_key(int i)
+{
+    return get_unique_string(*make_captured_id(i));
+}
+
+} // namespace
+
+TEST_CASE("save and load warm start keys", tag)
+{
+    file_path path{"warm_start_keys.txt"};
+    immutable_cache cache{immutable_cache_config{1024}};
+    // Entries 0, 1, 2 are released in this order; entry 3 remains in use.
+    make_ready_ptr(cache, 0);
+    make_ready_ptr(cache, 1);
+    make_ready_ptr(cache, 2);
+    auto ptr3{make_ready_ptr(cache, 3)};
+
+    save_warm_start_keys(cache, path);
+    auto keys{load_warm_start_keys(path)};
+    // The entry in use first, then the most recently used ones.
+    CHECK(
+        keys
+        == std::vector<std::string>{
+            get_key(3), get_key(2), get_key(1), get_key(0)});
+
+    std::filesystem::remove(path);
+    CHECK(load_warm_start_keys(path).empty());
+}
+
+TEST_CASE("warm start prefetcher", tag)
+{
+    simple_blob_storage storage;
+    for (int i = 0; i < 40; ++i)
+    {
+        cppcoro::sync_wait(storage.write(
+            get_key(i), make_blob(std::string(10, 'a' + i % 26))));
+    }
+    async_scheduler scheduler{2};
+    // Key 41 is not in the storage.
+    std::vector<std::string> keys{get_key(41)};
+    for (int i = 0; i < 40; ++i)
+    {
+        keys.push_back(get_key(i));
+    }
+
+    SECTION("all values fit")
+    {
+        warm_start_prefetcher prefetcher{storage, scheduler, keys, 1000};
+        REQUIRE(occurs_soon([&] { return prefetcher.done(); }));
+        CHECK(prefetcher.num_prefetched() == 40);
+        CHECK(!prefetcher.take(get_key(41)));
+        auto value{prefetcher.take(get_key(1))};
+        REQUIRE(value);
+        CHECK(to_string(*value) == std::string(10, 'b'));
+        // A value is handed out only once.
+        CHECK(!prefetcher.take(get_key(1)));
+    }
+    SECTION("size limit")
+    {
+        warm_start_prefetcher prefetcher{storage, scheduler, keys, 100};
+        REQUIRE(occurs_soon([&] { return prefetcher.done(); }));
+        CHECK(prefetcher.num_prefetched() == 10);
+    }
+}
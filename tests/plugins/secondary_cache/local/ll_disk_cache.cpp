@@ -1,8 +1,13 @@
+#include <atomic>
 #include <chrono>
 #include <filesystem>
+#include <optional>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <catch2/catch.hpp>
+#include <cppcoro/sync_wait.hpp>
 #include <sqlite3.h>
 
 #include <cradle/inner/blob_file/blob_file.h>
@@ -21,7 +26,7 @@ namespace {
 static char const tag[] = "[ll_disk_cache]";
 
 ll_disk_cache_config
-create_config(std::string const& cache_dir)
+create_config(std::string const& cache_dir, bool wal_mode = false)
 {
     ll_disk_cache_config config;
     config.directory = cache_dir;
@@ -29,6 +34,8 @@ create_config(std::string const& cache_dir)
     // enough to hold a little under 20 items (which matters for testing
     // the eviction behavior).
     config.size_limit = 500;
+    config.wal_mode = wal_mode;
+    config.num_read_connections = 2;
     return config;
 }
 
@@ -43,11 +50,11 @@ check_initial_cache(ll_disk_cache& cache, std::string const& cache_dir)
 }
 
 ll_disk_cache
-create_disk_cache()
+create_disk_cache(bool wal_mode = false)
 {
     std::string const cache_dir = "disk_cache";
     reset_directory(cache_dir);
-    ll_disk_cache cache{create_config(cache_dir)};
+    ll_disk_cache cache{create_config(cache_dir, wal_mode)};
     check_initial_cache(cache, cache_dir);
     return cache;
 }
@@ -295,6 +302,133 @@ TEST_CASE("clearing", tag)
     REQUIRE(!test_item_access(cache, 1));
 }
 
+TEST_CASE("asynchronous look-up", tag)
+{
+    auto cache{create_disk_cache()};
+    REQUIRE(!test_item_access(cache, 0));
+    REQUIRE(!test_item_access(cache, 1));
+    auto key0{generate_key_string(0)};
+    auto key1{generate_key_string(1)};
+    auto key2{generate_key_string(2)};
+
+    auto look_up = [&](std::string key)
+        -> cppcoro::task<
+            std::pair<std::optional<ll_disk_cache_cas_entry>, bool>> {
+        auto caller_id = std::this_thread::get_id();
+        auto entry = co_await cache.find_async(key);
+        co_return std::make_pair(
+            entry, std::this_thread::get_id() != caller_id);
+    };
+
+    // Value stored in the database
+    auto [entry0, switched0] = cppcoro::sync_wait(look_up(key0));
+    REQUIRE(entry0);
+    REQUIRE(entry0->value);
+    REQUIRE(*entry0->value == make_blob(generate_value_string(0)));
+    REQUIRE(switched0);
+    // Value stored in a file
+    auto [entry1, switched1] = cppcoro::sync_wait(look_up(key1));
+    REQUIRE(entry1);
+    REQUIRE(!entry1->value);
+    REQUIRE(switched1);
+    // Not in the cache
+    auto [entry2, switched2] = cppcoro::sync_wait(look_up(key2));
+    REQUIRE(!entry2);
+    REQUIRE(switched2);
+
+    auto info = cache.get_summary_info();
+    // Two misses and three hits in the test_item_access() calls
+    REQUIRE(info.hit_count == 5);
+    REQUIRE(info.miss_count == 3);
+}
+
+TEST_CASE("batch insert", tag)
+{
+    auto cache{create_disk_cache()};
+    REQUIRE(!test_item_access(cache, 0));
+
+    auto make_insert = [&](int item_id, bool external) {
+        auto value{make_blob(generate_value_string(item_id))};
+        auto digest{get_unique_string_tmpl(value)};
+        std::optional<blob> stored_value;
+        if (external)
+        {
+            dump_string_to_file(
+                cache.get_path_for_digest(digest),
+                generate_value_string(item_id));
+        }
+        else
+        {
+            stored_value = value;
+        }
+        return ll_disk_cache_insert{
+            generate_key_string(item_id),
+            digest,
+            stored_value,
+            value.size(),
+            value.size()};
+    };
+    std::vector<ll_disk_cache_insert> inserts{
+        make_insert(1, false),
+        make_insert(2, true),
+        // Already in the cache
+        make_insert(0, false),
+        // Same value as the preceding entry in the batch
+        make_insert(1, false)};
+    inserts.back().ac_key = "other_key_for_1";
+    cache.insert_batch(inserts);
+
+    auto info = cache.get_summary_info();
+    REQUIRE(info.ac_entry_count == 4);
+    REQUIRE(info.cas_entry_count == 3);
+
+    auto entry1 = cache.find(generate_key_string(1));
+    REQUIRE(entry1);
+    REQUIRE(entry1->value);
+    REQUIRE(*entry1->value == make_blob(generate_value_string(1)));
+    auto other_entry1 = cache.find("other_key_for_1");
+    REQUIRE(other_entry1);
+    REQUIRE(other_entry1->cas_id == entry1->cas_id);
+    auto entry2 = cache.find(generate_key_string(2));
+    REQUIRE(entry2);
+    REQUIRE(!entry2->value);
+    REQUIRE(
+        read_file_contents(cache.get_path_for_digest(entry2->digest))
+        == generate_value_string(2));
+    REQUIRE(test_item_access(cache, 0));
+}
+
+TEST_CASE("batch insert - missing file", tag)
+{
+    auto cache{create_disk_cache()};
+
+    // The file for item 1 is written; the one for item 2 is not (as if an
+    // eviction removed it after it was written).
+    auto make_insert = [&](int item_id, bool write_file) {
+        auto value{make_blob(generate_value_string(item_id))};
+        auto digest{get_unique_string_tmpl(value)};
+        if (write_file)
+        {
+            dump_string_to_file(
+                cache.get_path_for_digest(digest),
+                generate_value_string(item_id));
+        }
+        return ll_disk_cache_insert{
+            generate_key_string(item_id),
+            digest,
+            std::nullopt,
+            value.size(),
+            value.size()};
+    };
+    cache.insert_batch({make_insert(1, true), make_insert(2, false)});
+
+    auto info = cache.get_summary_info();
+    REQUIRE(info.ac_entry_count == 1);
+    REQUIRE(info.cas_entry_count == 1);
+    REQUIRE(cache.find(generate_key_string(1)));
+    REQUIRE(!cache.find(generate_key_string(2)));
+}
+
 TEST_CASE("LRU removal", tag)
 {
     auto cache{create_disk_cache()};
@@ -321,6 +455,115 @@ TEST_CASE("LRU removal", tag)
     }
 }
 
+TEST_CASE("WAL mode", tag)
+{
+    auto cache{create_disk_cache(true)};
+    REQUIRE(!test_item_access(cache, 0));
+    REQUIRE(test_item_access(cache, 0));
+    REQUIRE(!test_item_access(cache, 1));
+    REQUIRE(test_item_access(cache, 1));
+
+    // Entries 0 and 1 must remain in the cache, so the AC usage recorded by
+    // the look-ups on the read connections must reach the database.
+    for (int i = 2; i != 30; ++i)
+    {
+        INFO(i)
+        REQUIRE(test_item_access(cache, 0));
+        REQUIRE(test_item_access(cache, 1));
+        REQUIRE(!test_item_access(cache, i));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(test_item_access(cache, 0));
+    REQUIRE(test_item_access(cache, 1));
+}
+
+TEST_CASE("concurrent look-ups in WAL mode", tag)
+{
+    auto cache{create_disk_cache(true)};
+    constexpr int num_items = 4;
+    for (int i = 0; i < num_items; ++i)
+    {
+        REQUIRE(!test_item_access(cache, i));
+    }
+    auto info0 = cache.get_summary_info();
+
+    // More threads than read connections
+    constexpr int num_threads = 4;
+    constexpr int num_loops = 50;
+    std::atomic<int> num_found{0};
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < num_threads; ++t)
+        {
+            threads.emplace_back([&] {
+                for (int j = 0; j < num_loops; ++j)
+                {
+                    for (int i = 0; i <= num_items; ++i)
+                    {
+                        // Item num_items is not in the cache.
+                        if (cache.find(generate_key_string(i)))
+                        {
+                            num_found += 1;
+                        }
+                    }
+                }
+            });
+        }
+        // A write while the look-ups are running
+        REQUIRE(!test_item_access(cache, num_items + 1));
+    }
+    REQUIRE(num_found == num_threads * num_loops * num_items);
+
+    auto info1 = cache.get_summary_info();
+    REQUIRE(
+        info1.hit_count - info0.hit_count
+        >= num_threads * num_loops * num_items);
+    REQUIRE(
+        info1.miss_count - info0.miss_count >= num_threads * num_loops);
+}
+
+TEST_CASE("memory index", tag)
+{
+    std::string const cache_dir = "disk_cache";
+    reset_directory(cache_dir);
+    auto config{create_config(cache_dir)};
+    config.memory_index = true;
+    {
+        ll_disk_cache cache{config};
+        check_initial_cache(cache, cache_dir);
+        REQUIRE(!test_item_access(cache, 0));
+        REQUIRE(test_item_access(cache, 0));
+        REQUIRE(!test_item_access(cache, 1));
+        REQUIRE(test_item_access(cache, 1));
+
+        // Evictions must update the index as well.
+        for (int i = 2; i != 30; ++i)
+        {
+            INFO(i)
+            REQUIRE(test_item_access(cache, 0));
+            REQUIRE(test_item_access(cache, 1));
+            REQUIRE(!test_item_access(cache, i));
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(!cache.find(generate_key_string(2)));
+    }
+
+    // A new cache on the same directory loads the index from the database.
+    ll_disk_cache cache{config};
+    auto info = cache.get_summary_info();
+    REQUIRE(info.ac_entry_count > 2);
+    REQUIRE(test_item_access(cache, 0));
+    REQUIRE(test_item_access(cache, 1));
+    REQUIRE(test_item_access(cache, 29));
+    REQUIRE(!cache.find(generate_key_string(2)));
+
+    cache.remove_entry(*cache.look_up_ac_id(generate_key_string(0)));
+    REQUIRE(!cache.find(generate_key_string(0)));
+    cache.clear();
+    REQUIRE(!cache.find(generate_key_string(1)));
+    REQUIRE(!test_item_access(cache, 1));
+}
+
 TEST_CASE("entry removal error", tag)
 {
     auto cache{create_disk_cache()};
@@ -456,6 +699,26 @@ TEST_CASE("incompatible cache", tag)
     REQUIRE(!exists(extraneous_file));
 }
 
+TEST_CASE("cache with a different digest algorithm", tag)
+{
+    std::string const cache_dir{"disk_cache"};
+    auto cache{create_disk_cache()};
+    REQUIRE(!test_item_access(cache, 0));
+    REQUIRE(test_item_access(cache, 0));
+
+    // Reopening the cache with the same algorithm keeps the entries.
+    cache.reset(create_config(cache_dir));
+    REQUIRE(cache.get_summary_info().ac_entry_count == 1);
+
+    // Reopening the cache with another algorithm clears it.
+    auto config{create_config(cache_dir)};
+    config.algorithm = digest_algorithm::XXH3_128;
+    cache.reset(config);
+    check_initial_cache(cache, cache_dir);
+    REQUIRE(!test_item_access(cache, 0));
+    REQUIRE(test_item_access(cache, 0));
+}
+
 TEST_CASE("recover from a corrupt index.db", tag)
 {
     reset_directory("disk_cache");
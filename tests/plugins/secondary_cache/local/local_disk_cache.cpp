@@ -1,8 +1,10 @@
 #include <string>
 
 #include <catch2/catch.hpp>
+#include <cppcoro/sync_wait.hpp>
 
 #include <cradle/inner/core/type_interfaces.h>
+#include <cradle/plugins/secondary_cache/local/disk_cache_file_mapping.h>
 #include <cradle/plugins/secondary_cache/local/local_disk_cache.h>
 
 using namespace cradle;
@@ -19,12 +21,17 @@ service_config_map const inner_config_map{
     {local_disk_cache_config_keys::NUM_THREADS_READ_POOL, 2U},
     {local_disk_cache_config_keys::NUM_THREADS_WRITE_POOL, 2U},
     {local_disk_cache_config_keys::START_EMPTY, true},
+    // Large enough that only flush() writes the entries in the tests
+    {local_disk_cache_config_keys::WRITE_BATCH_DELAY, 60'000U},
 };
 
 service_config
-create_config()
+create_config(std::size_t mmap_threshold = 0, bool start_empty = true)
 {
-    return service_config{inner_config_map};
+    auto config_map{inner_config_map};
+    config_map[local_disk_cache_config_keys::MMAP_THRESHOLD] = mmap_threshold;
+    config_map[local_disk_cache_config_keys::START_EMPTY] = start_empty;
+    return service_config{config_map};
 }
 
 } // namespace
@@ -57,3 +64,76 @@ TEST_CASE("read non-existent raw value", tag)
     auto read_value1{cache.read_raw_value(read_key)};
     REQUIRE(!read_value1);
 }
+
+TEST_CASE("write batching and flush", tag)
+{
+    local_disk_cache cache{create_config()};
+    std::string small_key{"small_key"};
+    auto small_value{make_string_literal_blob("small value")};
+    std::string large_key{"large_key"};
+    auto large_value{make_blob(std::string(10000, 'x'))};
+
+    cppcoro::sync_wait(cache.write(small_key, small_value));
+    cppcoro::sync_wait(cache.write(large_key, large_value));
+    cache.flush();
+    REQUIRE(!cache.busy_writing_to_file());
+
+    auto info{cache.get_summary_info()};
+    REQUIRE(info.ac_entry_count == 2);
+    REQUIRE(info.cas_entry_count == 2);
+    REQUIRE(cppcoro::sync_wait(cache.read(small_key)) == small_value);
+    REQUIRE(cppcoro::sync_wait(cache.read(large_key)) == large_value);
+}
+
+// Files are not mapped on Windows.
+#ifndef _WIN32
+TEST_CASE("memory-mapped reads", tag)
+{
+    local_disk_cache cache{create_config(20000)};
+    // Compressed, so not mapped
+    std::string compressed_key{"compressed_key"};
+    auto compressed_value{make_blob(std::string(10000, 'x'))};
+    // Stored uncompressed, and mapped when read
+    std::string mapped_key{"mapped_key"};
+    auto mapped_value{make_blob(std::string(30000, 'y'))};
+
+    cppcoro::sync_wait(cache.write(compressed_key, compressed_value));
+    cppcoro::sync_wait(cache.write(mapped_key, mapped_value));
+    cache.flush();
+
+    auto info{cache.get_summary_info()};
+    REQUIRE(info.cas_entry_count == 2);
+    REQUIRE(info.total_size > 30000);
+    REQUIRE(info.total_size < 40000);
+    auto read_value{cppcoro::sync_wait(cache.read(mapped_key))};
+    REQUIRE(read_value);
+    REQUIRE(*read_value == mapped_value);
+    REQUIRE(
+        dynamic_cast<disk_cache_file_mapping const*>(read_value->owner()));
+    // A mapped cache file must not be passed on as a blob file.
+    REQUIRE(!read_value->mapped_file_data_owner());
+    REQUIRE(
+        cppcoro::sync_wait(cache.read(compressed_key)) == compressed_value);
+}
+#endif
+
+TEST_CASE("mmap threshold changed on existing cache", tag)
+{
+    auto value{make_blob(std::string(30000, 'y'))};
+    {
+        // Stored compressed
+        local_disk_cache cache{create_config(0)};
+        cppcoro::sync_wait(cache.write("key0", value));
+        cache.flush();
+    }
+    local_disk_cache cache{create_config(20000, false)};
+    // Same value, so same CAS entry; its file must stay compressed.
+    cppcoro::sync_wait(cache.write("key1", value));
+    cache.flush();
+
+    auto info{cache.get_summary_info()};
+    REQUIRE(info.ac_entry_count == 2);
+    REQUIRE(info.cas_entry_count == 1);
+    REQUIRE(cppcoro::sync_wait(cache.read("key0")) == value);
+    REQUIRE(cppcoro::sync_wait(cache.read("key1")) == value);
+}
@@ -51,8 +51,13 @@ occurs_soon(Condition&& condition, int wait_time_in_ms = 1000)
 inline void
 sync_wait_write_disk_cache(inner_resources& resources)
 {
+    // Values are first serialized in the background, then passed to the disk
+    // cache.
+    resources.wait_for_secondary_cache_writes();
     auto& disk_cache{
         static_cast<local_disk_cache&>(resources.secondary_cache())};
+    // The disk cache batches its database inserts.
+    disk_cache.flush();
 
     if (!occurs_soon([&] { return !disk_cache.busy_writing_to_file(); }))
     {